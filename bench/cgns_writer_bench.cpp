@@ -0,0 +1,477 @@
+// Phase-level microbenchmark for the unstructured writers.
+//
+// Generates synthetic meshes (structured hex blocks, random tets, mixed
+// elements) with 32- or 64-bit ids, writes each through
+// cgns_writer::WriteUnstructured and CgnsWriter::Write, and prints the time of
+// every recorded phase (validation, sectioning, conversion, each libcgns
+// call) with cells/s and MB/s. The phases come from CgnsWriterPhaseTimer.h,
+// which is why this target compiles the core sources in instead of linking
+// the DLL. Phases nest (e.g. "coords" contains its cg_* calls), so the
+// phase column does not add up to the total.
+
+#include "CgnsWriter.h"
+#include "CgnsWriterCore.h"
+#include "CgnsWriterExport.h"
+#include "CgnsWriterPhaseTimer.h"
+
+#include <vtkCellArray.h>
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnstructuredGrid.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr unsigned char VTK_TETRA = 10;
+constexpr unsigned char VTK_HEXAHEDRON = 12;
+constexpr unsigned char VTK_WEDGE = 13;
+constexpr unsigned char VTK_PYRAMID = 14;
+
+struct SyntheticMesh {
+  std::string name;
+  std::vector<double> points;
+  std::vector<int64_t> connectivity;
+  std::vector<int64_t> offsets;
+  std::vector<unsigned char> types;
+  std::vector<double> pointField; // scalar
+  std::vector<double> cellField;  // 3 components
+};
+
+void AddCell(SyntheticMesh &mesh, unsigned char type,
+             std::initializer_list<int64_t> ids) {
+  mesh.connectivity.insert(mesh.connectivity.end(), ids.begin(), ids.end());
+  mesh.offsets.push_back(static_cast<int64_t>(mesh.connectivity.size()));
+  mesh.types.push_back(type);
+}
+
+// (n+1)^3 grid points; jitter > 0 moves them randomly by up to jitter cells.
+void AddGridPoints(SyntheticMesh &mesh, int n, double jitter,
+                   std::mt19937_64 &rng) {
+  std::uniform_real_distribution<double> dist(-jitter, jitter);
+  for (int k = 0; k <= n; ++k) {
+    for (int j = 0; j <= n; ++j) {
+      for (int i = 0; i <= n; ++i) {
+        const double dx = jitter > 0.0 ? dist(rng) : 0.0;
+        mesh.points.push_back((i + dx) / n);
+        mesh.points.push_back((j + dx) / n);
+        mesh.points.push_back((k + dx) / n);
+      }
+    }
+  }
+}
+
+// Calls fn(v) for every cell of the n^3 grid with its 8 corner ids in VTK hex order.
+void ForEachHex(int n, const std::function<void(const int64_t *)> &fn) {
+  const int64_t np = n + 1;
+  auto id = [np](int64_t i, int64_t j, int64_t k) { return i + np * (j + np * k); };
+  for (int k = 0; k < n; ++k) {
+    for (int j = 0; j < n; ++j) {
+      for (int i = 0; i < n; ++i) {
+        const int64_t v[8] = {id(i, j, k),         id(i + 1, j, k),
+                              id(i + 1, j + 1, k), id(i, j + 1, k),
+                              id(i, j, k + 1),     id(i + 1, j, k + 1),
+                              id(i + 1, j + 1, k + 1), id(i, j + 1, k + 1)};
+        fn(v);
+      }
+    }
+  }
+}
+
+void AddFields(SyntheticMesh &mesh) {
+  const size_t numPoints = mesh.points.size() / 3;
+  mesh.pointField.resize(numPoints);
+  for (size_t p = 0; p < numPoints; ++p) {
+    const double *x = &mesh.points[p * 3];
+    mesh.pointField[p] = std::sin(6.0 * x[0]) * std::cos(4.0 * x[1]) + x[2];
+  }
+  mesh.cellField.resize(mesh.types.size() * 3);
+  for (size_t c = 0; c < mesh.cellField.size(); ++c) {
+    mesh.cellField[c] = std::cos(1e-3 * static_cast<double>(c));
+  }
+}
+
+// n^3 hexahedra in grid order: the best case for every pass.
+SyntheticMesh MakeHexBlock(int n) {
+  SyntheticMesh mesh;
+  mesh.name = "hex-block";
+  std::mt19937_64 rng(1);
+  AddGridPoints(mesh, n, 0.0, rng);
+  mesh.offsets.push_back(0);
+  ForEachHex(n, [&](const int64_t *v) {
+    AddCell(mesh, VTK_HEXAHEDRON, {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]});
+  });
+  AddFields(mesh);
+  return mesh;
+}
+
+// 5 n^3 tetrahedra with jittered, randomly numbered points and shuffled cells,
+// so connectivity reads and field gathers have no locality.
+SyntheticMesh MakeRandomTets(int n) {
+  SyntheticMesh mesh;
+  mesh.name = "random-tet";
+  std::mt19937_64 rng(2);
+  AddGridPoints(mesh, n, 0.2, rng);
+  mesh.offsets.push_back(0);
+  ForEachHex(n, [&](const int64_t *v) {
+    AddCell(mesh, VTK_TETRA, {v[0], v[1], v[3], v[4]});
+    AddCell(mesh, VTK_TETRA, {v[1], v[2], v[3], v[6]});
+    AddCell(mesh, VTK_TETRA, {v[4], v[5], v[6], v[1]});
+    AddCell(mesh, VTK_TETRA, {v[4], v[6], v[7], v[3]});
+    AddCell(mesh, VTK_TETRA, {v[1], v[3], v[4], v[6]});
+  });
+
+  // Renumber points randomly.
+  const size_t numPoints = mesh.points.size() / 3;
+  std::vector<int64_t> newId(numPoints);
+  std::iota(newId.begin(), newId.end(), 0);
+  std::shuffle(newId.begin(), newId.end(), rng);
+  std::vector<double> moved(mesh.points.size());
+  for (size_t p = 0; p < numPoints; ++p) {
+    std::copy_n(&mesh.points[p * 3], 3, &moved[static_cast<size_t>(newId[p]) * 3]);
+  }
+  mesh.points.swap(moved);
+  for (int64_t &id : mesh.connectivity) {
+    id = newId[static_cast<size_t>(id)];
+  }
+
+  // All cells have 4 nodes, so shuffling whole cells keeps the offsets valid.
+  const size_t numCells = mesh.types.size();
+  std::vector<size_t> order(numCells);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), rng);
+  std::vector<int64_t> shuffled(mesh.connectivity.size());
+  for (size_t c = 0; c < numCells; ++c) {
+    std::copy_n(mesh.connectivity.begin() + order[c] * 4, 4, shuffled.begin() + c * 4);
+  }
+  mesh.connectivity.swap(shuffled);
+  AddFields(mesh);
+  return mesh;
+}
+
+// Each grid cell becomes, in rotation, 1 hex, 2 wedges, 5 tets or 6 pyramids
+// (around an extra centre point), so cells of four types are interleaved.
+SyntheticMesh MakeMixed(int n) {
+  SyntheticMesh mesh;
+  mesh.name = "mixed";
+  std::mt19937_64 rng(3);
+  AddGridPoints(mesh, n, 0.0, rng);
+  mesh.offsets.push_back(0);
+  int64_t cell = 0;
+  ForEachHex(n, [&](const int64_t *v) {
+    switch (cell++ % 4) {
+    case 0:
+      AddCell(mesh, VTK_HEXAHEDRON, {v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]});
+      break;
+    case 1:
+      AddCell(mesh, VTK_WEDGE, {v[0], v[1], v[3], v[4], v[5], v[7]});
+      AddCell(mesh, VTK_WEDGE, {v[1], v[2], v[3], v[5], v[6], v[7]});
+      break;
+    case 2:
+      AddCell(mesh, VTK_TETRA, {v[0], v[1], v[3], v[4]});
+      AddCell(mesh, VTK_TETRA, {v[1], v[2], v[3], v[6]});
+      AddCell(mesh, VTK_TETRA, {v[4], v[5], v[6], v[1]});
+      AddCell(mesh, VTK_TETRA, {v[4], v[6], v[7], v[3]});
+      AddCell(mesh, VTK_TETRA, {v[1], v[3], v[4], v[6]});
+      break;
+    default: {
+      double centre[3] = {0.0, 0.0, 0.0};
+      for (int c = 0; c < 8; ++c) {
+        for (int d = 0; d < 3; ++d) {
+          centre[d] += mesh.points[static_cast<size_t>(v[c]) * 3 + d] / 8.0;
+        }
+      }
+      const int64_t apex = static_cast<int64_t>(mesh.points.size() / 3);
+      mesh.points.insert(mesh.points.end(), centre, centre + 3);
+      AddCell(mesh, VTK_PYRAMID, {v[0], v[3], v[2], v[1], apex});
+      AddCell(mesh, VTK_PYRAMID, {v[4], v[5], v[6], v[7], apex});
+      AddCell(mesh, VTK_PYRAMID, {v[0], v[1], v[5], v[4], apex});
+      AddCell(mesh, VTK_PYRAMID, {v[1], v[2], v[6], v[5], apex});
+      AddCell(mesh, VTK_PYRAMID, {v[2], v[3], v[7], v[6], apex});
+      AddCell(mesh, VTK_PYRAMID, {v[3], v[0], v[4], v[7], apex});
+      break;
+    }
+    }
+  });
+  AddFields(mesh);
+  return mesh;
+}
+
+// The mesh in the form a run feeds to the writer: ids narrowed when use32 is set.
+struct RunInput {
+  const SyntheticMesh *mesh = nullptr;
+  bool use32 = false;
+  std::vector<int32_t> connectivity32;
+  std::vector<int32_t> offsets32;
+  CgnsFieldInfo pointField = {};
+  CgnsFieldInfo cellField = {};
+  UnstructuredMeshInfo info = {};
+  double bytes = 0.0; // input bytes the writer reads
+};
+
+void MakeRunInput(SyntheticMesh &mesh, bool use32, RunInput &run) {
+  run.mesh = &mesh;
+  run.use32 = use32;
+  UnstructuredMeshInfo &info = run.info;
+  cgns_mesh_info_init(&info);
+  info.points = mesh.points.data();
+  info.num_points = static_cast<int64_t>(mesh.points.size() / 3);
+  info.connectivity_size = static_cast<int64_t>(mesh.connectivity.size());
+  info.num_cells = static_cast<int64_t>(mesh.types.size());
+  info.types = mesh.types.data();
+  if (use32) {
+    run.connectivity32.assign(mesh.connectivity.begin(), mesh.connectivity.end());
+    run.offsets32.assign(mesh.offsets.begin(), mesh.offsets.end());
+    info.connectivity = run.connectivity32.data();
+    info.offsets = run.offsets32.data();
+    info.use_64bit_ids = 0;
+  } else {
+    info.connectivity = mesh.connectivity.data();
+    info.offsets = mesh.offsets.data();
+    info.use_64bit_ids = 1;
+  }
+  run.pointField = {"Smooth", CGNS_FIELD_FLOAT64, 1, mesh.pointField.data(), 0};
+  run.cellField = {"Vector", CGNS_FIELD_FLOAT64, 3, mesh.cellField.data(), 0};
+  info.point_fields = &run.pointField;
+  info.num_point_fields = 1;
+  info.cell_fields = &run.cellField;
+  info.num_cell_fields = 1;
+
+  const double idBytes = use32 ? 4.0 : 8.0;
+  run.bytes = static_cast<double>(mesh.points.size() + mesh.pointField.size() +
+                                  mesh.cellField.size()) * 8.0 +
+              static_cast<double>(mesh.connectivity.size() + mesh.offsets.size()) * idBytes +
+              static_cast<double>(mesh.types.size());
+}
+
+// Builds a vtkUnstructuredGrid that shares the mesh's point and field buffers.
+vtkSmartPointer<vtkUnstructuredGrid> MakeGrid(const RunInput &run) {
+  const SyntheticMesh &mesh = *run.mesh;
+  vtkNew<vtkDoubleArray> coords;
+  coords->SetNumberOfComponents(3);
+  coords->SetArray(const_cast<double *>(mesh.points.data()),
+                   static_cast<vtkIdType>(mesh.points.size()), 1);
+  vtkNew<vtkPoints> points;
+  points->SetData(coords);
+
+  vtkNew<vtkCellArray> cells;
+  if (run.use32) {
+    vtkNew<vtkTypeInt32Array> offsets;
+    vtkNew<vtkTypeInt32Array> conn;
+    offsets->SetArray(reinterpret_cast<vtkTypeInt32 *>(const_cast<int32_t *>(run.offsets32.data())),
+                      static_cast<vtkIdType>(run.offsets32.size()), 1);
+    conn->SetArray(reinterpret_cast<vtkTypeInt32 *>(const_cast<int32_t *>(run.connectivity32.data())),
+                   static_cast<vtkIdType>(run.connectivity32.size()), 1);
+    cells->SetData(offsets, conn);
+  } else {
+    vtkNew<vtkTypeInt64Array> offsets;
+    vtkNew<vtkTypeInt64Array> conn;
+    // vtkTypeInt64 may be long long where int64_t is long; both are 64-bit.
+    offsets->SetArray(reinterpret_cast<vtkTypeInt64 *>(const_cast<int64_t *>(mesh.offsets.data())),
+                      static_cast<vtkIdType>(mesh.offsets.size()), 1);
+    conn->SetArray(reinterpret_cast<vtkTypeInt64 *>(const_cast<int64_t *>(mesh.connectivity.data())),
+                   static_cast<vtkIdType>(mesh.connectivity.size()), 1);
+    cells->SetData(offsets, conn);
+  }
+  vtkNew<vtkUnsignedCharArray> types;
+  types->SetArray(const_cast<unsigned char *>(mesh.types.data()),
+                  static_cast<vtkIdType>(mesh.types.size()), 1);
+
+  auto grid = vtkSmartPointer<vtkUnstructuredGrid>::New();
+  grid->SetPoints(points);
+  grid->SetCells(types, cells);
+
+  vtkNew<vtkDoubleArray> pointField;
+  pointField->SetName("Smooth");
+  pointField->SetArray(const_cast<double *>(mesh.pointField.data()),
+                       static_cast<vtkIdType>(mesh.pointField.size()), 1);
+  grid->GetPointData()->AddArray(pointField);
+
+  vtkNew<vtkDoubleArray> cellField;
+  cellField->SetName("Vector");
+  cellField->SetNumberOfComponents(3);
+  cellField->SetArray(const_cast<double *>(mesh.cellField.data()),
+                      static_cast<vtkIdType>(mesh.cellField.size()), 1);
+  grid->GetCellData()->AddArray(cellField);
+  return grid;
+}
+
+struct Result {
+  double seconds = 1e30;
+  std::vector<cgns_writer::phase::Timing> phases;
+};
+
+// Best-of-repeats total time of write(), with the phase timings of that run.
+template <typename Fn> Result Measure(int repeats, Fn write) {
+  Result best;
+  for (int r = 0; r < repeats; ++r) {
+    cgns_writer::phase::Enable(true);
+    const auto t0 = std::chrono::steady_clock::now();
+    write();
+    const auto t1 = std::chrono::steady_clock::now();
+    std::vector<cgns_writer::phase::Timing> phases = cgns_writer::phase::Take();
+    cgns_writer::phase::Enable(false);
+    const double seconds = std::chrono::duration<double>(t1 - t0).count();
+    if (seconds < best.seconds) {
+      best.seconds = seconds;
+      best.phases = std::move(phases);
+    }
+  }
+  return best;
+}
+
+void PrintResult(const char *api, const RunInput &run, const Result &result) {
+  const double cells = static_cast<double>(run.mesh->types.size());
+  std::printf("\n%s  %s  %d-bit ids  %.0f cells  %.1f MB in\n", api,
+              run.mesh->name.c_str(), run.use32 ? 32 : 64, cells,
+              run.bytes / (1024.0 * 1024.0));
+  std::printf("  %-26s %10s %7s %8s %12s %10s\n", "phase", "seconds", "%",
+              "calls", "Mcells/s", "MB out");
+  for (const auto &p : result.phases) {
+    std::printf("  %-26s %10.4f %7.1f %8lld %12.2f %10.1f\n", p.name,
+                p.seconds, 100.0 * p.seconds / result.seconds,
+                static_cast<long long>(p.calls),
+                p.seconds > 0.0 ? cells / p.seconds / 1e6 : 0.0,
+                static_cast<double>(p.bytes) / (1024.0 * 1024.0));
+  }
+  std::printf("  %-26s %10.4f %7.1f %8s %12.2f   %.1f MB/s\n", "total",
+              result.seconds, 100.0, "", cells / result.seconds / 1e6,
+              run.bytes / (1024.0 * 1024.0) / result.seconds);
+}
+
+void PrintUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options]\n"
+            << "  --mesh <hex|tet|mixed|all>   Mesh generator (default: all)\n"
+            << "  --cells <n>                  Grid cells per axis (default: 64)\n"
+            << "  --ids <32|64|both>           Id width (default: both)\n"
+            << "  --api <core|vtk|both>        Writer to time (default: both)\n"
+            << "  --threads <n>                Core section threads (default: 1, -1 = all)\n"
+            << "  --sections <type|mixed>      One section per element type, or a single MIXED\n"
+            << "                               section in input cell order (default: type)\n"
+            << "  --repeats <n>                Runs per case, best is shown (default: 3)\n"
+            << "  --out <dir>                  Output directory (default: .)\n";
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string meshKind = "all";
+  std::string ids = "both";
+  std::string api = "both";
+  int n = 64;
+  int threads = 1;
+  std::string sections = "type";
+  int repeats = 3;
+  std::filesystem::path outDir = ".";
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") {
+      PrintUsage(argv[0]);
+      return 0;
+    } else if (arg == "--mesh" && i + 1 < argc) {
+      meshKind = argv[++i];
+    } else if (arg == "--cells" && i + 1 < argc) {
+      n = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--ids" && i + 1 < argc) {
+      ids = argv[++i];
+    } else if (arg == "--api" && i + 1 < argc) {
+      api = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::stoi(argv[++i]);
+    } else if (arg == "--sections" && i + 1 < argc) {
+      sections = argv[++i];
+    } else if (arg == "--repeats" && i + 1 < argc) {
+      repeats = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--out" && i + 1 < argc) {
+      outDir = argv[++i];
+    } else {
+      std::cerr << "Unknown argument: " << arg << "\n";
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<std::function<SyntheticMesh(int)>> generators;
+  if (meshKind == "hex" || meshKind == "all") {
+    generators.emplace_back(MakeHexBlock);
+  }
+  if (meshKind == "tet" || meshKind == "all") {
+    generators.emplace_back(MakeRandomTets);
+  }
+  if (meshKind == "mixed" || meshKind == "all") {
+    generators.emplace_back(MakeMixed);
+  }
+  std::vector<bool> widths;
+  if (ids == "32" || ids == "both") {
+    widths.push_back(true);
+  }
+  if (ids == "64" || ids == "both") {
+    widths.push_back(false);
+  }
+  if (generators.empty() || widths.empty() ||
+      (sections != "type" && sections != "mixed")) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  try {
+    for (const auto &generate : generators) {
+      SyntheticMesh mesh = generate(n);
+      for (const bool use32 : widths) {
+        RunInput run;
+        MakeRunInput(mesh, use32, run);
+        const std::string stem =
+            (outDir / (mesh.name + (use32 ? "_i32" : "_i64"))).string();
+
+        if (api == "core" || api == "both") {
+          CgnsWriteOptions options;
+          cgns_write_options_init(&options);
+          options.use_hdf5 = 1;
+          options.num_threads = threads;
+          options.section_layout =
+              sections == "mixed" ? CGNS_SECTIONS_MIXED : CGNS_SECTIONS_BY_TYPE;
+          const std::string path = stem + "_core.cgns";
+          const Result result = Measure(repeats, [&] {
+            if (cgns_writer::WriteUnstructured(run.info, path.c_str(), &options) != 0) {
+              throw std::runtime_error(std::string("WriteUnstructured: ") +
+                                       cgns_get_last_error());
+            }
+          });
+          PrintResult("core", run, result);
+        }
+
+        if (api == "vtk" || api == "both") {
+          vtkSmartPointer<vtkUnstructuredGrid> grid = MakeGrid(run);
+          const std::string path = stem + "_vtk.cgns";
+          CgnsWriterOptions options;
+          options.mixedSection = sections == "mixed";
+          const Result result = Measure(repeats, [&] {
+            CgnsWriter::Write(grid, path, options);
+          });
+          PrintResult("vtk", run, result);
+        }
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,272 @@
+// Compression benchmark for cgns_writer_dll.
+//
+// For every mesh and compression level it writes three files and attributes
+// size and time to each data category by difference:
+//   coords : points only (one NODE element)          -> CoordinateX/Y/Z
+//   conn   : points + cells, minus coords            -> element connectivity
+//   fields : points + cells + fields, minus conn     -> FlowSolution arrays
+// Times are the best of several repeats, including open/close, so HDF5 work
+// deferred to cg_close (chunk compression, flushes) is counted.
+
+#include "CgnsWriterExport.h"
+
+#include <cgnslib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr unsigned char VTK_VERTEX = 1;
+constexpr unsigned char VTK_TETRA = 10;
+constexpr unsigned char VTK_HEXAHEDRON = 12;
+
+struct BenchMesh {
+  std::string name;
+  std::vector<double> points;
+  std::vector<int64_t> connectivity;
+  std::vector<int64_t> offsets;
+  std::vector<unsigned char> types;
+  std::vector<double> pointField; // smooth analytic field
+  std::vector<double> cellField;  // uniform noise
+};
+
+void AddCell(BenchMesh &mesh, unsigned char type,
+             std::initializer_list<int64_t> ids) {
+  mesh.connectivity.insert(mesh.connectivity.end(), ids.begin(), ids.end());
+  mesh.offsets.push_back(static_cast<int64_t>(mesh.connectivity.size()));
+  mesh.types.push_back(type);
+}
+
+// n^3 hexahedra on a regular grid in natural order: the easy case for deflate.
+// With tets = true every hex is split into 5 tets, points are jittered and the
+// cell order is shuffled, which is closer to an unstructured solver's output.
+BenchMesh MakeMesh(int n, bool tets) {
+  BenchMesh mesh;
+  mesh.name = tets ? "tet-shuffled" : "hex-grid";
+  const int np = n + 1;
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> jitter(-0.2, 0.2);
+
+  for (int k = 0; k < np; ++k) {
+    for (int j = 0; j < np; ++j) {
+      for (int i = 0; i < np; ++i) {
+        const double dx = tets ? jitter(rng) : 0.0;
+        mesh.points.push_back((i + dx) / n);
+        mesh.points.push_back((j + dx) / n);
+        mesh.points.push_back((k + dx) / n);
+      }
+    }
+  }
+
+  auto id = [np](int i, int j, int k) {
+    return static_cast<int64_t>(i) + np * (static_cast<int64_t>(j) + np * k);
+  };
+  mesh.offsets.push_back(0);
+  for (int k = 0; k < n; ++k) {
+    for (int j = 0; j < n; ++j) {
+      for (int i = 0; i < n; ++i) {
+        const int64_t v0 = id(i, j, k), v1 = id(i + 1, j, k),
+                      v2 = id(i + 1, j + 1, k), v3 = id(i, j + 1, k),
+                      v4 = id(i, j, k + 1), v5 = id(i + 1, j, k + 1),
+                      v6 = id(i + 1, j + 1, k + 1), v7 = id(i, j + 1, k + 1);
+        if (!tets) {
+          AddCell(mesh, VTK_HEXAHEDRON, {v0, v1, v2, v3, v4, v5, v6, v7});
+        } else {
+          AddCell(mesh, VTK_TETRA, {v0, v1, v3, v4});
+          AddCell(mesh, VTK_TETRA, {v1, v2, v3, v6});
+          AddCell(mesh, VTK_TETRA, {v4, v5, v6, v1});
+          AddCell(mesh, VTK_TETRA, {v4, v6, v7, v3});
+          AddCell(mesh, VTK_TETRA, {v1, v3, v4, v6});
+        }
+      }
+    }
+  }
+
+  if (tets) {
+    // All cells have the same size, so shuffling whole cells keeps the offsets valid.
+    const size_t numCells = mesh.types.size();
+    std::vector<size_t> order(numCells);
+    for (size_t c = 0; c < numCells; ++c) {
+      order[c] = c;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<int64_t> shuffled(mesh.connectivity.size());
+    for (size_t c = 0; c < numCells; ++c) {
+      std::copy_n(mesh.connectivity.begin() + order[c] * 4, 4,
+                  shuffled.begin() + c * 4);
+    }
+    mesh.connectivity.swap(shuffled);
+  }
+
+  const size_t numPoints = mesh.points.size() / 3;
+  mesh.pointField.resize(numPoints);
+  for (size_t p = 0; p < numPoints; ++p) {
+    const double *x = &mesh.points[p * 3];
+    mesh.pointField[p] = std::sin(6.0 * x[0]) * std::cos(4.0 * x[1]) + x[2];
+  }
+  std::uniform_real_distribution<double> noise(0.0, 1.0);
+  mesh.cellField.resize(mesh.types.size());
+  for (double &v : mesh.cellField) {
+    v = noise(rng);
+  }
+  return mesh;
+}
+
+UnstructuredMeshInfo ToInfo(BenchMesh &mesh) {
+  UnstructuredMeshInfo info;
+  cgns_mesh_info_init(&info);
+  info.points = mesh.points.data();
+  info.num_points = static_cast<int64_t>(mesh.points.size() / 3);
+  info.connectivity = mesh.connectivity.data();
+  info.connectivity_size = static_cast<int64_t>(mesh.connectivity.size());
+  info.offsets = mesh.offsets.data();
+  info.num_cells = static_cast<int64_t>(mesh.types.size());
+  info.types = mesh.types.data();
+  info.use_64bit_ids = 1;
+  return info;
+}
+
+struct Sample {
+  double seconds = 0.0;
+  double bytes = 0.0;
+};
+
+void Check(int rc, const char *what) {
+  if (rc != 0) {
+    throw std::runtime_error(std::string(what) + ": " + cgns_get_last_error());
+  }
+}
+
+// Best-of-repeats wall time of write(), and the size of the file it produced.
+template <typename Fn>
+Sample Measure(const std::string &path, int repeats, Fn write) {
+  Sample s;
+  s.seconds = 1e30;
+  for (int r = 0; r < repeats; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    write();
+    const auto t1 = std::chrono::steady_clock::now();
+    s.seconds =
+        std::min(s.seconds, std::chrono::duration<double>(t1 - t0).count());
+  }
+  s.bytes = static_cast<double>(std::filesystem::file_size(path));
+  return s;
+}
+
+void PrintRow(const std::string &mesh, int level, const char *category,
+              double rawBytes, double storedBytes, double seconds) {
+  const double mb = 1024.0 * 1024.0;
+  // Differences of noisy timings can come out tiny or negative; clamp for display.
+  seconds = std::max(seconds, 1e-6);
+  storedBytes = std::max(storedBytes, 1.0);
+  std::printf("%-14s %5d  %-7s %10.1f %10.1f %7.2f %10.1f\n", mesh.c_str(),
+              level, category, rawBytes / mb, storedBytes / mb,
+              rawBytes / storedBytes, rawBytes / mb / seconds);
+}
+
+std::vector<int> ParseLevels(const std::string &text) {
+  std::vector<int> levels;
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    levels.push_back(std::stoi(item));
+  }
+  return levels;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+    std::cerr << "Usage: " << argv[0]
+              << " [cells_per_axis=64] [levels=0,1,4,9] [repeats=3] [outdir=.]\n";
+    return 0;
+  }
+  const int n = argc > 1 ? std::stoi(argv[1]) : 64;
+  const std::vector<int> levels = ParseLevels(argc > 2 ? argv[2] : "0,1,4,9");
+  const int repeats = argc > 3 ? std::max(1, std::stoi(argv[3])) : 3;
+  const std::filesystem::path outDir = argc > 4 ? argv[4] : ".";
+
+  std::printf("%-14s %5s  %-7s %10s %10s %7s %10s\n", "mesh", "level",
+              "data", "raw MB", "file MB", "ratio", "MB/s");
+
+  try {
+    for (bool tets : {false, true}) {
+      BenchMesh mesh = MakeMesh(n, tets);
+      UnstructuredMeshInfo info = ToInfo(mesh);
+
+      CgnsFieldInfo pointField = {"Smooth", CGNS_FIELD_FLOAT64, 1,
+                                  mesh.pointField.data(), 0};
+      CgnsFieldInfo cellField = {"Noise", CGNS_FIELD_FLOAT64, 1,
+                                 mesh.cellField.data(), 0};
+      UnstructuredMeshInfo withFields = info;
+      withFields.point_fields = &pointField;
+      withFields.num_point_fields = 1;
+      withFields.cell_fields = &cellField;
+      withFields.num_cell_fields = 1;
+
+      const double coordBytes = static_cast<double>(mesh.points.size() * sizeof(double));
+      const double connBytes =
+          static_cast<double>(mesh.connectivity.size() * sizeof(cgsize_t));
+      const double fieldBytes = static_cast<double>(
+          (mesh.pointField.size() + mesh.cellField.size()) * sizeof(double));
+
+      for (int level : levels) {
+        CgnsWriteOptions options;
+        cgns_write_options_init(&options);
+        options.use_hdf5 = 1;
+        options.compression_level = level;
+
+        const std::string stem =
+            (outDir / (mesh.name + "_z" + std::to_string(level))).string();
+        const std::string coordsPath = stem + "_coords.cgns";
+        const std::string meshPath = stem + "_mesh.cgns";
+        const std::string fieldsPath = stem + "_fields.cgns";
+
+        const Sample coords = Measure(coordsPath, repeats, [&] {
+          CgnsSession *session = nullptr;
+          Check(cgns_session_open(coordsPath.c_str(), &options, 3, &session),
+                "cgns_session_open");
+          const int64_t node = 0;
+          int rc = cgns_session_define_zone(session, nullptr, info.num_points, 1);
+          rc = rc ? rc : cgns_session_define_section(session, VTK_VERTEX, 1);
+          rc = rc ? rc : cgns_session_append_coords(session, mesh.points.data(), info.num_points);
+          rc = rc ? rc : cgns_session_append_elements(session, VTK_VERTEX, &node, 1, 1);
+          const int closeRc = cgns_session_close(session);
+          Check(rc ? rc : closeRc, "coords session");
+        });
+        const Sample meshOnly = Measure(meshPath, repeats, [&] {
+          Check(cgns_write_unstructured(&info, meshPath.c_str(), &options),
+                "cgns_write_unstructured");
+        });
+        const Sample full = Measure(fieldsPath, repeats, [&] {
+          Check(cgns_write_unstructured(&withFields, fieldsPath.c_str(), &options),
+                "cgns_write_unstructured(fields)");
+        });
+
+        PrintRow(mesh.name, level, "coords", coordBytes, coords.bytes,
+                 coords.seconds);
+        PrintRow(mesh.name, level, "conn", connBytes,
+                 meshOnly.bytes - coords.bytes,
+                 meshOnly.seconds - coords.seconds);
+        PrintRow(mesh.name, level, "fields", fieldBytes,
+                 full.bytes - meshOnly.bytes, full.seconds - meshOnly.seconds);
+        PrintRow(mesh.name, level, "total", coordBytes + connBytes + fieldBytes,
+                 full.bytes, full.seconds);
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
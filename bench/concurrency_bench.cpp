@@ -0,0 +1,194 @@
+// Concurrency benchmark for cgns_writer_dll.
+//
+// Every thread exports its own partition to its own file with
+// cgns_write_unstructured, the way a partitioned solver writes per-rank
+// output. The same partitions are first written one after another from a
+// single thread, then from N threads at once; the aggregate throughput of
+// the two runs shows how much of the per-call work overlaps while libcgns
+// itself is serialised inside the library.
+
+#include "CgnsWriterExport.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr unsigned char VTK_HEXAHEDRON = 12;
+
+struct Partition {
+  std::vector<double> points;
+  std::vector<int64_t> connectivity;
+  std::vector<int64_t> offsets;
+  std::vector<unsigned char> types;
+  std::vector<double> pressure; // point field
+  std::vector<double> velocity; // cell field, 3 components
+  CgnsFieldInfo pointField = {};
+  CgnsFieldInfo cellField = {};
+  UnstructuredMeshInfo info = {};
+  std::string path;
+};
+
+// n^3 hexahedra shifted along z by `rank`, so the partitions tile a column.
+void MakePartition(Partition &part, int n, int rank) {
+  const int np = n + 1;
+  for (int k = 0; k < np; ++k) {
+    for (int j = 0; j < np; ++j) {
+      for (int i = 0; i < np; ++i) {
+        part.points.push_back(static_cast<double>(i) / n);
+        part.points.push_back(static_cast<double>(j) / n);
+        part.points.push_back(static_cast<double>(k) / n + rank);
+      }
+    }
+  }
+  auto id = [np](int i, int j, int k) {
+    return static_cast<int64_t>(i) + np * (static_cast<int64_t>(j) + np * k);
+  };
+  part.offsets.push_back(0);
+  for (int k = 0; k < n; ++k) {
+    for (int j = 0; j < n; ++j) {
+      for (int i = 0; i < n; ++i) {
+        const int64_t ids[8] = {id(i, j, k),         id(i + 1, j, k),
+                                id(i + 1, j + 1, k), id(i, j + 1, k),
+                                id(i, j, k + 1),     id(i + 1, j, k + 1),
+                                id(i + 1, j + 1, k + 1), id(i, j + 1, k + 1)};
+        part.connectivity.insert(part.connectivity.end(), ids, ids + 8);
+        part.offsets.push_back(static_cast<int64_t>(part.connectivity.size()));
+        part.types.push_back(VTK_HEXAHEDRON);
+      }
+    }
+  }
+
+  const size_t numPoints = part.points.size() / 3;
+  part.pressure.resize(numPoints);
+  for (size_t p = 0; p < numPoints; ++p) {
+    part.pressure[p] = std::sin(part.points[p * 3]) + part.points[p * 3 + 2];
+  }
+  part.velocity.resize(part.types.size() * 3);
+  for (size_t c = 0; c < part.velocity.size(); ++c) {
+    part.velocity[c] = std::cos(0.001 * static_cast<double>(c));
+  }
+
+  part.pointField = {"Pressure", CGNS_FIELD_FLOAT64, 1, part.pressure.data(), 0};
+  part.cellField = {"Velocity", CGNS_FIELD_FLOAT64, 3, part.velocity.data(), 0};
+
+  UnstructuredMeshInfo &info = part.info;
+  cgns_mesh_info_init(&info);
+  info.points = part.points.data();
+  info.num_points = static_cast<int64_t>(numPoints);
+  info.connectivity = part.connectivity.data();
+  info.connectivity_size = static_cast<int64_t>(part.connectivity.size());
+  info.offsets = part.offsets.data();
+  info.num_cells = static_cast<int64_t>(part.types.size());
+  info.types = part.types.data();
+  info.use_64bit_ids = 1;
+  info.point_fields = &part.pointField;
+  info.num_point_fields = 1;
+  info.cell_fields = &part.cellField;
+  info.num_cell_fields = 1;
+}
+
+double RawBytes(const Partition &part) {
+  return static_cast<double>(part.points.size() * sizeof(double) +
+                             part.connectivity.size() * sizeof(int64_t) +
+                             (part.pressure.size() + part.velocity.size()) *
+                                 sizeof(double));
+}
+
+// Writes partitions [0, parts.size()) with `threads` threads, each taking the
+// next unwritten partition; returns the wall time in seconds.
+double WriteAll(std::vector<Partition> &parts, int threads,
+                const CgnsWriteOptions &options) {
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::string firstError;
+  std::atomic_flag errorTaken = ATOMIC_FLAG_INIT;
+
+  auto worker = [&] {
+    for (size_t p = next++; p < parts.size(); p = next++) {
+      if (cgns_write_unstructured(&parts[p].info, parts[p].path.c_str(),
+                                  &options) != 0) {
+        if (!errorTaken.test_and_set()) {
+          firstError = parts[p].path + ": " + cgns_get_last_error();
+        }
+        failed = true;
+      }
+    }
+  };
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (int t = 1; t < threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (std::thread &t : pool) {
+    t.join();
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+
+  if (failed) {
+    throw std::runtime_error(firstError);
+  }
+  return std::chrono::duration<double>(t1 - t0).count();
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")) {
+    std::cerr << "Usage: " << argv[0]
+              << " [threads=16] [cells_per_axis=48] [repeats=3] [outdir=.]\n";
+    return 0;
+  }
+  const int threads = argc > 1 ? std::max(1, std::stoi(argv[1])) : 16;
+  const int n = argc > 2 ? std::stoi(argv[2]) : 48;
+  const int repeats = argc > 3 ? std::max(1, std::stoi(argv[3])) : 3;
+  const std::filesystem::path outDir = argc > 4 ? argv[4] : ".";
+
+  std::vector<Partition> parts(static_cast<size_t>(threads));
+  double rawBytes = 0.0;
+  for (int r = 0; r < threads; ++r) {
+    Partition &part = parts[static_cast<size_t>(r)];
+    MakePartition(part, n, r);
+    part.path = (outDir / ("part_" + std::to_string(r) + ".cgns")).string();
+    rawBytes += RawBytes(part);
+  }
+
+  // One thread per call: all parallelism comes from the concurrent callers.
+  CgnsWriteOptions options;
+  cgns_write_options_init(&options);
+  options.use_hdf5 = 1;
+  options.num_threads = 1;
+
+  std::printf("%d partitions of %d^3 hexahedra, %.1f MB raw in total\n",
+              threads, n, rawBytes / (1024.0 * 1024.0));
+  std::printf("%-10s %8s %10s %10s %8s\n", "mode", "threads", "seconds",
+              "MB/s", "speedup");
+
+  try {
+    double serial = 1e30;
+    double concurrent = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+      serial = std::min(serial, WriteAll(parts, 1, options));
+      concurrent = std::min(concurrent, WriteAll(parts, threads, options));
+    }
+    const double mb = rawBytes / (1024.0 * 1024.0);
+    std::printf("%-10s %8d %10.3f %10.1f %8.2f\n", "serial", 1, serial,
+                mb / serial, 1.0);
+    std::printf("%-10s %8d %10.3f %10.1f %8.2f\n", "concurrent", threads,
+                concurrent, mb / concurrent, serial / concurrent);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
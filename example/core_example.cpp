@@ -48,7 +48,8 @@ struct MeshData {
 
 // Convert MeshData to UnstructuredMeshInfo
 UnstructuredMeshInfo MeshDataToInfo(const MeshData &mesh) {
-  UnstructuredMeshInfo info = {};
+  UnstructuredMeshInfo info;
+  cgns_mesh_info_init(&info);
   info.points = const_cast<double *>(mesh.points.data());
   info.num_points = mesh.num_points;
   info.num_cells = mesh.num_cells;
@@ -236,6 +237,9 @@ void PrintUsage(const char *programName) {
   std::cerr << "  --base-name <name>        Custom base name\n";
   std::cerr << "  --zone-name <name>        Custom zone name\n";
   std::cerr << "  --keep-ghost              Keep ghost cells\n";
+  std::cerr << "  --threads <n>             Section assembly threads (default: 1, -1 = all)\n";
+  std::cerr << "  --single                  Write coordinates as RealSingle\n";
+  std::cerr << "  --compress <0-9>          HDF5 deflate level (default: 0)\n";
   std::cerr << "  --version                 Show version information\n";
   std::cerr << "  --help                    Show this help message\n\n";
   std::cerr << "Examples:\n";
@@ -294,7 +298,8 @@ int ExampleCppAPI(const MeshData &mesh, const char *outputPath,
 void ExampleErrorHandling() {
   std::cout << "\n=== Error Handling Example ===\n";
 
-  UnstructuredMeshInfo invalidMesh = {};
+  UnstructuredMeshInfo invalidMesh;
+  cgns_mesh_info_init(&invalidMesh);
   invalidMesh.points = nullptr;
   invalidMesh.num_points = 0;
 
@@ -326,6 +331,9 @@ int main(int argc, char **argv) {
   std::string format = "hdf5";
   bool use64bit = true;
   bool skipGhostCells = true;
+  int numThreads = 1;
+  bool singlePrecision = false;
+  int compressionLevel = 0;
   std::string baseName;
   std::string zoneName;
   std::string inputPath;
@@ -351,6 +359,12 @@ int main(int argc, char **argv) {
       use64bit = true;
     } else if (arg == "--keep-ghost") {
       skipGhostCells = false;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      numThreads = std::stoi(argv[++i]);
+    } else if (arg == "--single") {
+      singlePrecision = true;
+    } else if (arg == "--compress" && i + 1 < argc) {
+      compressionLevel = std::stoi(argv[++i]);
     } else if (arg == "--base-name" && i + 1 < argc) {
       baseName = argv[++i];
     } else if (arg == "--zone-name" && i + 1 < argc) {
@@ -401,10 +415,17 @@ int main(int argc, char **argv) {
   }
 
   // Prepare options
-  CgnsWriteOptions options = {};
+  CgnsWriteOptions options;
+  cgns_write_options_init(&options);
   options.use_hdf5 = (format == "hdf5") ? 1 : 0;
   options.base_name = baseName.empty() ? nullptr : baseName.c_str();
   options.zone_name = zoneName.empty() ? nullptr : zoneName.c_str();
+  options.num_threads = numThreads;
+  double maxPrecisionLoss = 0.0;
+  options.coord_precision =
+      singlePrecision ? CGNS_PRECISION_SINGLE : CGNS_PRECISION_DOUBLE;
+  options.max_precision_loss = singlePrecision ? &maxPrecisionLoss : nullptr;
+  options.compression_level = compressionLevel;
 
   // Show version info
   ExampleVersionInfo();
@@ -415,6 +436,9 @@ int main(int argc, char **argv) {
   std::cout << "Cells: " << mesh.num_cells << "\n";
   std::cout << "Index size: " << (use64bit ? "64-bit" : "32-bit") << "\n";
   std::cout << "Format: " << format << "\n";
+  std::cout << "Threads: " << numThreads << "\n";
+  std::cout << "Precision: " << (singlePrecision ? "single" : "double") << "\n";
+  std::cout << "Compression level: " << compressionLevel << "\n";
   if (!baseName.empty()) {
     std::cout << "Base name: " << baseName << "\n";
   }
@@ -463,6 +487,10 @@ int main(int argc, char **argv) {
     }
   }
 
+  if (singlePrecision) {
+    std::cout << "Max coordinate rounding error: " << maxPrecisionLoss << "\n";
+  }
+
   // Demonstrate error handling
   ExampleErrorHandling();
 
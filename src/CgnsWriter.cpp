@@ -1,71 +1,73 @@
 #include "CgnsWriter.h"
+#include "CgnsWriterConnectivity.h"
+#include "CgnsWriterNodeOrder.h"
+#include "CgnsWriterOutput.h"
+#include "CgnsWriterPhaseTimer.h"
+#include "CgnsWriterPolyhedra.h"
+#include "CgnsWriterReorder.h"
+#include "CgnsWriterTrace.h"
 
 #include <cgnslib.h>
 
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include <chrono>
-#include <fstream>
-#include <sstream>
+
+// cg_coord_general_write (memory-strided I/O) is available from CGNS 4.0.
+#if defined(CGNS_VERSION) && CGNS_VERSION >= 4000
+#  define CGNS_WRITER_HAVE_GENERAL_WRITE 1
+#else
+#  define CGNS_WRITER_HAVE_GENERAL_WRITE 0
+#endif
 
 // VTK
+#include <vtkArrayDispatch.h>
 #include <vtkCell.h>
+#include <vtkCellArray.h>
 #include <vtkCellData.h>
 #include <vtkCompositeDataIterator.h>
 #include <vtkCompositeDataSet.h>
 #include <vtkDataArray.h>
+#include <vtkDataArrayRange.h>
 #include <vtkDataObject.h>
 #include <vtkDataSet.h>
 #include <vtkDataSetAttributes.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
 #include <vtkIdList.h>
 #include <vtkImageData.h>
+#include <vtkMatrix3x3.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPointSet.h>
 #include <vtkPoints.h>
+#include <vtkPolyData.h>
 #include <vtkRectilinearGrid.h>
+#include <vtkSMPTools.h>
 #include <vtkSmartPointer.h>
 #include <vtkStructuredGrid.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
 #include <vtkUnsignedCharArray.h>
+#include <vtkUnstructuredGrid.h>
 
 namespace
 {
-int64_t NowMs()
-{
-  using clock = std::chrono::system_clock;
-  const auto now = clock::now().time_since_epoch();
-  return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
-}
-
-std::string EscapeJson(const std::string& s)
-{
-  std::string out;
-  out.reserve(s.size());
-  for (char ch : s)
-  {
-    if (ch == '\\' || ch == '"')
-    {
-      out.push_back('\\');
-    }
-    out.push_back(ch);
-  }
-  return out;
-}
-
-void DebugLog(const char* location, const char* message, const std::string& dataJson, const char* hypothesisId)
-{
-  std::ofstream out("c:\\Users\\line2\\project\\StandaloneCgnsWriter\\.cursor\\debug.log", std::ios::app);
-  if (!out)
-  {
-    return;
-  }
-  out << "{\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"" << hypothesisId
-      << "\",\"location\":\"" << location << "\",\"message\":\"" << message << "\",\"data\":"
-      << dataJson << ",\"timestamp\":" << NowMs() << "}\n";
-}
+namespace phase = cgns_writer::phase;
+namespace connectivity = cgns_writer::connectivity;
+using cgns_writer::output::DataTypeSize;
+using cgns_writer::output::RoundToSingle;
 
 void CheckCg(const int ierr, const std::string& what)
 {
@@ -85,15 +87,9 @@ int InferPhysicalDim(vtkDataSet* ds)
   vtkPointSet* ps = ds ? vtkPointSet::SafeDownCast(ds) : nullptr;
   vtkPoints* pts = ps ? ps->GetPoints() : nullptr;
   const int comps = (pts && pts->GetData()) ? pts->GetData()->GetNumberOfComponents() : 0;
-  // #region agent log
-  {
-    const std::string cls = ds ? EscapeJson(ds->GetClassName()) : "null";
-    std::ostringstream data;
-    data << "{\"dsClass\":\"" << cls << "\",\"hasPointSet\":" << (ps ? 1 : 0)
-         << ",\"hasPointsData\":" << ((pts && pts->GetData()) ? 1 : 0) << ",\"components\":" << comps << "}";
-    DebugLog("CgnsWriter.cpp:InferPhysicalDim", "points-metadata", data.str(), "H1");
-  }
-  // #endregion
+  CGNS_TRACE_SPAN(span, "InferPhysicalDim");
+  CGNS_TRACE_ARG(span, "dsClass", ds ? ds->GetClassName() : nullptr);
+  CGNS_TRACE_ARG(span, "components", static_cast<int64_t>(comps));
   if (!ds || !pts || !pts->GetData())
   {
     return 3;
@@ -101,26 +97,6 @@ int InferPhysicalDim(vtkDataSet* ds)
   return (comps >= 3) ? 3 : std::max(1, comps);
 }
 
-int InferCellDim(vtkDataSet* ds)
-{
-  if (!ds)
-  {
-    return 3;
-  }
-  int cellDim = 0;
-  const vtkIdType nCells = ds->GetNumberOfCells();
-  for (vtkIdType cid = 0; cid < nCells; ++cid)
-  {
-    vtkCell* cell = ds->GetCell(cid);
-    if (cell)
-    {
-      cellDim = std::max(cellDim, cell->GetCellDimension());
-    }
-  }
-  // If the dataset is empty, default to 3 (most CFD/FEA use cases).
-  return (cellDim > 0) ? cellDim : 3;
-}
-
 struct ZoneInput
 {
   vtkSmartPointer<vtkDataSet> ds;
@@ -163,64 +139,21 @@ std::vector<ZoneInput> FlattenToZones(vtkDataObject* input, const CgnsWriterOpti
   return zones;
 }
 
-struct Coords
-{
-  std::vector<double> x, y, z;
-};
-
-// Expand coordinates for structured grids into flat arrays (i-fastest, then j, then k)
-Coords GetStructuredCoords(vtkDataSet* ds, const int dims[3], const int physDim)
+// Expand coordinates for structured grids into out: x, then y, then z, each i-fastest, then j, then k.
+// Images and rectilinear grids normally take the separable path (GetSeparableCoords) instead.
+void GetStructuredCoords(vtkDataSet* ds, const int dims[3], const int physDim, double* out)
 {
   const vtkIdType npts = static_cast<vtkIdType>(dims[0]) * dims[1] * dims[2];
-  Coords c;
-  c.x.resize(npts);
-  c.y.resize(npts);
-  c.z.resize(npts);
-
-  if (auto* rg = vtkRectilinearGrid::SafeDownCast(ds))
-  {
-    // #region agent log
-    {
-      std::ostringstream data;
-      data << "{\"branch\":\"rectilinear\",\"dims\":[" << dims[0] << "," << dims[1] << "," << dims[2] << "]}";
-      DebugLog("CgnsWriter.cpp:GetStructuredCoords", "branch-selected", data.str(), "H2");
-    }
-    // #endregion
-    vtkDataArray* xa = rg->GetXCoordinates();
-    vtkDataArray* ya = rg->GetYCoordinates();
-    vtkDataArray* za = rg->GetZCoordinates();
-
-    for (int k = 0; k < dims[2]; ++k)
-    {
-      const double z = (physDim >= 3 && za) ? za->GetComponent(k, 0) : 0.0;
-      for (int j = 0; j < dims[1]; ++j)
-      {
-        const double y = (physDim >= 2 && ya) ? ya->GetComponent(j, 0) : 0.0;
-        for (int i = 0; i < dims[0]; ++i)
-        {
-          const double x = xa ? xa->GetComponent(i, 0) : 0.0;
-          const vtkIdType idx = static_cast<vtkIdType>(i + dims[0] * (j + dims[1] * k));
-          c.x[idx] = x;
-          c.y[idx] = y;
-          c.z[idx] = z;
-        }
-      }
-    }
-    return c;
-  }
+  CGNS_TRACE_SPAN(span, "GetStructuredCoords");
+  CGNS_TRACE_ARG(span, "npts", static_cast<int64_t>(npts));
+  double* x = out;
+  double* y = x + npts;
+  double* z = y + npts;
 
-  // vtkImageData / vtkStructuredGrid: just read points in VTK order
+  // Read points in VTK order
   vtkPointSet* ps = ds ? vtkPointSet::SafeDownCast(ds) : nullptr;
   vtkPoints* pts = ps ? ps->GetPoints() : nullptr;
-  // #region agent log
-  {
-    const std::string cls = ds ? EscapeJson(ds->GetClassName()) : "null";
-    std::ostringstream data;
-    data << "{\"branch\":\"pointset-or-getpoint\",\"dsClass\":\"" << cls << "\",\"hasPointSet\":"
-         << (ps ? 1 : 0) << ",\"hasPoints\":" << (pts ? 1 : 0) << ",\"npts\":" << npts << "}";
-    DebugLog("CgnsWriter.cpp:GetStructuredCoords", "branch-selected", data.str(), "H1");
-  }
-  // #endregion
+  CGNS_TRACE_ARG(span, "branch", pts ? "points" : "GetPoint");
 
   double p[3] = { 0, 0, 0 };
   for (vtkIdType id = 0; id < npts; ++id)
@@ -233,42 +166,31 @@ Coords GetStructuredCoords(vtkDataSet* ds, const int dims[3], const int physDim)
     {
       ds->GetPoint(id, p);
     }
-    c.x[id] = p[0];
-    c.y[id] = (physDim >= 2) ? p[1] : 0.0;
-    c.z[id] = (physDim >= 3) ? p[2] : 0.0;
+    x[id] = p[0];
+    y[id] = (physDim >= 2) ? p[1] : 0.0;
+    z[id] = (physDim >= 3) ? p[2] : 0.0;
   }
-  return c;
 }
 
-Coords GetUnstructuredCoords(vtkDataSet* ds, const int physDim)
+// Same for the points of an unstructured dataset; out holds 3 * ds->GetNumberOfPoints() values.
+void GetUnstructuredCoords(vtkDataSet* ds, const int physDim, double* out)
 {
-  Coords c;
-  if (!ds)
-  {
-    return c;
-  }
   const vtkIdType npts = ds->GetNumberOfPoints();
-  // #region agent log
-  {
-    const std::string cls = ds ? EscapeJson(ds->GetClassName()) : "null";
-    std::ostringstream data;
-    data << "{\"dsClass\":\"" << cls << "\",\"npts\":" << npts << "}";
-    DebugLog("CgnsWriter.cpp:GetUnstructuredCoords", "unstructured-coords", data.str(), "H3");
-  }
-  // #endregion
-  c.x.resize(npts);
-  c.y.resize(npts);
-  c.z.resize(npts);
+  CGNS_TRACE_SPAN(span, "GetUnstructuredCoords");
+  CGNS_TRACE_ARG(span, "dsClass", ds->GetClassName());
+  CGNS_TRACE_ARG(span, "npts", static_cast<int64_t>(npts));
+  double* x = out;
+  double* y = x + npts;
+  double* z = y + npts;
 
   double p[3] = { 0, 0, 0 };
   for (vtkIdType id = 0; id < npts; ++id)
   {
     ds->GetPoint(id, p);
-    c.x[id] = p[0];
-    c.y[id] = (physDim >= 2) ? p[1] : 0.0;
-    c.z[id] = (physDim >= 3) ? p[2] : 0.0;
+    x[id] = p[0];
+    y[id] = (physDim >= 2) ? p[1] : 0.0;
+    z[id] = (physDim >= 3) ? p[2] : 0.0;
   }
-  return c;
 }
 
 struct Section
@@ -277,8 +199,12 @@ struct Section
   std::string name;
   int nodesPerElem = 0;
 
-  std::vector<vtkIdType> vtkCellIds;
+  std::vector<vtkIdType> vtkCellIds; // empty for MIXED and NFACE_n, which keep the cell order
   std::vector<cgsize_t> conn;
+  std::vector<cgsize_t> offsets; // MIXED/NGON_n/NFACE_n only: start of each element in conn, then conn.size()
+  // conn and offsets as 32-bit integers once NarrowSections has moved them here; conn and offsets are then empty.
+  std::vector<int32_t> conn32;
+  std::vector<int32_t> offsets32;
 
   cgsize_t start = 0;
   cgsize_t end = 0;
@@ -321,6 +247,56 @@ bool MapVtkCellToCgns(const int vtkCellType, CGNS_ENUMT(ElementType_t)& outType,
       outType = CGNS_ENUMV(HEXA_8);
       outNodes = 8;
       return true;
+    // Quadratic cells; CgnsWriterNodeOrder.h puts their nodes in CGNS order.
+    case VTK_QUADRATIC_EDGE:
+      outType = CGNS_ENUMV(BAR_3);
+      outNodes = 3;
+      return true;
+    case VTK_QUADRATIC_TRIANGLE:
+      outType = CGNS_ENUMV(TRI_6);
+      outNodes = 6;
+      return true;
+    case VTK_QUADRATIC_QUAD:
+      outType = CGNS_ENUMV(QUAD_8);
+      outNodes = 8;
+      return true;
+    case VTK_BIQUADRATIC_QUAD:
+      outType = CGNS_ENUMV(QUAD_9);
+      outNodes = 9;
+      return true;
+    case VTK_QUADRATIC_TETRA:
+      outType = CGNS_ENUMV(TETRA_10);
+      outNodes = 10;
+      return true;
+    case VTK_QUADRATIC_PYRAMID:
+      outType = CGNS_ENUMV(PYRA_13);
+      outNodes = 13;
+      return true;
+    case VTK_QUADRATIC_WEDGE:
+      outType = CGNS_ENUMV(PENTA_15);
+      outNodes = 15;
+      return true;
+    case VTK_BIQUADRATIC_QUADRATIC_WEDGE:
+      outType = CGNS_ENUMV(PENTA_18);
+      outNodes = 18;
+      return true;
+    case VTK_QUADRATIC_HEXAHEDRON:
+      outType = CGNS_ENUMV(HEXA_20);
+      outNodes = 20;
+      return true;
+    case VTK_TRIQUADRATIC_HEXAHEDRON:
+      outType = CGNS_ENUMV(HEXA_27);
+      outNodes = 27;
+      return true;
+    // Variable node counts (outNodes = 0): a polygon lists its nodes, a polyhedron its points.
+    case VTK_POLYGON:
+      outType = CGNS_ENUMV(NGON_n);
+      outNodes = 0;
+      return true;
+    case VTK_POLYHEDRON:
+      outType = CGNS_ENUMV(NFACE_n);
+      outNodes = 0;
+      return true;
     default:
       return false;
   }
@@ -346,6 +322,32 @@ std::string DefaultSectionName(CGNS_ENUMT(ElementType_t) t)
       return "Wedges";
     case CGNS_ENUMV(HEXA_8):
       return "Hexes";
+    case CGNS_ENUMV(BAR_3):
+      return "Bars3";
+    case CGNS_ENUMV(TRI_6):
+      return "Tris6";
+    case CGNS_ENUMV(QUAD_8):
+      return "Quads8";
+    case CGNS_ENUMV(QUAD_9):
+      return "Quads9";
+    case CGNS_ENUMV(TETRA_10):
+      return "Tets10";
+    case CGNS_ENUMV(PYRA_13):
+      return "Pyrs13";
+    case CGNS_ENUMV(PENTA_15):
+      return "Wedges15";
+    case CGNS_ENUMV(PENTA_18):
+      return "Wedges18";
+    case CGNS_ENUMV(HEXA_20):
+      return "Hexes20";
+    case CGNS_ENUMV(HEXA_27):
+      return "Hexes27";
+    case CGNS_ENUMV(MIXED):
+      return "Mixed";
+    case CGNS_ENUMV(NGON_n):
+      return "Polygons";
+    case CGNS_ENUMV(NFACE_n):
+      return "Polyhedra";
     default:
       return "Elements";
   }
@@ -361,390 +363,2082 @@ vtkUnsignedCharArray* GetGhostCellArray(vtkDataSet* ds)
   return vtkUnsignedCharArray::SafeDownCast(ghost);
 }
 
-void WriteCoords(int fn, int B, int Z, const Coords& c)
+CGNS_ENUMT(DataType_t) PrecisionType(const CgnsPrecision precision)
 {
-  int Cx = 0, Cy = 0, Cz = 0;
-  CheckCg(cg_coord_write(fn, B, Z, CGNS_ENUMV(RealDouble), "CoordinateX", c.x.data(), &Cx),
-          "cg_coord_write(CoordinateX)");
-  CheckCg(cg_coord_write(fn, B, Z, CGNS_ENUMV(RealDouble), "CoordinateY", c.y.data(), &Cy),
-          "cg_coord_write(CoordinateY)");
-  CheckCg(cg_coord_write(fn, B, Z, CGNS_ENUMV(RealDouble), "CoordinateZ", c.z.data(), &Cz),
-          "cg_coord_write(CoordinateZ)");
+  return cgns_writer::output::RealType(precision == CgnsPrecision::Single);
 }
 
-std::string ComponentSuffix(const int c)
+// The components of one array in their file type, stored one after another (numValues
+// each) and ready for cg_coord_write or cg_field_write. Building one does not call libcgns.
+struct PreparedArray
 {
-  // Common convention
-  static const char* names[] = { "X", "Y", "Z", "W" };
-  if (c >= 0 && c < 4)
+  CGNS_ENUMT(DataType_t) type = CGNS_ENUMV(RealDouble);
+  std::vector<std::string> names; // node name of each component
+  size_t numValues = 0;
+  std::vector<double> reals;
+  std::vector<float> singles;
+  std::vector<int32_t> integers;
+  std::vector<int64_t> longIntegers;
+
+  const void* Component(const int c) const
   {
-    return names[c];
+    const size_t offset = static_cast<size_t>(c) * numValues;
+    switch (type)
+    {
+      case CGNS_ENUMV(RealSingle):
+        return singles.data() + offset;
+      case CGNS_ENUMV(Integer):
+        return integers.data() + offset;
+      case CGNS_ENUMV(LongInteger):
+        return longIntegers.data() + offset;
+      default:
+        return reals.data() + offset;
+    }
   }
-  return "C" + std::to_string(c);
-}
 
-void WriteFlowSolutionPointData(int fn, int B, int Z, vtkDataSet* ds)
-{
-  vtkPointData* pd = ds->GetPointData();
-  if (!pd)
+  int64_t Bytes() const
   {
-    return;
+    return static_cast<int64_t>(reals.size() * sizeof(double) + singles.size() * sizeof(float) +
+                                integers.size() * sizeof(int32_t) + longIntegers.size() * sizeof(int64_t));
   }
+};
 
-  int solId = 0;
-  CheckCg(cg_sol_write(fn, B, Z, "PointData", CGNS_ENUMV(Vertex), &solId), "cg_sol_write(PointData)");
-
-  const vtkIdType npts = ds->GetNumberOfPoints();
-
-  for (int ai = 0; ai < pd->GetNumberOfArrays(); ++ai)
+// Rounds the reals of a RealSingle array into its singles and releases them.
+void RoundToFileType(PreparedArray& a, double* maxLoss)
+{
+  if (a.type != CGNS_ENUMV(RealSingle) || a.reals.empty())
   {
-    vtkDataArray* arr = pd->GetArray(ai);
-    if (!arr)
-    {
-      continue;
-    }
-    const char* aname = arr->GetName();
-    std::string baseName = aname ? aname : ("PointArray_" + std::to_string(ai));
-
-    const int ncomp = arr->GetNumberOfComponents();
-    for (int c = 0; c < ncomp; ++c)
-    {
-      std::string fieldName = (ncomp == 1) ? baseName : (baseName + "_" + ComponentSuffix(c));
-      std::vector<double> values(static_cast<size_t>(npts));
-
-      for (vtkIdType id = 0; id < npts; ++id)
-      {
-        values[static_cast<size_t>(id)] = arr->GetComponent(id, c);
-      }
-
-      int fldId = 0;
-      CheckCg(cg_field_write(fn, B, Z, solId, CGNS_ENUMV(RealDouble), fieldName.c_str(), values.data(),
-                             &fldId),
-              "cg_field_write(point:" + fieldName + ")");
-    }
+    return;
   }
+  a.singles.resize(a.reals.size());
+  RoundToSingle(a.reals.data(), 1, a.reals.size(), a.singles.data(), maxLoss);
+  std::vector<double>().swap(a.reals);
 }
 
-void WriteFlowSolutionCellData(int fn, int B, int Z, vtkDataSet* ds,
-                               const std::vector<cgsize_t>& cellToElem,
-                               const cgsize_t nCellsWritten)
+void WriteCoords(int fn, int B, int Z, const PreparedArray& coords)
 {
-  vtkCellData* cd = ds->GetCellData();
-  if (!cd)
+  const int64_t bytes = static_cast<int64_t>(coords.numValues) * DataTypeSize(coords.type);
+  for (size_t c = 0; c < coords.names.size(); ++c)
   {
-    return;
+    const phase::Scope timer("cg_coord_write", bytes);
+    int C = 0;
+    CheckCg(cg_coord_write(fn, B, Z, coords.type, coords.names[c].c_str(), coords.Component(static_cast<int>(c)), &C),
+            "cg_coord_write(" + coords.names[c] + ")");
   }
+}
 
-  int solId = 0;
-  CheckCg(cg_sol_write(fn, B, Z, "CellData", CGNS_ENUMV(CellCenter), &solId), "cg_sol_write(CellData)");
-
-  for (int ai = 0; ai < cd->GetNumberOfArrays(); ++ai)
-  {
-    vtkDataArray* arr = cd->GetArray(ai);
-    if (!arr)
-    {
-      continue;
-    }
-    const char* aname = arr->GetName();
-    std::string baseName = aname ? aname : ("CellArray_" + std::to_string(ai));
-
-    const int ncomp = arr->GetNumberOfComponents();
-    for (int c = 0; c < ncomp; ++c)
-    {
-      std::string fieldName = (ncomp == 1) ? baseName : (baseName + "_" + ComponentSuffix(c));
-      std::vector<double> values(static_cast<size_t>(nCellsWritten), 0.0);
-
-      const vtkIdType nCells = ds->GetNumberOfCells();
-      for (vtkIdType cid = 0; cid < nCells; ++cid)
-      {
-        const cgsize_t elem = cellToElem[static_cast<size_t>(cid)];
-        if (elem == 0)
-        {
-          continue; // skipped (e.g., ghost cell)
-        }
-        const size_t idx = static_cast<size_t>(elem - 1);
-        values[idx] = arr->GetComponent(cid, c);
-      }
-
-      int fldId = 0;
-      CheckCg(cg_field_write(fn, B, Z, solId, CGNS_ENUMV(RealDouble), fieldName.c_str(), values.data(),
-                             &fldId),
-              "cg_field_write(cell:" + fieldName + ")");
-    }
-  }
+// Writes a section that has offsets (MIXED, NGON_n, NFACE_n); see output::WritePolySection.
+void WritePolySection(int fn, int B, int Z, const Section& s, const int64_t bytes)
+{
+  using cgns_writer::output::kPolySectionCall;
+  int S = 0;
+  CheckCg(cgns_writer::output::WritePolySection(fn, B, Z, s, &S,
+                                                 [&] { return phase::Scope(kPolySectionCall, bytes); }),
+          std::string(kPolySectionCall) + "(" + s.name + ")");
 }
 
-void WriteZoneStructured(int fn, int B, const std::string& zoneName, vtkDataSet* ds,
-                         const CgnsWriterOptions& opt)
+// Returns the contiguous xyz buffer of a vtkPointSet's points and its memory type, or null
+// when the points are not a float/double array with 3 components or strided general writes
+// are not available.
+const void* InterleavedPoints(vtkDataSet* ds, CGNS_ENUMT(DataType_t)& memType)
 {
-  int dims[3] = { 1, 1, 1 };
-  if (auto* img = vtkImageData::SafeDownCast(ds))
-  {
-    img->GetDimensions(dims);
-  }
-  else if (auto* rg = vtkRectilinearGrid::SafeDownCast(ds))
+#if CGNS_WRITER_HAVE_GENERAL_WRITE
+  vtkPointSet* ps = vtkPointSet::SafeDownCast(ds);
+  vtkPoints* pts = ps ? ps->GetPoints() : nullptr;
+  vtkDataArray* data = pts ? pts->GetData() : nullptr;
+  if (!data || data->GetNumberOfComponents() != 3 || data->GetNumberOfTuples() <= 0)
   {
-    rg->GetDimensions(dims);
+    return nullptr;
   }
-  else if (auto* sg = vtkStructuredGrid::SafeDownCast(ds))
+  if (auto* d = vtkDoubleArray::FastDownCast(data))
   {
-    sg->GetDimensions(dims);
+    memType = CGNS_ENUMV(RealDouble);
+    return d->GetPointer(0);
   }
-  else
+  if (auto* f = vtkFloatArray::FastDownCast(data))
   {
-    throw std::runtime_error("Internal error: WriteZoneStructured called for non-structured dataset.");
+    memType = CGNS_ENUMV(RealSingle);
+    return f->GetPointer(0);
   }
+#else
+  (void)ds;
+  (void)memType;
+#endif
+  return nullptr;
+}
 
-  const int physDim = InferPhysicalDim(ds);
-  const int cellDim = (dims[2] > 1) ? 3 : ((dims[1] > 1) ? 2 : 1);
-
-  // CGNS expects sizes for structured zones: [nVertexI,nVertexJ,nVertexK,nCellI,nCellJ,nCellK,nBndI,nBndJ,nBndK]
-  cgsize_t size[9] = { 0 };
-  size[0] = dims[0];
-  size[1] = dims[1];
-  size[2] = dims[2];
-  size[3] = std::max(dims[0] - 1, 0);
-  size[4] = std::max(dims[1] - 1, 0);
-  size[5] = std::max(dims[2] - 1, 0);
-  size[6] = 0;
-  size[7] = 0;
-  size[8] = 0;
-
-  int Z = 0;
-  CheckCg(cg_zone_write(fn, B, zoneName.c_str(), size, CGNS_ENUMV(Structured), &Z),
-          "cg_zone_write(Structured)");
-
-  // Coords
-  Coords c = GetStructuredCoords(ds, dims, physDim);
-  WriteCoords(fn, B, Z, c);
-
-  // Solutions
-  if (opt.writePointData)
+// Writes the coordinates of a vtkPointSet straight from its interleaved xyz buffer
+// with strided general writes, instead of de-interleaving into three full arrays.
+// vertexSize holds the zone's vertex counts (the first index-dimension entries of the zone size).
+// Returns false when InterleavedPoints has no buffer for the dataset.
+bool WriteInterleavedPointSetCoords(int fn, int B, int Z, vtkDataSet* ds, const cgsize_t* vertexSize,
+                                    const CgnsWriterOptions& opt)
+{
+#if CGNS_WRITER_HAVE_GENERAL_WRITE
+  CGNS_ENUMT(DataType_t) memType = CGNS_ENUMV(RealDouble);
+  const void* ptr = InterleavedPoints(ds, memType);
+  if (!ptr)
   {
-    WriteFlowSolutionPointData(fn, B, Z, ds);
+    return false;
   }
 
-  if (opt.writeCellData)
+  static const char* names[3] = { "CoordinateX", "CoordinateY", "CoordinateZ" };
+  const cgsize_t npts = static_cast<cgsize_t>(ds->GetNumberOfPoints());
+  const CGNS_ENUMT(DataType_t) fileType = PrecisionType(opt.coordPrecision);
+
+  if (fileType == CGNS_ENUMV(RealSingle) && memType == CGNS_ENUMV(RealDouble))
   {
-    // Structured cell ordering in VTK matches the implicit ordering for CGNS in most practical cases.
-    const vtkIdType nCells = ds->GetNumberOfCells();
-    std::vector<cgsize_t> cellToElem(static_cast<size_t>(nCells), 0);
-    for (vtkIdType cid = 0; cid < nCells; ++cid)
+    // Round one component at a time: 4 bytes of scratch per point instead of 24.
+    std::vector<float> scratch(static_cast<size_t>(npts));
+    for (int c = 0; c < 3; ++c)
     {
-      cellToElem[static_cast<size_t>(cid)] = static_cast<cgsize_t>(cid + 1);
+      {
+        const phase::Scope timer("convert");
+        RoundToSingle(static_cast<const double*>(ptr) + c, 3, scratch.size(), scratch.data(), opt.maxPrecisionLoss);
+      }
+      const phase::Scope timer("cg_coord_write", static_cast<int64_t>(scratch.size() * sizeof(float)));
+      int C = 0;
+      CheckCg(cg_coord_write(fn, B, Z, fileType, names[c], scratch.data(), &C),
+              std::string("cg_coord_write(") + names[c] + ")");
     }
-    WriteFlowSolutionCellData(fn, B, Z, ds, cellToElem, static_cast<cgsize_t>(nCells));
+    return true;
   }
 
-  (void)cellDim; // currently only used for documentation/possible future extension
-  (void)physDim;
+  // Memory is viewed as a 3 x npts array; component c is the row [c+1, 1..npts].
+  const cgsize_t rmin[3] = { 1, 1, 1 };
+  const cgsize_t mDims[2] = { 3, npts };
+  for (int c = 0; c < 3; ++c)
+  {
+    const cgsize_t mMin[2] = { c + 1, 1 };
+    const cgsize_t mMax[2] = { c + 1, npts };
+    const phase::Scope timer("cg_coord_general_write", static_cast<int64_t>(npts) * DataTypeSize(fileType));
+    int C = 0;
+    CheckCg(cg_coord_general_write(fn, B, Z, names[c], fileType, rmin, vertexSize, memType, 2, mDims, mMin, mMax,
+                                   ptr, &C),
+            std::string("cg_coord_general_write(") + names[c] + ")");
+  }
+  return true;
+#else
+  (void)fn;
+  (void)B;
+  (void)Z;
+  (void)ds;
+  (void)vertexSize;
+  (void)opt;
+  return false;
+#endif
 }
 
-void WriteZoneUnstructured(int fn, int B, const std::string& zoneName, vtkDataSet* ds,
-                           const CgnsWriterOptions& opt)
+// Point coordinates of a vtkImageData or vtkRectilinearGrid, which are separable:
+// component c of point (i, j, k) is axis[c][0][i] + (axis[c][1][j] + axis[c][2][k]).
+struct SeparableCoords
 {
-  const int physDim = InferPhysicalDim(ds);
-
-  // Build element sections (group by CGNS element type)
-  std::vector<Section> sections;
-  std::unordered_map<int, size_t> typeToSectionIndex; // key: ElementType_t integer
-
-  vtkNew<vtkIdList> ptIds;
-  vtkUnsignedCharArray* ghost = opt.skipGhostCells ? GetGhostCellArray(ds) : nullptr;
-
-  const vtkIdType nCells = ds->GetNumberOfCells();
-  std::vector<cgsize_t> cellToElem(static_cast<size_t>(nCells), 0);
+  std::array<std::array<std::vector<double>, 3>, 3> axis; // [component][index direction]
+};
 
-  for (vtkIdType cid = 0; cid < nCells; ++cid)
+// Builds the per-axis terms from the origin, spacing and direction of an image, or from
+// the axis arrays of a rectilinear grid. Components at or above physDim are zero, as in
+// GetStructuredCoords. Returns false for other datasets.
+bool GetSeparableCoords(vtkDataSet* ds, const int dims[3], const int physDim, SeparableCoords& sc)
+{
+  for (int c = 0; c < 3; ++c)
   {
-    if (ghost && ghost->GetNumberOfTuples() == nCells)
+    for (int d = 0; d < 3; ++d)
     {
-      const unsigned char g = ghost->GetValue(cid);
-      if (g != 0)
-      {
-        continue;
-      }
-    }
-
-    const int vtkType = ds->GetCellType(cid);
-    CGNS_ENUMT(ElementType_t) cgnsType = CGNS_ENUMV(ElementTypeNull);
-    int nodesPerElem = 0;
-
-    if (!MapVtkCellToCgns(vtkType, cgnsType, nodesPerElem))
-    {
-      throw std::runtime_error("Unsupported VTK cell type " + std::to_string(vtkType) +
-                               " (only a minimal subset is implemented).");
-    }
-
-    ds->GetCellPoints(cid, ptIds);
-    if (ptIds->GetNumberOfIds() != nodesPerElem)
-    {
-      // Some VTK cell types can have variable size; we don't support that here.
-      throw std::runtime_error("Unexpected number of points for VTK cell type " + std::to_string(vtkType));
+      sc.axis[c][d].assign(static_cast<size_t>(std::max(dims[d], 0)), 0.0);
     }
+  }
 
-    const int key = static_cast<int>(cgnsType);
-    size_t sidx = 0;
-    auto it = typeToSectionIndex.find(key);
-    if (it == typeToSectionIndex.end())
-    {
-      Section s;
-      s.type = cgnsType;
-      s.nodesPerElem = nodesPerElem;
-      s.name = DefaultSectionName(cgnsType);
-      sections.push_back(std::move(s));
-      sidx = sections.size() - 1;
-      typeToSectionIndex[key] = sidx;
-    }
-    else
+  if (auto* img = vtkImageData::SafeDownCast(ds))
+  {
+    // Point (i, j, k) is origin + direction * ((extent min + (i, j, k)) * spacing), see
+    // vtkImageData::TransformIndexToPhysicalPoint. The origin goes into the k term, which
+    // keeps axis-aligned images bit-identical to vtkImageData::GetPoint.
+    int extent[6] = { 0, 0, 0, 0, 0, 0 };
+    double origin[3] = { 0.0, 0.0, 0.0 };
+    double spacing[3] = { 1.0, 1.0, 1.0 };
+    img->GetExtent(extent);
+    img->GetOrigin(origin);
+    img->GetSpacing(spacing);
+    vtkMatrix3x3* direction = img->GetDirectionMatrix();
+    for (int c = 0; c < std::min(physDim, 3); ++c)
     {
-      sidx = it->second;
+      for (int d = 0; d < 3; ++d)
+      {
+        const double m = (direction ? direction->GetElement(c, d) : (c == d ? 1.0 : 0.0)) * spacing[d];
+        std::vector<double>& terms = sc.axis[c][d];
+        for (size_t n = 0; n < terms.size(); ++n)
+        {
+          terms[n] = m * static_cast<double>(extent[2 * d] + static_cast<int>(n));
+        }
+      }
+      for (double& v : sc.axis[c][2])
+      {
+        v += origin[c];
+      }
     }
+    return true;
+  }
 
-    Section& s = sections[sidx];
-    s.vtkCellIds.push_back(cid);
-    for (int pi = 0; pi < nodesPerElem; ++pi)
+  if (auto* rg = vtkRectilinearGrid::SafeDownCast(ds))
+  {
+    vtkDataArray* axes[3] = { rg->GetXCoordinates(), rg->GetYCoordinates(), rg->GetZCoordinates() };
+    for (int c = 0; c < std::min(physDim, 3); ++c)
     {
-      cgsize_t id = static_cast<cgsize_t>(ptIds->GetId(pi));
-      if (opt.oneBasedConnectivity)
+      std::vector<double>& terms = sc.axis[c][c];
+      const vtkIdType n = axes[c] ? std::min(static_cast<vtkIdType>(terms.size()), axes[c]->GetNumberOfTuples()) : 0;
+      for (vtkIdType i = 0; i < n; ++i)
       {
-        id += 1;
+        terms[static_cast<size_t>(i)] = axes[c]->GetComponent(i, 0);
       }
-      s.conn.push_back(id);
     }
+    return true;
   }
+  return false;
+}
 
-  // Assign element ranges and build cell->element mapping
-  cgsize_t elem = 1;
-  for (auto& s : sections)
-  {
-    const cgsize_t ne = static_cast<cgsize_t>(s.vtkCellIds.size());
-    if (ne == 0)
+// Fills k-planes [k0, k1) of the three coordinate arrays, i fastest, in parallel over rows.
+void FillCoordSlab(const SeparableCoords& sc, const int dims[3], const int k0, const int k1, double* const out[3])
+{
+  const size_t ni = static_cast<size_t>(dims[0]);
+  const vtkIdType nj = dims[1];
+  vtkSMPTools::For(0, nj * (k1 - k0), [&](const vtkIdType begin, const vtkIdType end) {
+    for (int c = 0; c < 3; ++c)
     {
-      continue;
+      const double* iTerms = sc.axis[c][0].data();
+      const std::vector<double>& jTerms = sc.axis[c][1];
+      const std::vector<double>& kTerms = sc.axis[c][2];
+      for (vtkIdType r = begin; r < end; ++r)
+      {
+        const double offset = jTerms[static_cast<size_t>(r % nj)] + kTerms[static_cast<size_t>(k0 + r / nj)];
+        double* row = out[c] + static_cast<size_t>(r) * ni;
+        for (size_t i = 0; i < ni; ++i)
+        {
+          row[i] = iTerms[i] + offset;
+        }
+      }
     }
-    s.start = elem;
-    s.end = elem + ne - 1;
+  });
+}
 
-    for (cgsize_t i = 0; i < ne; ++i)
+// Writes the coordinates of a vtkImageData or vtkRectilinearGrid zone generated from its
+// implicit description instead of per-point GetPoint calls. With opt.coordSlabPlanes set,
+// the arrays are generated and written that many k-planes at a time with partial writes.
+// Returns false for other datasets.
+bool WriteImplicitStructuredCoords(int fn, int B, int Z, vtkDataSet* ds, const int dims[3], const int physDim,
+                                   const CgnsWriterOptions& opt)
+{
+  SeparableCoords sc;
+  {
+    const phase::Scope timer("convert");
+    if (!GetSeparableCoords(ds, dims, physDim, sc))
     {
-      const vtkIdType cid = s.vtkCellIds[static_cast<size_t>(i)];
-      cellToElem[static_cast<size_t>(cid)] = s.start + i;
+      return false;
     }
-
-    elem = s.end + 1;
   }
 
-  const cgsize_t nCellsWritten = elem - 1;
-  const cgsize_t nVerts = static_cast<cgsize_t>(ds->GetNumberOfPoints());
-
-  cgsize_t size[3] = { 0 };
-  size[0] = nVerts;
-  size[1] = nCellsWritten;
-  size[2] = 0;
-
-  int Z = 0;
-  CheckCg(cg_zone_write(fn, B, zoneName.c_str(), size, CGNS_ENUMV(Unstructured), &Z),
-          "cg_zone_write(Unstructured)");
-
-  // Coords
-  Coords c = GetUnstructuredCoords(ds, physDim);
-  WriteCoords(fn, B, Z, c);
+  static const char* names[3] = { "CoordinateX", "CoordinateY", "CoordinateZ" };
+  const CGNS_ENUMT(DataType_t) fileType = PrecisionType(opt.coordPrecision);
+  const int nk = std::max(dims[2], 1);
+  const int slab = (opt.coordSlabPlanes > 0 && opt.coordSlabPlanes < nk) ? opt.coordSlabPlanes : nk;
+  const size_t planeSize = static_cast<size_t>(std::max(dims[0], 0)) * static_cast<size_t>(std::max(dims[1], 0));
 
-  // Sections
-  for (auto& s : sections)
+  std::vector<double> values(3 * planeSize * static_cast<size_t>(slab));
+  double* const comps[3] = { values.data(), values.data() + values.size() / 3, values.data() + 2 * values.size() / 3 };
+  std::vector<float> scratch;
+  for (int k0 = 0; k0 < nk; k0 += slab)
   {
-    if (s.vtkCellIds.empty())
+    const int k1 = std::min(nk, k0 + slab);
+    const size_t count = planeSize * static_cast<size_t>(k1 - k0);
     {
-      continue;
+      const phase::Scope timer("convert");
+      FillCoordSlab(sc, dims, k0, k1, comps);
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+      const void* data = comps[c];
+      if (fileType == CGNS_ENUMV(RealSingle))
+      {
+        const phase::Scope timer("convert");
+        scratch.resize(count);
+        RoundToSingle(comps[c], 1, count, scratch.data(), opt.maxPrecisionLoss);
+        data = scratch.data();
+      }
+      const int64_t bytes = static_cast<int64_t>(count) * DataTypeSize(fileType);
+      int C = 0;
+      if (slab == nk)
+      {
+        const phase::Scope timer("cg_coord_write", bytes);
+        CheckCg(cg_coord_write(fn, B, Z, fileType, names[c], data, &C),
+                std::string("cg_coord_write(") + names[c] + ")");
+      }
+      else
+      {
+        const cgsize_t rmin[3] = { 1, 1, k0 + 1 };
+        const cgsize_t rmax[3] = { dims[0], dims[1], k1 };
+        const phase::Scope timer("cg_coord_partial_write", bytes);
+        CheckCg(cg_coord_partial_write(fn, B, Z, fileType, names[c], rmin, rmax, data, &C),
+                std::string("cg_coord_partial_write(") + names[c] + ")");
+      }
     }
-    int S = 0;
-    CheckCg(cg_section_write(fn, B, Z, s.name.c_str(), s.type, s.start, s.end, 0, s.conn.data(), &S),
-            "cg_section_write(" + s.name + ")");
   }
+  return true;
+}
 
-  // Solutions
-  if (opt.writePointData)
+// True when the coordinates of a zone are written straight from the dataset on the I/O
+// thread rather than prepared in a buffer: interleaved points (WriteInterleavedPointSetCoords)
+// and images or rectilinear grids written in slabs (WriteImplicitStructuredCoords).
+// dims is null for unstructured zones.
+bool CoordsWrittenDirectly(vtkDataSet* ds, const int* dims, const CgnsWriterOptions& opt)
+{
+  if (!dims && opt.reorder != CgnsReorder::None)
   {
-    WriteFlowSolutionPointData(fn, B, Z, ds);
+    return false; // renumbered points are gathered into a buffer
   }
-
-  if (opt.writeCellData)
+  CGNS_ENUMT(DataType_t) memType = CGNS_ENUMV(RealDouble);
+  if (InterleavedPoints(ds, memType))
   {
-    WriteFlowSolutionCellData(fn, B, Z, ds, cellToElem, nCellsWritten);
+    return true;
   }
+  return dims && (vtkImageData::SafeDownCast(ds) || vtkRectilinearGrid::SafeDownCast(ds)) &&
+         opt.coordSlabPlanes > 0 && opt.coordSlabPlanes < std::max(dims[2], 1);
 }
 
-bool IsStructured(vtkDataSet* ds)
-{
-  return vtkImageData::SafeDownCast(ds) != nullptr || vtkRectilinearGrid::SafeDownCast(ds) != nullptr ||
-         vtkStructuredGrid::SafeDownCast(ds) != nullptr;
-}
-
-} // end anon namespace
-
-void CgnsWriter::Write(vtkDataObject* input, const std::string& fileName, const CgnsWriterOptions& opt)
+// Builds the three coordinate arrays of a zone in the file precision. dims is null for
+// unstructured zones. With pointOrder (unstructured zones), vertex i is point pointOrder[i].
+// Makes no libcgns calls.
+PreparedArray PrepareCoords(vtkDataSet* ds, const int* dims, const int physDim, const CgnsPrecision precision,
+                            const int64_t* pointOrder, double* maxLoss)
 {
-  if (!input)
-  {
-    throw std::runtime_error("CgnsWriter::Write: input is null");
-  }
-  if (fileName.empty())
+  PreparedArray coords;
+  coords.type = PrecisionType(precision);
+  coords.names = { "CoordinateX", "CoordinateY", "CoordinateZ" };
+  coords.numValues = dims ? static_cast<size_t>(dims[0]) * static_cast<size_t>(dims[1]) * static_cast<size_t>(dims[2])
+                          : static_cast<size_t>(ds->GetNumberOfPoints());
+  coords.reals.resize(3 * coords.numValues);
+  double* const comps[3] = { coords.reals.data(), coords.reals.data() + coords.numValues,
+                             coords.reals.data() + 2 * coords.numValues };
+
+  SeparableCoords sc;
+  if (!dims)
   {
-    throw std::runtime_error("CgnsWriter::Write: fileName is empty");
+    GetUnstructuredCoords(ds, physDim, comps[0]);
   }
-
-  // Best-effort file type selection (only affects newly created files).
-#ifdef CG_FILE_HDF5
-  if (opt.useHdf5)
+  else if (GetSeparableCoords(ds, dims, physDim, sc))
   {
-    // If CGNS was built without HDF5 support, this may fail; ignore in that case.
-    (void)cg_set_file_type(CG_FILE_HDF5);
+    FillCoordSlab(sc, dims, 0, std::max(dims[2], 1), comps);
   }
   else
   {
-    (void)cg_set_file_type(CG_FILE_ADF);
+    GetStructuredCoords(ds, dims, physDim, comps[0]);
   }
-#endif
 
-  int fn = 0;
-  CheckCg(cg_open(fileName.c_str(), CG_MODE_WRITE, &fn), "cg_open");
-
-  try
+  if (pointOrder)
   {
-    // Zones to write
-    std::vector<ZoneInput> zones = FlattenToZones(input, opt);
-    if (zones.empty())
+    std::vector<double> input(coords.numValues);
+    for (double* comp : comps)
+    {
+      std::copy(comp, comp + coords.numValues, input.begin());
+      vtkSMPTools::For(0, static_cast<vtkIdType>(coords.numValues), [&](const vtkIdType begin, const vtkIdType end) {
+        for (vtkIdType i = begin; i < end; ++i)
+        {
+          comp[i] = input[static_cast<size_t>(pointOrder[i])];
+        }
+      });
+    }
+  }
+
+  const phase::Scope timer("convert");
+  RoundToFileType(coords, maxLoss);
+  return coords;
+}
+
+std::string ComponentSuffix(const int c)
+{
+  // Common convention
+  static const char* names[] = { "X", "Y", "Z", "W" };
+  if (c >= 0 && c < 4)
+  {
+    return names[c];
+  }
+  return "C" + std::to_string(c);
+}
+
+// True when every value of an unsigned 64-bit array fits in a LongInteger. Checked on the
+// (cached) component ranges as doubles, so values just below 2^63 may be rejected too.
+bool FitsLongInteger(vtkDataArray* array)
+{
+  const double limit = 9223372036854775808.0; // 2^63
+  for (int c = 0; c < array->GetNumberOfComponents(); ++c)
+  {
+    double range[2];
+    array->GetRange(range, c);
+    if (range[1] >= limit)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// File type of the fields of array: its own type when it has a CGNS equivalent and native
+// types are requested, otherwise real in the given precision.
+CGNS_ENUMT(DataType_t) FieldFileType(vtkDataArray* array, const CgnsPrecision precision, const bool nativeTypes)
+{
+  if (nativeTypes)
+  {
+    switch (array->GetDataType())
+    {
+      case VTK_FLOAT:
+        return CGNS_ENUMV(RealSingle);
+      case VTK_CHAR:
+      case VTK_SIGNED_CHAR:
+      case VTK_UNSIGNED_CHAR:
+      case VTK_SHORT:
+      case VTK_UNSIGNED_SHORT:
+      case VTK_INT:
+        return CGNS_ENUMV(Integer);
+      case VTK_UNSIGNED_INT:
+      case VTK_LONG:
+      case VTK_LONG_LONG:
+      case VTK_ID_TYPE:
+        return CGNS_ENUMV(LongInteger);
+      case VTK_UNSIGNED_LONG:
+        if (sizeof(unsigned long) < sizeof(int64_t) || FitsLongInteger(array))
+        {
+          return CGNS_ENUMV(LongInteger);
+        }
+        break;
+      case VTK_UNSIGNED_LONG_LONG:
+        if (FitsLongInteger(array))
+        {
+          return CGNS_ENUMV(LongInteger);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return PrecisionType(precision);
+}
+
+// Copies the first numTuples tuples of an array into out, which holds numValues values per
+// component, component after component. Tuple t goes to value elemOf[t] - 1, or to value t
+// when elemOf is null; tuples mapped to 0 (cells that are not written) are dropped.
+template <typename OutT>
+struct ComponentSplitter
+{
+  template <typename ArrayT>
+  void operator()(ArrayT* array, const vtkIdType numTuples, const cgsize_t* elemOf, const size_t numValues,
+                  OutT* out) const
+  {
+    const auto tuples = vtk::DataArrayTupleRange(array, 0, numTuples);
+    const int ncomp = tuples.GetTupleSize();
+    size_t t = 0;
+    for (const auto tuple : tuples)
+    {
+      const cgsize_t elem = elemOf ? elemOf[t] : static_cast<cgsize_t>(t + 1);
+      ++t;
+      if (elem == 0)
+      {
+        continue; // skipped (e.g., ghost cell)
+      }
+      OutT* dst = out + static_cast<size_t>(elem - 1);
+      for (int c = 0; c < ncomp; ++c)
+      {
+        dst[static_cast<size_t>(c) * numValues] = static_cast<OutT>(tuple[c]);
+      }
+    }
+  }
+};
+
+template <typename OutT>
+void SplitComponents(vtkDataArray* array, const vtkIdType numTuples, const cgsize_t* elemOf, const size_t numValues,
+                     std::vector<OutT>& out)
+{
+  out.assign(static_cast<size_t>(array->GetNumberOfComponents()) * numValues, OutT(0));
+  const ComponentSplitter<OutT> splitter;
+  if (!vtkArrayDispatch::Dispatch::Execute(array, splitter, numTuples, elemOf, numValues, out.data()))
+  {
+    // Array types outside the dispatch list are read through the vtkDataArray API.
+    splitter(array, numTuples, elemOf, numValues, out.data());
+  }
+}
+
+// Point or cell arrays of a zone and where their tuples go: tuple t becomes value
+// elemOf[t] - 1 (0 = not written), or value t when elemOf is null.
+struct FieldSource
+{
+  vtkDataSetAttributes* attrs = nullptr;
+  const char* solName = "";
+  CGNS_ENUMT(GridLocation_t) gridLocation = CGNS_ENUMV(Vertex);
+  const char* location = ""; // for error messages
+  const char* unnamedPrefix = "";
+  vtkIdType numTuples = 0;
+  const cgsize_t* elemOf = nullptr;
+  size_t numValues = 0;
+  CgnsPrecision precision = CgnsPrecision::Double;
+};
+
+// Converts array ai of a field source into its file type (see FieldFileType), one field per
+// component. Makes no libcgns calls.
+PreparedArray PrepareFieldArray(const FieldSource& src, const int ai, const CgnsWriterOptions& opt, double* maxLoss)
+{
+  vtkDataArray* arr = src.attrs->GetArray(ai);
+  PreparedArray out;
+  const char* aname = arr->GetName();
+  const std::string baseName = aname ? aname : (src.unnamedPrefix + std::to_string(ai));
+  const int ncomp = arr->GetNumberOfComponents();
+  for (int c = 0; c < ncomp; ++c)
+  {
+    out.names.push_back((ncomp == 1) ? baseName : (baseName + "_" + ComponentSuffix(c)));
+  }
+  out.type = FieldFileType(arr, src.precision, opt.nativeFieldTypes);
+  out.numValues = src.numValues;
+
+  // All components are converted in one pass over the tuples.
+  const phase::Scope convertTimer("convert");
+  const vtkIdType count = std::min(src.numTuples, arr->GetNumberOfTuples());
+  if (out.type == CGNS_ENUMV(Integer))
+  {
+    SplitComponents(arr, count, src.elemOf, src.numValues, out.integers);
+  }
+  else if (out.type == CGNS_ENUMV(LongInteger))
+  {
+    SplitComponents(arr, count, src.elemOf, src.numValues, out.longIntegers);
+  }
+  else if (out.type == CGNS_ENUMV(RealSingle) && arr->GetDataType() == VTK_FLOAT)
+  {
+    SplitComponents(arr, count, src.elemOf, src.numValues, out.singles);
+  }
+  else
+  {
+    SplitComponents(arr, count, src.elemOf, src.numValues, out.reals);
+    RoundToFileType(out, maxLoss);
+  }
+  return out;
+}
+
+// Converts every array of a field source, in attribute order.
+std::vector<PreparedArray> PrepareFields(const FieldSource& src, const CgnsWriterOptions& opt, double* maxLoss)
+{
+  std::vector<PreparedArray> fields;
+  if (!src.attrs)
+  {
+    return fields;
+  }
+  const phase::Scope timer("fields");
+  for (int ai = 0; ai < src.attrs->GetNumberOfArrays(); ++ai)
+  {
+    if (src.attrs->GetArray(ai))
+    {
+      fields.push_back(PrepareFieldArray(src, ai, opt, maxLoss));
+    }
+  }
+  return fields;
+}
+
+void WriteFields(int fn, int B, int Z, int solId, const char* location, const PreparedArray& field)
+{
+  const int64_t bytes = static_cast<int64_t>(field.numValues) * DataTypeSize(field.type);
+  for (size_t c = 0; c < field.names.size(); ++c)
+  {
+    const phase::Scope callTimer("cg_field_write", bytes);
+    int fldId = 0;
+    CheckCg(cg_field_write(fn, B, Z, solId, field.type, field.names[c].c_str(), field.Component(static_cast<int>(c)),
+                           &fldId),
+            std::string("cg_field_write(") + location + ":" + field.names[c] + ")");
+  }
+}
+
+// Writes a FlowSolution holding the arrays of src. prepared holds them already converted
+// (PrepareFields); when it is null each array is converted just before it is written, which
+// keeps a single array in memory at a time.
+void WriteSolution(int fn, int B, int Z, const FieldSource& src, const std::vector<PreparedArray>* prepared,
+                   const CgnsWriterOptions& opt)
+{
+  if (!src.attrs)
+  {
+    return;
+  }
+  const phase::Scope timer("fields");
+
+  int solId = 0;
+  {
+    const phase::Scope callTimer("cg_sol_write");
+    CheckCg(cg_sol_write(fn, B, Z, src.solName, src.gridLocation, &solId),
+            std::string("cg_sol_write(") + src.solName + ")");
+  }
+
+  if (prepared)
+  {
+    for (const PreparedArray& field : *prepared)
+    {
+      WriteFields(fn, B, Z, solId, src.location, field);
+    }
+    return;
+  }
+  for (int ai = 0; ai < src.attrs->GetNumberOfArrays(); ++ai)
+  {
+    if (src.attrs->GetArray(ai))
+    {
+      WriteFields(fn, B, Z, solId, src.location, PrepareFieldArray(src, ai, opt, opt.maxPrecisionLoss));
+    }
+  }
+}
+
+// pointToVertex maps points to their 1-based vertex when the zone is reordered; empty otherwise.
+FieldSource PointFields(vtkDataSet* ds, const std::vector<cgsize_t>& pointToVertex, const CgnsWriterOptions& opt)
+{
+  FieldSource src;
+  src.attrs = ds->GetPointData();
+  src.solName = "PointData";
+  src.gridLocation = CGNS_ENUMV(Vertex);
+  src.location = "point";
+  src.unnamedPrefix = "PointArray_";
+  src.numTuples = ds->GetNumberOfPoints();
+  src.elemOf = pointToVertex.empty() ? nullptr : pointToVertex.data();
+  src.numValues = static_cast<size_t>(src.numTuples);
+  src.precision = opt.pointDataPrecision;
+  return src;
+}
+
+// cellToElem maps cells to their 1-based element (0 = not written), or to their 1-based place
+// among the NFACE_n elements in polyhedral zones, whose NGON_n faces come first; it is empty
+// when cell t is value t, e.g. for structured zones.
+FieldSource CellFields(vtkDataSet* ds, const std::vector<cgsize_t>& cellToElem, const cgsize_t nCellsWritten,
+                       const CgnsWriterOptions& opt)
+{
+  FieldSource src;
+  src.attrs = ds->GetCellData();
+  src.solName = "CellData";
+  src.gridLocation = CGNS_ENUMV(CellCenter);
+  src.location = "cell";
+  src.unnamedPrefix = "CellArray_";
+  src.numTuples = cellToElem.empty() ? ds->GetNumberOfCells() : static_cast<vtkIdType>(cellToElem.size());
+  src.elemOf = cellToElem.empty() ? nullptr : cellToElem.data();
+  src.numValues = static_cast<size_t>(nCellsWritten);
+  src.precision = opt.cellDataPrecision;
+  return src;
+}
+
+bool IsStructured(vtkDataSet* ds)
+{
+  return vtkImageData::SafeDownCast(ds) != nullptr || vtkRectilinearGrid::SafeDownCast(ds) != nullptr ||
+         vtkStructuredGrid::SafeDownCast(ds) != nullptr;
+}
+
+// Point dimensions of an image, rectilinear or structured grid; false for other datasets.
+bool GetStructuredDimensions(vtkDataSet* ds, int dims[3])
+{
+  dims[0] = dims[1] = dims[2] = 1;
+  if (auto* img = vtkImageData::SafeDownCast(ds))
+  {
+    img->GetDimensions(dims);
+  }
+  else if (auto* rg = vtkRectilinearGrid::SafeDownCast(ds))
+  {
+    rg->GetDimensions(dims);
+  }
+  else if (auto* sg = vtkStructuredGrid::SafeDownCast(ds))
+  {
+    sg->GetDimensions(dims);
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+// Dimension of the cells of a CGNS element type.
+int ElementDimension(const CGNS_ENUMT(ElementType_t) t)
+{
+  switch (t)
+  {
+    case CGNS_ENUMV(NODE):
+      return 0;
+    case CGNS_ENUMV(BAR_2):
+    case CGNS_ENUMV(BAR_3):
+      return 1;
+    case CGNS_ENUMV(TRI_3):
+    case CGNS_ENUMV(TRI_6):
+    case CGNS_ENUMV(QUAD_4):
+    case CGNS_ENUMV(QUAD_8):
+    case CGNS_ENUMV(QUAD_9):
+    case CGNS_ENUMV(NGON_n):
+      return 2;
+    default:
+      return 3;
+  }
+}
+
+// Which vtkPolyData cell array a run of cells comes from; their VTK type follows from the cell size.
+enum class PolyKind
+{
+  None, // vtkUnstructuredGrid: types come from the cell-types array
+  Verts,
+  Lines,
+  Polys,
+  Strips
+};
+
+// The type vtkPolyData::GetCellType reports for a cell of n points.
+unsigned char PolyCellType(const PolyKind kind, const int64_t n)
+{
+  if (n == 0)
+  {
+    return VTK_EMPTY_CELL;
+  }
+  switch (kind)
+  {
+    case PolyKind::Verts:
+      return n == 1 ? VTK_VERTEX : VTK_POLY_VERTEX;
+    case PolyKind::Lines:
+      return n == 2 ? VTK_LINE : VTK_POLY_LINE;
+    case PolyKind::Polys:
+      return n == 3 ? VTK_TRIANGLE : (n == 4 ? VTK_QUAD : VTK_POLYGON);
+    default:
+      return VTK_TRIANGLE_STRIP;
+  }
+}
+
+// Calls fn(offsets, connectivity) with the typed storage of cells; false when the
+// storage is not the plain 32/64-bit layout.
+template <typename Fn>
+bool VisitCellArray(vtkCellArray* cells, Fn&& fn)
+{
+  if (cells->IsStorage64Bit())
+  {
+    vtkTypeInt64Array* offsets = cells->GetOffsetsArray64();
+    vtkTypeInt64Array* conn = cells->GetConnectivityArray64();
+    if (!offsets || !conn)
+    {
+      return false;
+    }
+    fn(offsets->GetPointer(0), conn->GetPointer(0));
+    return true;
+  }
+  vtkTypeInt32Array* offsets = cells->GetOffsetsArray32();
+  vtkTypeInt32Array* conn = cells->GetConnectivityArray32();
+  if (!offsets || !conn)
+  {
+    return false;
+  }
+  fn(offsets->GetPointer(0), conn->GetPointer(0));
+  return true;
+}
+
+// Consecutive cells of a vtkUnstructuredGrid or vtkPolyData stored in one vtkCellArray.
+struct CellRun
+{
+  vtkCellArray* cells;
+  const unsigned char* types; // null for polydata
+  PolyKind kind;
+};
+
+// The cell arrays holding the cells of ds, in cell order. False when ds is neither a
+// vtkUnstructuredGrid nor a vtkPolyData, or its storage cannot be read directly.
+bool GetCellRuns(vtkDataSet* ds, std::vector<CellRun>& runs)
+{
+  if (auto* ug = vtkUnstructuredGrid::SafeDownCast(ds))
+  {
+    vtkUnsignedCharArray* types = ug->GetCellTypesArray();
+    if (!ug->GetCells() || !types)
+    {
+      return false;
+    }
+    runs.push_back(CellRun{ ug->GetCells(), types->GetPointer(0), PolyKind::None });
+  }
+  else if (auto* pd = vtkPolyData::SafeDownCast(ds))
+  {
+    // vtkPolyData numbers its cells verts first, then lines, polys and strips.
+    runs.push_back(CellRun{ pd->GetVerts(), nullptr, PolyKind::Verts });
+    runs.push_back(CellRun{ pd->GetLines(), nullptr, PolyKind::Lines });
+    runs.push_back(CellRun{ pd->GetPolys(), nullptr, PolyKind::Polys });
+    runs.push_back(CellRun{ pd->GetStrips(), nullptr, PolyKind::Strips });
+  }
+  else
+  {
+    return false;
+  }
+  for (const CellRun& run : runs)
+  {
+    if (run.cells && run.cells->GetNumberOfCells() > 0 && !VisitCellArray(run.cells, [](const auto*, const auto*) {}))
+    {
+      runs.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+// Calls fn(cellId, vtkType, ids, numIds) for every cell of an unstructured zone that is not
+// flagged in ghost (may be null), in cell order. vtkUnstructuredGrid and vtkPolyData are read
+// straight from their cell arrays; other datasets go through GetCellType/GetCellPoints.
+template <typename Fn>
+void ForEachCell(vtkDataSet* ds, const unsigned char* ghost, Fn&& fn)
+{
+  std::vector<CellRun> runs;
+  if (GetCellRuns(ds, runs))
+  {
+    vtkIdType firstCell = 0;
+    for (const CellRun& run : runs)
+    {
+      const vtkIdType numCells = run.cells ? run.cells->GetNumberOfCells() : 0;
+      if (numCells > 0)
+      {
+        VisitCellArray(run.cells, [&](const auto* offsets, const auto* conn) {
+          for (vtkIdType i = 0; i < numCells; ++i)
+          {
+            if (ghost && ghost[firstCell + i] != 0)
+            {
+              continue;
+            }
+            const int64_t n = static_cast<int64_t>(offsets[i + 1]) - static_cast<int64_t>(offsets[i]);
+            const int vtkType = run.types ? run.types[i] : PolyCellType(run.kind, n);
+            fn(firstCell + i, vtkType, conn + offsets[i], n);
+          }
+        });
+      }
+      firstCell += numCells;
+    }
+    return;
+  }
+
+  vtkNew<vtkIdList> ptIds;
+  const vtkIdType nCells = ds->GetNumberOfCells();
+  for (vtkIdType cid = 0; cid < nCells; ++cid)
+  {
+    if (ghost && ghost[cid] != 0)
+    {
+      continue;
+    }
+    const int vtkType = ds->GetCellType(cid);
+    ds->GetCellPoints(cid, ptIds);
+    fn(cid, vtkType, ptIds->GetPointer(0), static_cast<int64_t>(ptIds->GetNumberOfIds()));
+  }
+}
+
+// Runs fn(block) for every block in [0, numBlocks) with vtkSMPTools.
+void SmpParallelFor(const size_t numBlocks, const std::function<void(size_t)>& fn)
+{
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numBlocks), [&](const vtkIdType begin, const vtkIdType end) {
+    for (vtkIdType b = begin; b < end; ++b)
+    {
+      fn(static_cast<size_t>(b));
+    }
+  });
+}
+
+// A few blocks per thread for count items; the block-parallel helpers give the same result for any number.
+size_t SmpBlocks(const int64_t count)
+{
+  return static_cast<size_t>(
+    std::max<int64_t>(1, std::min<int64_t>(count, 4 * vtkSMPTools::GetEstimatedNumberOfThreads())));
+}
+
+// The points and cells of an unstructured zone in the order of CgnsWriterOptions::reorder.
+struct ZoneOrder
+{
+  // Every cell as the list of its points, renumbered; ghost cells are empty.
+  std::vector<vtkIdType> offsets;
+  std::vector<vtkIdType> conn;
+  std::vector<unsigned char> types;
+  std::vector<int64_t> cells;     // cells[i] is the i-th cell written
+  std::vector<int64_t> points;    // points[i] is the point written as vertex i
+  std::vector<cgsize_t> vertexOf; // point -> 1-based vertex
+};
+
+// Computes the order of the cells that ForEachCell visits and of all points of ds.
+// Only the copy of the connectivity is made on the calling thread.
+ZoneOrder OrderZone(vtkDataSet* ds, const unsigned char* ghost, const int physDim, const CgnsReorder method)
+{
+  namespace reorder = cgns_writer::reorder;
+  const phase::Scope timer("reorder");
+  const vtkIdType nCells = ds->GetNumberOfCells();
+  const int64_t numPoints = static_cast<int64_t>(ds->GetNumberOfPoints());
+  ZoneOrder order;
+  order.offsets.assign(static_cast<size_t>(nCells) + 1, 0);
+  order.types.assign(static_cast<size_t>(nCells), 0);
+  vtkIdType next = 0;
+  ForEachCell(ds, ghost, [&](const vtkIdType cid, const int vtkType, const auto* ids, const int64_t n) {
+    for (; next <= cid; ++next)
+    {
+      order.offsets[static_cast<size_t>(next)] = static_cast<vtkIdType>(order.conn.size());
+    }
+    order.conn.insert(order.conn.end(), ids, ids + n);
+    order.types[static_cast<size_t>(cid)] = static_cast<unsigned char>(vtkType);
+  });
+  for (; next <= nCells; ++next)
+  {
+    order.offsets[static_cast<size_t>(next)] = static_cast<vtkIdType>(order.conn.size());
+  }
+
+  const reorder::Cells<vtkIdType> cells{ order.offsets.data(), order.conn.data(), nullptr,
+                                         static_cast<int64_t>(nCells) };
+  const size_t numBlocks = SmpBlocks(std::max<int64_t>(nCells, numPoints));
+  reorder::Orders orders;
+  if (method == CgnsReorder::Hilbert)
+  {
+    std::vector<double> xyz(3 * static_cast<size_t>(numPoints));
+    GetUnstructuredCoords(ds, physDim, xyz.data());
+    const double* const axes[3] = { xyz.data(), xyz.data() + numPoints, xyz.data() + 2 * numPoints };
+    orders = reorder::Hilbert<vtkIdType>(axes, 1, numPoints, cells, numBlocks, SmpParallelFor);
+  }
+  else
+  {
+    orders = reorder::ReverseCuthillMcKee<vtkIdType>(numPoints, cells, numBlocks, SmpParallelFor);
+  }
+
+  const std::vector<int64_t> rank = reorder::Inverse(orders.points, numBlocks, SmpParallelFor);
+  order.vertexOf.resize(static_cast<size_t>(numPoints));
+  vtkSMPTools::For(0, static_cast<vtkIdType>(numPoints), [&](const vtkIdType begin, const vtkIdType end) {
+    for (vtkIdType p = begin; p < end; ++p)
+    {
+      order.vertexOf[static_cast<size_t>(p)] = static_cast<cgsize_t>(rank[static_cast<size_t>(p)] + 1);
+    }
+  });
+  vtkSMPTools::For(0, static_cast<vtkIdType>(order.conn.size()), [&](const vtkIdType begin, const vtkIdType end) {
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      order.conn[static_cast<size_t>(i)] = static_cast<vtkIdType>(rank[static_cast<size_t>(order.conn[i])]);
+    }
+  });
+  order.cells = std::move(orders.cells);
+  order.points = std::move(orders.points);
+  return order;
+}
+
+// Calls fn like ForEachCell, in the order of order when it is set and with the renumbered points.
+template <typename Fn>
+void ForEachCellInOrder(vtkDataSet* ds, const unsigned char* ghost, const ZoneOrder* order, Fn&& fn)
+{
+  if (!order)
+  {
+    ForEachCell(ds, ghost, fn);
+    return;
+  }
+  for (const int64_t cid : order->cells)
+  {
+    if (ghost && ghost[cid] != 0)
+    {
+      continue;
+    }
+    const vtkIdType first = order->offsets[static_cast<size_t>(cid)];
+    fn(static_cast<vtkIdType>(cid), static_cast<int>(order->types[static_cast<size_t>(cid)]),
+       order->conn.data() + first, static_cast<int64_t>(order->offsets[static_cast<size_t>(cid) + 1] - first));
+  }
+}
+
+// What one pass over the cells of a zone found out. Every zone is scanned before the
+// base is written, so that its dimensions cover all zones, and the section buffers are
+// then sized from the histogram instead of grown cell by cell.
+struct ZoneScan
+{
+  int physDim = 3;
+  int cellDim = 0; // highest dimension of the cells that will be written; 0 without cells
+
+  // Unstructured zones only.
+  const unsigned char* ghost = nullptr;      // per-cell ghost flags when ghost cells are skipped
+  int64_t numGhostCells = 0;                 // cells skipped as ghosts
+  std::array<int64_t, 256> cellTypeCounts{}; // cells to write per VTK cell type
+  std::vector<unsigned char> cellTypeOrder;  // VTK cell types in order of first appearance
+  int64_t polygonNodes = 0;                  // connectivity entries of the VTK_POLYGON cells
+  int64_t polyhedronPoints = 0;              // points of the VTK_POLYHEDRON cells, counted per cell
+};
+
+// Validates and counts the cells of an unstructured zone as ForEachCell hands them over.
+// Throws on the first cell that cannot be written, with the messages of the section writer.
+class ZoneScanner
+{
+public:
+  ZoneScanner(ZoneScan& scan, const vtkIdType numPoints)
+    : Scan(scan)
+    , NumPoints(static_cast<int64_t>(numPoints))
+  {
+    NodesOfType.fill(0);
+  }
+
+  template <typename IdT>
+  void operator()(const vtkIdType cid, const int vtkType, const IdT* ids, const int64_t n)
+  {
+    if (vtkType < 0 || vtkType >= static_cast<int>(NodesOfType.size()) || NodesOfType[vtkType] == 0)
+    {
+      Learn(vtkType);
+    }
+    const int expected = NodesOfType[vtkType];
+    if (expected > 0 && n != expected)
+    {
+      throw std::runtime_error("Unexpected number of points for VTK cell type " + std::to_string(vtkType));
+    }
+    if (expected < 0 && n < -expected)
+    {
+      throw std::runtime_error("Cell " + std::to_string(cid) + " of VTK type " + std::to_string(vtkType) + " has " +
+                               std::to_string(n) + " points, expected at least " + std::to_string(-expected));
+    }
+    for (int64_t k = 0; k < n; ++k)
+    {
+      const int64_t id = static_cast<int64_t>(ids[k]);
+      if (id < 0 || id >= NumPoints)
+      {
+        throw std::runtime_error("Cell " + std::to_string(cid) + " references point " + std::to_string(id) +
+                                 ", but the dataset has " + std::to_string(NumPoints) + " points");
+      }
+    }
+    ++Scan.cellTypeCounts[static_cast<size_t>(vtkType)];
+    if (vtkType == VTK_POLYGON)
+    {
+      Scan.polygonNodes += n;
+    }
+    else if (vtkType == VTK_POLYHEDRON)
+    {
+      Scan.polyhedronPoints += n;
+    }
+  }
+
+private:
+  void Learn(const int vtkType)
+  {
+    CGNS_ENUMT(ElementType_t) cgnsType = CGNS_ENUMV(ElementTypeNull);
+    int nodesPerElem = 0;
+    if (vtkType < 0 || vtkType >= static_cast<int>(NodesOfType.size()) ||
+        !MapVtkCellToCgns(vtkType, cgnsType, nodesPerElem))
+    {
+      throw std::runtime_error("Unsupported VTK cell type " + std::to_string(vtkType) +
+                               " (only a minimal subset is implemented).");
+    }
+    // Cells of variable size store the negated minimum.
+    NodesOfType[static_cast<size_t>(vtkType)] =
+      nodesPerElem > 0 ? nodesPerElem : (vtkType == VTK_POLYHEDRON ? -4 : -3);
+    Scan.cellTypeOrder.push_back(static_cast<unsigned char>(vtkType));
+    Scan.cellDim = std::max(Scan.cellDim, ElementDimension(cgnsType));
+  }
+
+  ZoneScan& Scan;
+  const int64_t NumPoints;
+  std::array<int, 256> NodesOfType; // 0 until the type is first seen
+};
+
+// Scans the cells of one zone; throws when an unstructured zone has cells that cannot be written.
+ZoneScan ScanZone(vtkDataSet* ds, const CgnsWriterOptions& opt)
+{
+  CGNS_TRACE_SPAN(span, "ScanZone");
+  ZoneScan scan;
+  scan.physDim = InferPhysicalDim(ds);
+
+  int dims[3] = { 1, 1, 1 };
+  if (GetStructuredDimensions(ds, dims))
+  {
+    // Structured zones are written whole, ghost cells included.
+    scan.cellDim = (dims[0] > 1 ? 1 : 0) + (dims[1] > 1 ? 1 : 0) + (dims[2] > 1 ? 1 : 0);
+    return scan;
+  }
+
+  const vtkIdType nCells = ds->GetNumberOfCells();
+  vtkUnsignedCharArray* ghost = opt.skipGhostCells ? GetGhostCellArray(ds) : nullptr;
+  if (ghost && ghost->GetNumberOfTuples() == nCells)
+  {
+    scan.ghost = ghost->GetPointer(0);
+    for (vtkIdType cid = 0; cid < nCells; ++cid)
+    {
+      scan.numGhostCells += scan.ghost[cid] != 0 ? 1 : 0;
+    }
+  }
+
+  ZoneScanner scanner(scan, ds->GetNumberOfPoints());
+  ForEachCell(ds, scan.ghost, scanner);
+
+  if (scan.cellTypeCounts[VTK_POLYHEDRON] > 0)
+  {
+    // The zone becomes NGON_n faces plus NFACE_n cells; linear 3D cells are split into faces too,
+    // any other cell is rejected.
+    if (!vtkUnstructuredGrid::SafeDownCast(ds))
+    {
+      throw std::runtime_error("VTK_POLYHEDRON cells are only supported in a vtkUnstructuredGrid");
+    }
+    for (const unsigned char vtkType : scan.cellTypeOrder)
+    {
+      if (vtkType != VTK_POLYHEDRON && !cgns_writer::polyhedra::FacesOfLinearCell(vtkType))
+      {
+        throw std::runtime_error("VTK cell type " + std::to_string(vtkType) +
+                                 " is not a linear 3D cell and cannot be written with VTK_POLYHEDRON cells (NFACE_n)");
+      }
+    }
+  }
+  else if (opt.mixedSection && scan.cellTypeCounts[VTK_POLYGON] > 0)
+  {
+    throw std::runtime_error("VTK_POLYGON cells cannot be written to a MIXED section; disable mixedSection");
+  }
+  CGNS_TRACE_ARG(span, "ghostCells", scan.numGhostCells);
+  return scan;
+}
+
+// Copies the cells of a scanned zone into its sections, one per CGNS element type in
+// order of first appearance. The buffers get their final size from the scan up front,
+// and the cells need no further checks.
+class SectionBuilder
+{
+public:
+  SectionBuilder(const ZoneScan& scan, const bool oneBased, std::vector<Section>& sections)
+    : Shift(oneBased ? 1 : 0)
+  {
+    SectionOfType.fill(-1);
+    std::vector<int64_t> counts;
+    for (const unsigned char vtkType : scan.cellTypeOrder)
+    {
+      CGNS_ENUMT(ElementType_t) cgnsType = CGNS_ENUMV(ElementTypeNull);
+      int nodesPerElem = 0;
+      MapVtkCellToCgns(vtkType, cgnsType, nodesPerElem);
+      size_t si = 0;
+      while (si < sections.size() && sections[si].type != cgnsType)
+      {
+        ++si;
+      }
+      if (si == sections.size())
+      {
+        Section s;
+        s.type = cgnsType;
+        s.nodesPerElem = nodesPerElem;
+        s.name = DefaultSectionName(cgnsType);
+        sections.push_back(std::move(s));
+        counts.push_back(0);
+      }
+      SectionOfType[vtkType] = static_cast<int>(si);
+      counts[si] += scan.cellTypeCounts[vtkType];
+    }
+
+    CellCursor.resize(sections.size());
+    ConnCursor.resize(sections.size());
+    ConnBegin.resize(sections.size());
+    OffsetCursor.resize(sections.size(), nullptr);
+    for (size_t si = 0; si < sections.size(); ++si)
+    {
+      Section& s = sections[si];
+      s.vtkCellIds.resize(static_cast<size_t>(counts[si]));
+      if (s.nodesPerElem == 0)
+      {
+        // NGON_n: the polygons are its only cells.
+        s.conn.resize(static_cast<size_t>(scan.polygonNodes));
+        s.offsets.resize(static_cast<size_t>(counts[si]) + 1);
+        s.offsets.back() = static_cast<cgsize_t>(s.conn.size());
+        OffsetCursor[si] = s.offsets.data();
+      }
+      else
+      {
+        s.conn.resize(static_cast<size_t>(counts[si]) * static_cast<size_t>(s.nodesPerElem));
+      }
+      CellCursor[si] = s.vtkCellIds.data();
+      ConnCursor[si] = s.conn.data();
+      ConnBegin[si] = s.conn.data();
+    }
+  }
+
+  template <typename IdT>
+  void operator()(const vtkIdType cid, const int vtkType, const IdT* ids, const int64_t n)
+  {
+    const size_t si = static_cast<size_t>(SectionOfType[static_cast<size_t>(vtkType)]);
+    *CellCursor[si]++ = cid;
+    cgsize_t*& dst = ConnCursor[si];
+    if (OffsetCursor[si])
+    {
+      *OffsetCursor[si]++ = static_cast<cgsize_t>(dst - ConnBegin[si]);
+    }
+    cgns_writer::node_order::CopyElements(static_cast<unsigned char>(vtkType), ids, 1, n, Shift, dst);
+    dst += n;
+  }
+
+private:
+  const cgsize_t Shift;
+  std::array<int, 256> SectionOfType;
+  std::vector<vtkIdType*> CellCursor;
+  std::vector<cgsize_t*> ConnCursor;
+  std::vector<cgsize_t*> ConnBegin;
+  std::vector<cgsize_t*> OffsetCursor; // null except for NGON_n
+};
+
+// Copies the cells of a scanned zone into one MIXED section in cell order: each element is
+// its CGNS element type followed by its node ids, and offsets[e] is where element e starts
+// in conn. Without ghost cells element e is cell e and cellToElem is not needed; with them
+// it must be passed, sized to the cell count, and skipped cells keep 0.
+class MixedSectionBuilder
+{
+public:
+  MixedSectionBuilder(const ZoneScan& scan, const bool oneBased, Section& s, std::vector<cgsize_t>* cellToElem)
+    : Shift(oneBased ? 1 : 0)
+    , CellToElem(cellToElem)
+  {
+    TypeTag.fill(0);
+    int64_t numElems = 0;
+    int64_t size = 0;
+    for (const unsigned char vtkType : scan.cellTypeOrder)
+    {
+      CGNS_ENUMT(ElementType_t) cgnsType = CGNS_ENUMV(ElementTypeNull);
+      int nodesPerElem = 0;
+      MapVtkCellToCgns(vtkType, cgnsType, nodesPerElem);
+      TypeTag[vtkType] = static_cast<cgsize_t>(cgnsType);
+      numElems += scan.cellTypeCounts[vtkType];
+      size += scan.cellTypeCounts[vtkType] * (1 + nodesPerElem);
+    }
+
+    s.type = CGNS_ENUMV(MIXED);
+    s.name = DefaultSectionName(s.type);
+    s.conn.resize(static_cast<size_t>(size));
+    s.offsets.assign(static_cast<size_t>(numElems) + 1, 0);
+    s.start = 1;
+    s.end = static_cast<cgsize_t>(numElems);
+    Begin = s.conn.data();
+    Conn = Begin;
+    Offset = s.offsets.data();
+  }
+
+  template <typename IdT>
+  void operator()(const vtkIdType cid, const int vtkType, const IdT* ids, const int64_t n)
+  {
+    *Conn++ = TypeTag[static_cast<size_t>(vtkType)];
+    cgns_writer::node_order::CopyElements(static_cast<unsigned char>(vtkType), ids, 1, n, Shift, Conn);
+    Conn += n;
+    *++Offset = static_cast<cgsize_t>(Conn - Begin);
+    if (CellToElem)
+    {
+      (*CellToElem)[static_cast<size_t>(cid)] = ++Elem;
+    }
+  }
+
+private:
+  const cgsize_t Shift;
+  std::vector<cgsize_t>* CellToElem;
+  std::array<cgsize_t, 256> TypeTag;
+  cgsize_t* Begin = nullptr;
+  cgsize_t* Conn = nullptr;
+  cgsize_t* Offset = nullptr;
+  cgsize_t Elem = 0;
+};
+
+// Checks that the face stream [numFaces, n0, ids..., n1, ids..., ...] of polyhedron cid has
+// size entries exactly, with at least four faces of at least three points each, and that its
+// point ids are in range.
+void ValidateFaceStream(const vtkIdType cid, const vtkIdType* stream, const int64_t size, const int64_t numPoints)
+{
+  const std::string cell = "Polyhedron " + std::to_string(cid);
+  const int64_t numFaces = size > 0 ? static_cast<int64_t>(stream[0]) : 0;
+  if (numFaces < 4)
+  {
+    throw std::runtime_error(cell + " has " + std::to_string(numFaces) + " faces, expected at least 4");
+  }
+  int64_t at = 1;
+  for (int64_t f = 0; f < numFaces; ++f)
+  {
+    const int64_t n = at < size ? static_cast<int64_t>(stream[at]) : 0;
+    if (n < 3 || n > size - at - 1)
+    {
+      throw std::runtime_error(cell + ": face " + std::to_string(f) + " has " + std::to_string(n) +
+                               " points or overruns the face stream");
+    }
+    for (int64_t i = at + 1; i <= at + n; ++i)
+    {
+      if (stream[i] < 0 || stream[i] >= numPoints)
+      {
+        throw std::runtime_error(cell + " references point " + std::to_string(stream[i]) + ", but the dataset has " +
+                                 std::to_string(numPoints) + " points");
+      }
+    }
+    at += 1 + n;
+  }
+  if (at != size)
+  {
+    throw std::runtime_error(cell + " has " + std::to_string(size - at) + " entries after its last face");
+  }
+}
+
+// Builds the sections of a scanned zone with polyhedra: an NGON_n section "Faces" holding
+// every distinct face once (elements 1..numFaces) and an NFACE_n section "Polyhedra" holding
+// the cells in VTK order (or that of order) by their signed face numbers. The linear 3D cells
+// are split into their faces as well. With ghost cells or an order, cellToElem receives the
+// place of every written cell among the NFACE_n elements. Returns the number of cells written.
+cgsize_t BuildPolyhedralSections(vtkDataSet* ds, const ZoneScan& scan, const ZoneOrder* order,
+                                 std::vector<Section>& sections, std::vector<cgsize_t>& cellToElem)
+{
+  // Flatten the cells the way polyhedra::Build reads them: a polyhedron as its face stream,
+  // any other cell as its points.
+  auto* ug = vtkUnstructuredGrid::SafeDownCast(ds);
+  const int64_t numPoints = static_cast<int64_t>(ds->GetNumberOfPoints());
+  std::vector<vtkIdType> offsets(1, 0);
+  std::vector<vtkIdType> conn;
+  std::vector<unsigned char> types;
+  offsets.reserve(static_cast<size_t>(ds->GetNumberOfCells() - scan.numGhostCells) + 1);
+  types.reserve(offsets.capacity());
+  if (scan.numGhostCells > 0 || order)
+  {
+    cellToElem.assign(static_cast<size_t>(ds->GetNumberOfCells()), 0);
+  }
+  vtkNew<vtkIdList> stream;
+  ForEachCellInOrder(ds, scan.ghost, order, [&](const vtkIdType cid, const int vtkType, const auto* ids,
+                                                const int64_t n) {
+    if (vtkType == VTK_POLYHEDRON)
+    {
+      ug->GetFaceStream(cid, stream);
+      vtkIdType* faces = stream->GetPointer(0);
+      const int64_t size = static_cast<int64_t>(stream->GetNumberOfIds());
+      ValidateFaceStream(cid, faces, size, numPoints);
+      for (int64_t at = 1; order && at < size; at += 1 + faces[at])
+      {
+        for (int64_t k = at + 1; k <= at + faces[at]; ++k)
+        {
+          faces[k] = static_cast<vtkIdType>(order->vertexOf[static_cast<size_t>(faces[k])] - 1);
+        }
+      }
+      conn.insert(conn.end(), faces, faces + size);
+    }
+    else
+    {
+      conn.insert(conn.end(), ids, ids + n);
+    }
+    offsets.push_back(static_cast<vtkIdType>(conn.size()));
+    types.push_back(static_cast<unsigned char>(vtkType));
+    if (!cellToElem.empty())
+    {
+      cellToElem[static_cast<size_t>(cid)] = static_cast<cgsize_t>(types.size());
+    }
+  });
+
+  const int64_t numCells = static_cast<int64_t>(types.size());
+  cgns_writer::polyhedra::Sections poly;
+  cgns_writer::polyhedra::Build<vtkIdType>(offsets.data(), conn.data(), types.data(), numCells, SmpBlocks(numCells),
+                                           SmpParallelFor, poly);
+
+  Section faces;
+  faces.type = CGNS_ENUMV(NGON_n);
+  faces.name = "Faces";
+  faces.start = 1;
+  faces.end = static_cast<cgsize_t>(poly.NumFaces());
+  faces.conn = std::move(poly.faceConn);
+  faces.offsets = std::move(poly.faceOffsets);
+
+  Section cells;
+  cells.type = CGNS_ENUMV(NFACE_n);
+  cells.name = DefaultSectionName(cells.type);
+  cells.start = faces.end + 1;
+  cells.end = faces.end + static_cast<cgsize_t>(poly.NumCells());
+  cells.conn = std::move(poly.cellConn);
+  cells.offsets = std::move(poly.cellOffsets);
+
+  sections.push_back(std::move(faces));
+  sections.push_back(std::move(cells));
+  return static_cast<cgsize_t>(numCells);
+}
+
+// Everything a zone needs before its libcgns writes: element sections, coordinates and,
+// when prepared ahead (ZonePipeline), its converted fields.
+struct PreparedZone
+{
+  int dims[3] = { 1, 1, 1 };          // structured zones
+  std::vector<Section> sections;      // unstructured zones
+  std::vector<cgsize_t> cellToElem;   // unstructured zones: see CellFields; empty for a MIXED
+                                      // section or polyhedral zone without ghost cells or reordering
+                                      // (value = cell)
+  std::vector<cgsize_t> pointToVertex; // reordered unstructured zones: see PointFields
+  cgsize_t nCellsWritten = 0;
+  std::optional<PreparedArray> coords; // empty when CoordsWrittenDirectly
+  bool fieldsPrepared = false;
+  std::vector<PreparedArray> pointFields;
+  std::vector<PreparedArray> cellFields;
+  double maxPrecisionLoss = 0.0; // largest rounding error of the prepared values
+
+  int64_t Bytes() const
+  {
+    int64_t bytes = static_cast<int64_t>((cellToElem.size() + pointToVertex.size()) * sizeof(cgsize_t)) +
+                    (coords ? coords->Bytes() : 0);
+    for (const Section& s : sections)
+    {
+      bytes += connectivity::Bytes(s) + static_cast<int64_t>(s.vtkCellIds.size() * sizeof(vtkIdType));
+    }
+    for (const auto* fields : { &pointFields, &cellFields })
+    {
+      for (const PreparedArray& f : *fields)
+      {
+        bytes += f.Bytes();
+      }
+    }
+    return bytes;
+  }
+};
+
+// Moves the connectivity of every section whose values fit in 32 bits to its int32_t arrays.
+void NarrowSections(std::vector<Section>& sections)
+{
+  if (!connectivity::kCanNarrow || sections.empty())
+  {
+    return;
+  }
+  const phase::Scope timer("section");
+  for (Section& s : sections)
+  {
+    connectivity::Narrow(s, SmpBlocks(static_cast<int64_t>(s.conn.size())), SmpParallelFor);
+  }
+}
+
+// Builds the sections, cell-to-element map and coordinates of a scanned zone, and its fields
+// when prepareFields is set. Unstructured zones are renumbered first when opt.reorder asks for
+// it, and sections whose ids fit in 32 bits are narrowed. Makes no libcgns calls, so zones can
+// be prepared on worker threads.
+PreparedZone PrepareZone(vtkDataSet* ds, const ZoneScan& scan, const CgnsWriterOptions& opt, const bool prepareFields)
+{
+  PreparedZone zone;
+  double* maxLoss = opt.maxPrecisionLoss ? &zone.maxPrecisionLoss : nullptr;
+  const bool structured = IsStructured(ds);
+  std::optional<ZoneOrder> order;
+  if (!structured && opt.reorder != CgnsReorder::None)
+  {
+    order = OrderZone(ds, scan.ghost, scan.physDim, opt.reorder);
+  }
+  const ZoneOrder* visit = order ? &*order : nullptr;
+  if (structured)
+  {
+    if (!GetStructuredDimensions(ds, zone.dims))
+    {
+      throw std::runtime_error("Internal error: PrepareZone could not get structured dimensions.");
+    }
+    zone.nCellsWritten = static_cast<cgsize_t>(ds->GetNumberOfCells());
+  }
+  else if (scan.cellTypeCounts[VTK_POLYHEDRON] > 0)
+  {
+    // NGON_n faces and NFACE_n cells, whatever the section layout; the scan has checked the cell types.
+    const phase::Scope timer("section");
+    zone.nCellsWritten = BuildPolyhedralSections(ds, scan, visit, zone.sections, zone.cellToElem);
+  }
+  else if (opt.mixedSection)
+  {
+    // One MIXED section in cell order; the scan has validated the cells.
+    const phase::Scope timer("section");
+    zone.sections.resize(1);
+    const bool mapCells = scan.numGhostCells > 0 || visit;
+    if (mapCells)
+    {
+      zone.cellToElem.assign(static_cast<size_t>(ds->GetNumberOfCells()), 0);
+    }
+    ForEachCellInOrder(ds, scan.ghost, visit,
+                       MixedSectionBuilder(scan, opt.oneBasedConnectivity, zone.sections[0],
+                                           mapCells ? &zone.cellToElem : nullptr));
+    zone.nCellsWritten = zone.sections[0].end;
+  }
+  else
+  {
+    // Build element sections (group by CGNS element type); the scan has validated the cells.
+    const phase::Scope timer("section");
+    ForEachCellInOrder(ds, scan.ghost, visit, SectionBuilder(scan, opt.oneBasedConnectivity, zone.sections));
+    zone.cellToElem.assign(static_cast<size_t>(ds->GetNumberOfCells()), 0);
+
+    // Assign element ranges and build cell->element mapping
+    cgsize_t elem = 1;
+    for (auto& s : zone.sections)
+    {
+      const cgsize_t ne = static_cast<cgsize_t>(s.vtkCellIds.size());
+      if (ne == 0)
+      {
+        continue;
+      }
+      s.start = elem;
+      s.end = elem + ne - 1;
+
+      for (cgsize_t i = 0; i < ne; ++i)
+      {
+        const vtkIdType cid = s.vtkCellIds[static_cast<size_t>(i)];
+        zone.cellToElem[static_cast<size_t>(cid)] = s.start + i;
+      }
+
+      elem = s.end + 1;
+    }
+    zone.nCellsWritten = elem - 1;
+  }
+
+  NarrowSections(zone.sections);
+
+  // Only the point numbering is needed from here on.
+  std::vector<int64_t> pointOrder;
+  if (order)
+  {
+    pointOrder = std::move(order->points);
+    zone.pointToVertex = std::move(order->vertexOf);
+    order.reset();
+  }
+
+  const int* dims = structured ? zone.dims : nullptr;
+  if (!CoordsWrittenDirectly(ds, dims, opt))
+  {
+    const phase::Scope timer("coords");
+    zone.coords = PrepareCoords(ds, dims, scan.physDim, opt.coordPrecision,
+                                pointOrder.empty() ? nullptr : pointOrder.data(), maxLoss);
+  }
+
+  if (prepareFields)
+  {
+    zone.fieldsPrepared = true;
+    if (opt.writePointData)
     {
-      throw std::runtime_error("No vtkDataSet leaves found in input.");
+      zone.pointFields = PrepareFields(PointFields(ds, zone.pointToVertex, opt), opt, maxLoss);
+    }
+    if (opt.writeCellData)
+    {
+      zone.cellFields = PrepareFields(CellFields(ds, zone.cellToElem, zone.nCellsWritten, opt), opt, maxLoss);
+    }
+  }
+  return zone;
+}
+
+// Issues the libcgns writes of a prepared zone: zone node, coordinates, sections, solutions.
+void WritePreparedZone(int fn, int B, const std::string& zoneName, vtkDataSet* ds, const ZoneScan& scan,
+                       const PreparedZone& zone, const CgnsWriterOptions& opt)
+{
+  const bool structured = IsStructured(ds);
+
+  // CGNS expects sizes for structured zones: [nVertexI,nVertexJ,nVertexK,nCellI,nCellJ,nCellK,nBndI,nBndJ,nBndK]
+  // and [nVertex, nCell, nBoundVertex] for unstructured ones.
+  cgsize_t size[9] = { 0 };
+  if (structured)
+  {
+    for (int d = 0; d < 3; ++d)
+    {
+      size[d] = zone.dims[d];
+      size[3 + d] = std::max(zone.dims[d] - 1, 0);
     }
+  }
+  else
+  {
+    size[0] = static_cast<cgsize_t>(ds->GetNumberOfPoints());
+    size[1] = zone.nCellsWritten;
+  }
 
-    // Infer dims from the first zone; CGNS base dims apply to all zones.
-    vtkDataSet* first = zones[0].ds;
-    const int physDim = InferPhysicalDim(first);
-    const int cellDim = InferCellDim(first);
+  int Z = 0;
+  {
+    const phase::Scope timer("cg_zone_write");
+    CheckCg(cg_zone_write(fn, B, zoneName.c_str(), size,
+                          structured ? CGNS_ENUMV(Structured) : CGNS_ENUMV(Unstructured), &Z),
+            structured ? "cg_zone_write(Structured)" : "cg_zone_write(Unstructured)");
+  }
 
-    int B = 0;
-    CheckCg(cg_base_write(fn, opt.baseName.c_str(), cellDim, physDim, &B), "cg_base_write");
+  // Coords
+  {
+    const phase::Scope timer("coords");
+    if (zone.coords)
+    {
+      WriteCoords(fn, B, Z, *zone.coords);
+    }
+    else if (!WriteInterleavedPointSetCoords(fn, B, Z, ds, size, opt) &&
+             !WriteImplicitStructuredCoords(fn, B, Z, ds, zone.dims, scan.physDim, opt))
+    {
+      throw std::runtime_error("Internal error: coordinates of zone " + zoneName + " were not prepared.");
+    }
+  }
+
+  // Sections
+  for (const auto& s : zone.sections)
+  {
+    if (s.conn.empty() && s.conn32.empty())
+    {
+      continue;
+    }
+    const int64_t bytes = connectivity::Bytes(s);
+    const phase::SectionScope stats(zoneName, s.name, static_cast<int>(s.type),
+                                    static_cast<int64_t>(s.end - s.start + 1), bytes, connectivity::BytesSaved(s));
+    if (!s.conn32.empty())
+    {
+      const phase::Scope timer("cg_section_general_write", bytes);
+      int S = 0;
+      CheckCg(connectivity::WriteNarrowed(fn, B, Z, s, &S), "cg_section_general_write(" + s.name + ")");
+      continue;
+    }
+    if (!s.offsets.empty())
+    {
+      WritePolySection(fn, B, Z, s, bytes);
+      continue;
+    }
+    const phase::Scope timer("cg_section_write", bytes);
+    int S = 0;
+    CheckCg(cg_section_write(fn, B, Z, s.name.c_str(), s.type, s.start, s.end, 0, s.conn.data(), &S),
+            "cg_section_write(" + s.name + ")");
+  }
+
+  // Solutions
+  if (opt.writePointData)
+  {
+    WriteSolution(fn, B, Z, PointFields(ds, zone.pointToVertex, opt), zone.fieldsPrepared ? &zone.pointFields : nullptr,
+                  opt);
+  }
+  if (opt.writeCellData)
+  {
+    WriteSolution(fn, B, Z, CellFields(ds, zone.cellToElem, zone.nCellsWritten, opt),
+                  zone.fieldsPrepared ? &zone.cellFields : nullptr, opt);
+  }
+
+  if (opt.maxPrecisionLoss)
+  {
+    *opt.maxPrecisionLoss = std::max(*opt.maxPrecisionLoss, zone.maxPrecisionLoss);
+  }
+  phase::AddZone(static_cast<int64_t>(ds->GetNumberOfPoints()), static_cast<int64_t>(zone.nCellsWritten));
+}
 
-    for (const auto& z : zones)
+// Upper bound of PreparedZone::Bytes for a scanned zone, counting 8 bytes per coordinate
+// and field value.
+int64_t EstimatePreparedBytes(vtkDataSet* ds, const ZoneScan& scan, const CgnsWriterOptions& opt)
+{
+  const bool structured = IsStructured(ds);
+  int dims[3] = { 1, 1, 1 };
+  if (structured)
+  {
+    GetStructuredDimensions(ds, dims);
+  }
+  const int64_t npts = ds->GetNumberOfPoints();
+  const int64_t ncells = ds->GetNumberOfCells();
+  int64_t bytes = CoordsWrittenDirectly(ds, structured ? dims : nullptr, opt) ? 0 : 3 * npts * 8;
+  if (!structured)
+  {
+    // A MIXED section adds a type tag and an offset per element but keeps no cell ids,
+    // and needs cellToElem only to skip ghost cells or reorder; so do polyhedral zones.
+    const bool polyhedral = scan.cellTypeCounts[VTK_POLYHEDRON] > 0;
+    const bool mixed = opt.mixedSection || polyhedral;
+    const bool reordered = opt.reorder != CgnsReorder::None;
+    if (!mixed || scan.numGhostCells > 0 || reordered)
+    {
+      bytes += ncells * static_cast<int64_t>(sizeof(cgsize_t));
+    }
+    if (reordered)
+    {
+      bytes += npts * static_cast<int64_t>(sizeof(cgsize_t)); // pointToVertex
+    }
+    // The closing entries of the offsets arrays (at most two sections have one).
+    bytes += 2 * static_cast<int64_t>(sizeof(cgsize_t));
+    if (polyhedral)
     {
-      vtkDataSet* ds = z.ds;
-      if (!ds)
+      // Every face of every cell at most once in NGON_n (nodes and an offset) and once in
+      // NFACE_n, plus an offset per cell. A closed polyhedron with V points has at most
+      // 2V - 4 faces with 6V - 12 nodes in all (Euler).
+      int64_t entries = 10 * scan.polyhedronPoints + scan.cellTypeCounts[VTK_POLYHEDRON];
+      for (const unsigned char vtkType : scan.cellTypeOrder)
       {
-        continue;
+        if (const auto* faces = cgns_writer::polyhedra::FacesOfLinearCell(vtkType))
+        {
+          int64_t perCell = 1;
+          for (int f = 0; f < faces->numFaces; ++f)
+          {
+            perCell += faces->sizes[f] + 2;
+          }
+          entries += scan.cellTypeCounts[vtkType] * perCell;
+        }
+      }
+      bytes += entries * static_cast<int64_t>(sizeof(cgsize_t));
+    }
+    else
+    {
+      for (const unsigned char vtkType : scan.cellTypeOrder)
+      {
+        CGNS_ENUMT(ElementType_t) cgnsType = CGNS_ENUMV(ElementTypeNull);
+        int nodesPerElem = 0;
+        MapVtkCellToCgns(vtkType, cgnsType, nodesPerElem);
+        // Polygons (nodesPerElem = 0) add an offset per element; their nodes are counted below.
+        const size_t perElem = mixed ? (nodesPerElem + 2) * sizeof(cgsize_t)
+                                     : (nodesPerElem + (nodesPerElem == 0 ? 1 : 0)) * sizeof(cgsize_t) +
+                                         sizeof(vtkIdType);
+        bytes += scan.cellTypeCounts[vtkType] * static_cast<int64_t>(perElem);
+      }
+      bytes += scan.polygonNodes * static_cast<int64_t>(sizeof(cgsize_t));
+    }
+  }
+  const std::pair<vtkDataSetAttributes*, int64_t> attrs[2] = {
+    { opt.writePointData ? ds->GetPointData() : nullptr, npts },
+    { opt.writeCellData ? ds->GetCellData() : nullptr, ncells },
+  };
+  for (const auto& a : attrs)
+  {
+    for (int ai = 0; a.first && ai < a.first->GetNumberOfArrays(); ++ai)
+    {
+      if (vtkDataArray* arr = a.first->GetArray(ai))
+      {
+        bytes += a.second * arr->GetNumberOfComponents() * 8;
+      }
+    }
+  }
+  return bytes;
+}
+
+// Prepares zones (PrepareZone) on worker threads, in zone order, while the calling thread
+// writes the zones prepared before them; libcgns is only called from the calling thread.
+// A worker starts on the next zone only while the estimated size of the zones prepared and
+// not yet released stays within opt.pipelineMemoryBudget, or when none are in flight.
+// The phases recorded by a worker are merged into the caller's when it takes the zone.
+class ZonePipeline
+{
+public:
+  ZonePipeline(const std::vector<ZoneInput>& zones, const std::vector<ZoneScan>& scans, const CgnsWriterOptions& opt,
+               const int numThreads)
+    : Zones(zones)
+    , Scans(scans)
+    , Opt(opt)
+    , Slots(zones.size())
+  {
+    for (size_t z = 0; z < zones.size(); ++z)
+    {
+      Slots[z].bytes = zones[z].ds ? EstimatePreparedBytes(zones[z].ds, scans[z], opt) : 0;
+    }
+    try
+    {
+      for (int t = 0; t < numThreads; ++t)
+      {
+        Workers.emplace_back([this] { Work(); });
       }
+    }
+    catch (...)
+    {
+      Shutdown();
+      throw;
+    }
+  }
 
-      if (IsStructured(ds))
+  ~ZonePipeline() { Shutdown(); }
+
+  // Waits until zone z is prepared and returns it; rethrows the error preparing it raised.
+  const PreparedZone& Take(const size_t z)
+  {
+    phase::Record phases;
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+      Changed.wait(lock, [&] { return Slots[z].ready; });
+      if (Slots[z].error)
       {
-        WriteZoneStructured(fn, B, z.zoneName, ds, opt);
+        std::rethrow_exception(Slots[z].error);
       }
-      else
+      phases = std::move(Slots[z].phases);
+    }
+    phase::Merge(phases);
+    return Slots[z].zone;
+  }
+
+  // Frees zone z once it has been written, making room for the zones after it.
+  void Release(const size_t z)
+  {
+    PreparedZone done;
+    {
+      const std::lock_guard<std::mutex> lock(Mutex);
+      std::swap(done, Slots[z].zone);
+      InFlight -= Slots[z].bytes;
+      Slots[z].bytes = 0;
+    }
+    Changed.notify_all();
+  }
+
+  ZonePipeline(const ZonePipeline&) = delete;
+  ZonePipeline& operator=(const ZonePipeline&) = delete;
+
+private:
+  struct Slot
+  {
+    bool ready = false;
+    PreparedZone zone;
+    phase::Record phases;
+    std::exception_ptr error;
+    int64_t bytes = 0; // estimate until ready, then PreparedZone::Bytes
+  };
+
+  void Work()
+  {
+    for (;;)
+    {
+      size_t z = 0;
+      {
+        std::unique_lock<std::mutex> lock(Mutex);
+        Changed.wait(lock, [&] {
+          return Stop || Next == Slots.size() || InFlight == 0 ||
+                 InFlight + Slots[Next].bytes <= Opt.pipelineMemoryBudget;
+        });
+        if (Stop || Next == Slots.size())
+        {
+          return;
+        }
+        z = Next++;
+        InFlight += Slots[z].bytes;
+      }
+
+      PreparedZone zone;
+      phase::Record phases;
+      std::exception_ptr error;
+      try
+      {
+        phase::Capture capture;
+        if (Zones[z].ds)
+        {
+          CGNS_TRACE_SCOPE("PrepareZone");
+          zone = PrepareZone(Zones[z].ds, Scans[z], Opt, true);
+        }
+        phases = capture.Finish();
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+
+      {
+        const std::lock_guard<std::mutex> lock(Mutex);
+        Slot& s = Slots[z];
+        const int64_t bytes = error ? 0 : zone.Bytes();
+        InFlight += bytes - s.bytes;
+        s.bytes = bytes;
+        s.zone = std::move(zone);
+        s.phases = std::move(phases);
+        s.error = error;
+        s.ready = true;
+        // The writer stops at the first failed zone; nothing after it is needed.
+        Stop = Stop || static_cast<bool>(error);
+      }
+      Changed.notify_all();
+    }
+  }
+
+  void Shutdown()
+  {
+    {
+      const std::lock_guard<std::mutex> lock(Mutex);
+      Stop = true;
+    }
+    Changed.notify_all();
+    for (std::thread& t : Workers)
+    {
+      t.join();
+    }
+    Workers.clear();
+  }
+
+  const std::vector<ZoneInput>& Zones;
+  const std::vector<ZoneScan>& Scans;
+  const CgnsWriterOptions& Opt;
+  std::vector<Slot> Slots;
+  std::vector<std::thread> Workers;
+  std::mutex Mutex;
+  std::condition_variable Changed;
+  size_t Next = 0;      // first zone no worker has started
+  int64_t InFlight = 0; // bytes of the zones started and not yet released
+  bool Stop = false;
+};
+
+// Number of pipeline workers for a write of numZones zones; 0 writes the zones serially.
+int PipelineThreads(const CgnsWriterOptions& opt, const size_t numZones)
+{
+  int threads = opt.pipelineThreads;
+  if (threads < 0)
+  {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  if (numZones < 2)
+  {
+    return 0;
+  }
+  return static_cast<int>(std::min(static_cast<size_t>(std::max(threads, 0)), numZones));
+}
+
+void ApplyCompression(const CgnsWriterOptions& opt)
+{
+  if (opt.compressionLevel < 0 || opt.compressionLevel > 9)
+  {
+    throw std::runtime_error("CgnsWriter::Write: compressionLevel must be in [0, 9]");
+  }
+  if (opt.compressionLevel > 0 && !opt.useHdf5)
+  {
+    throw std::runtime_error("CgnsWriter::Write: compressionLevel requires useHdf5");
+  }
+#ifdef CG_CONFIG_HDF5_COMPRESS
+  if (opt.useHdf5)
+  {
+    // Process-wide in libcgns: always set it so an earlier compressed write does not leak into this one.
+    CheckCg(cg_configure(CG_CONFIG_HDF5_COMPRESS, reinterpret_cast<void*>(static_cast<intptr_t>(opt.compressionLevel))),
+            "cg_configure(CG_CONFIG_HDF5_COMPRESS)");
+  }
+#else
+  if (opt.compressionLevel > 0)
+  {
+    throw std::runtime_error("CgnsWriter::Write: libcgns lacks CG_CONFIG_HDF5_COMPRESS");
+  }
+#endif
+}
+
+// Records the phases of one Write and copies them to the caller's stats when it
+// goes out of scope, whether Write returned or threw.
+class StatsRecorder
+{
+public:
+  explicit StatsRecorder(CgnsWriterStats& stats)
+    : Stats(stats)
+    , Start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~StatsRecorder()
+  {
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    try
+    {
+      const phase::Record record = Recording.Finish();
+      Stats = CgnsWriterStats{};
+      Stats.wallSeconds = wall;
+      Stats.numZones = record.zones;
+      Stats.numPoints = record.points;
+      Stats.numElements = record.elements;
+      for (const auto& t : record.timings)
+      {
+        Stats.phases.push_back(CgnsWriterPhaseStats{ t.name, t.seconds, t.calls, t.bytes });
+        Stats.bytesWritten += t.bytes;
+      }
+      for (const auto& s : record.sections)
+      {
+        Stats.sections.push_back(
+          CgnsWriterSectionStats{ s.zone, s.name, s.type, s.elements, s.bytes, s.seconds, s.bytesSaved });
+        Stats.connectivityBytesSaved += s.bytesSaved;
+      }
+    }
+    catch (...)
+    {
+      // Out of memory while copying: leave the stats partly filled rather than throw from a destructor.
+    }
+  }
+
+  StatsRecorder(const StatsRecorder&) = delete;
+  StatsRecorder& operator=(const StatsRecorder&) = delete;
+
+private:
+  CgnsWriterStats& Stats;
+  std::chrono::steady_clock::time_point Start;
+  phase::Capture Recording;
+};
+
+} // end anon namespace
+
+bool CgnsWriter::DumpTrace(const std::string& fileName)
+{
+#if CGNS_WRITER_ENABLE_TRACE
+  return cgns_writer::trace::Dump(fileName.c_str());
+#else
+  (void)fileName;
+  return false;
+#endif
+}
+
+void CgnsWriter::Write(vtkDataObject* input, const std::string& fileName, const CgnsWriterOptions& opt,
+                       CgnsWriterStats* stats)
+{
+  CGNS_TRACE_SCOPE("CgnsWriter::Write");
+  std::optional<StatsRecorder> recorder;
+  if (stats)
+  {
+    recorder.emplace(*stats);
+  }
+
+  if (!input)
+  {
+    throw std::runtime_error("CgnsWriter::Write: input is null");
+  }
+  if (fileName.empty())
+  {
+    throw std::runtime_error("CgnsWriter::Write: fileName is empty");
+  }
+
+  if (opt.maxPrecisionLoss)
+  {
+    *opt.maxPrecisionLoss = 0.0;
+  }
+
+  // Best-effort file type selection (only affects newly created files).
+#ifdef CG_FILE_HDF5
+  if (opt.useHdf5)
+  {
+    // If CGNS was built without HDF5 support, this may fail; ignore in that case.
+    (void)cg_set_file_type(CG_FILE_HDF5);
+  }
+  else
+  {
+    (void)cg_set_file_type(CG_FILE_ADF);
+  }
+#endif
+  ApplyCompression(opt);
+
+  int fn = 0;
+  {
+    const phase::Scope timer("cg_open");
+    CheckCg(cg_open(fileName.c_str(), CG_MODE_WRITE, &fn), "cg_open");
+  }
+
+  try
+  {
+    // Zones to write
+    std::vector<ZoneInput> zones;
+    {
+      const phase::Scope timer("flatten");
+      zones = FlattenToZones(input, opt);
+    }
+    if (zones.empty())
+    {
+      throw std::runtime_error("No vtkDataSet leaves found in input.");
+    }
+
+    // CGNS base dims apply to all zones, so scan every zone before writing any of them.
+    std::vector<ZoneScan> scans(zones.size());
+    int physDim = 1;
+    int cellDim = 0;
+    {
+      const phase::Scope timer("scan");
+      for (size_t zi = 0; zi < zones.size(); ++zi)
+      {
+        if (zones[zi].ds)
+        {
+          scans[zi] = ScanZone(zones[zi].ds, opt);
+          physDim = std::max(physDim, scans[zi].physDim);
+          cellDim = std::max(cellDim, scans[zi].cellDim);
+        }
+      }
+    }
+    // Without cells (e.g. only empty zones) default to 3, as most CFD/FEA data is.
+    if (cellDim == 0)
+    {
+      cellDim = 3;
+    }
+
+    int B = 0;
+    {
+      const phase::Scope timer("cg_base_write");
+      CheckCg(cg_base_write(fn, opt.baseName.c_str(), cellDim, physDim, &B), "cg_base_write");
+    }
+
+    const int threads = PipelineThreads(opt, zones.size());
+    if (threads == 0)
+    {
+      for (size_t zi = 0; zi < zones.size(); ++zi)
+      {
+        const ZoneInput& z = zones[zi];
+        if (!z.ds)
+        {
+          continue;
+        }
+        // Fields are converted while they are written, one array at a time.
+        const PreparedZone zone = PrepareZone(z.ds, scans[zi], opt, false);
+        WritePreparedZone(fn, B, z.zoneName, z.ds, scans[zi], zone, opt);
+        // The point bitmap is not needed past this zone.
+        scans[zi] = ZoneScan();
+      }
+    }
+    else
+    {
+      ZonePipeline pipeline(zones, scans, opt, threads);
+      for (size_t zi = 0; zi < zones.size(); ++zi)
       {
-        WriteZoneUnstructured(fn, B, z.zoneName, ds, opt);
+        const ZoneInput& z = zones[zi];
+        const PreparedZone& zone = pipeline.Take(zi);
+        if (z.ds)
+        {
+          WritePreparedZone(fn, B, z.zoneName, z.ds, scans[zi], zone, opt);
+        }
+        pipeline.Release(zi);
+        scans[zi] = ZoneScan();
       }
     }
 
+    const phase::Scope timer("cg_close");
     CheckCg(cg_close(fn), "cg_close");
   }
   catch (...)
@@ -1,16 +1,40 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 // Forward declare to keep this header light and not force VTK includes everywhere.
 class vtkDataObject;
 
+// Floating-point type stored in the CGNS file.
+enum class CgnsPrecision
+{
+  Double, // RealDouble
+  Single  // RealSingle: halves file size and I/O time; fine for visualisation-only exports
+};
+
+// Renumbering of the points and cells of unstructured zones before they are written, so that
+// readers touch nearby memory and HDF5 chunks for nearby parts of the mesh.
+enum class CgnsReorder
+{
+  None,               // VTK order
+  Hilbert,            // points by coordinates and cells by centroid (mean of their points) along a Hilbert curve
+  ReverseCuthillMcKee // points by reverse Cuthill-McKee on the graph of points sharing a cell,
+                      // cells by the smallest new number of their points
+};
+
 struct CgnsWriterOptions
 {
   // Try to request HDF5 as the CGNS backend for newly created files.
   // Note: Whether this is honored depends on how your CGNS library was built.
   bool useHdf5 = true;
 
+  // HDF5 deflate level: 0 = uncompressed, 1-9 = compressed (requires useHdf5).
+  // libcgns chooses the chunk layout of compressed datasets. The level is
+  // process-wide libcgns state and is re-applied on every Write.
+  int compressionLevel = 0;
+
   // If true, ghost cells (VTK "vtkGhostType") will be skipped when writing unstructured elements.
   bool skipGhostCells = true;
 
@@ -18,6 +42,16 @@ struct CgnsWriterOptions
   // This is always true, but exposed as an option to make the intent explicit.
   bool oneBasedConnectivity = true;
 
+  // If true, unstructured zones get a single MIXED section holding the cells in their VTK
+  // order (a type tag per element plus an offsets array) instead of one section per
+  // element type. Cell data is then written in VTK order without being reordered.
+  bool mixedSection = false;
+
+  // Renumbering of the points and cells of unstructured zones, computed with vtkSMPTools.
+  // Point and cell data follow their points and cells; structured zones keep their order.
+  // Preparing a reordered zone holds a copy of its connectivity until its sections are built.
+  CgnsReorder reorder = CgnsReorder::None;
+
   // If true, write point-data arrays as Vertex-located FlowSolution.
   bool writePointData = true;
 
@@ -29,6 +63,77 @@ struct CgnsWriterOptions
 
   // Zone name prefix. For composite inputs, zones become Zone0, Zone1, ...
   std::string zoneNamePrefix = "Zone";
+
+  // Precision of coordinates, point-data fields and cell-data fields in the file.
+  CgnsPrecision coordPrecision = CgnsPrecision::Double;
+  CgnsPrecision pointDataPrecision = CgnsPrecision::Double;
+  CgnsPrecision cellDataPrecision = CgnsPrecision::Double;
+
+  // Coordinates of vtkImageData and vtkRectilinearGrid zones are generated from the
+  // origin/spacing/direction or the axis arrays. If > 0, they are generated and written
+  // this many k-planes at a time with partial writes, which bounds memory for very large
+  // volumes; 0 writes each coordinate array in one go.
+  int coordSlabPlanes = 0;
+
+  // If true, fields keep the type of their VTK array where CGNS has one: integer arrays
+  // become Integer (up to 32 bits) or LongInteger fields and float arrays RealSingle, so
+  // the two field precisions above only apply to the other arrays (e.g. double). Unsigned
+  // 64-bit arrays with values above the LongInteger range stay real.
+  // If false (default), every field is real in the precision above.
+  bool nativeFieldTypes = false;
+
+  // Worker threads that prepare the coordinates, sections and fields of upcoming zones of a
+  // composite input while the calling thread writes the current one; libcgns is only called
+  // from the calling thread. 0 writes zone after zone on the calling thread, < 0 uses one
+  // worker per hardware thread. Single-zone inputs are always written serially.
+  int pipelineThreads = 0;
+
+  // Bytes the prepared but not yet written zones may hold at once when pipelineThreads > 0.
+  // A zone larger than the budget is still prepared, but only when no other zone is in flight.
+  int64_t pipelineMemoryBudget = int64_t(1) << 30;
+
+  // If non-null, receives the largest absolute error introduced by rounding values
+  // to single precision (round-to-nearest). Set to 0 when nothing is rounded.
+  double* maxPrecisionLoss = nullptr;
+};
+
+// Wall time and data volume of one phase of a Write.
+struct CgnsWriterPhaseStats
+{
+  // "flatten", "scan", "reorder", "section", "coords", "fields", "convert" or a libcgns call
+  // such as "cg_section_write".
+  std::string name;
+  double seconds = 0.0; // including the phases nested inside it
+  int64_t calls = 0;
+  int64_t bytes = 0; // data handed to libcgns in the phase, before compression
+};
+
+struct CgnsWriterSectionStats
+{
+  std::string zoneName;
+  std::string name;
+  int elementType = 0; // CGNS ElementType_t
+  int64_t numElements = 0;
+  int64_t bytes = 0; // connectivity
+  double seconds = 0.0;
+  // Bytes saved by writing the connectivity as 32-bit integers instead of a 64-bit cgsize_t;
+  // 0 when some id or offset does not fit.
+  int64_t bytesSaved = 0;
+};
+
+struct CgnsWriterStats
+{
+  double wallSeconds = 0.0;
+  int64_t bytesWritten = 0; // coordinates, connectivity and fields; excludes file metadata
+  int numZones = 0;
+  int64_t numPoints = 0;
+  int64_t numElements = 0;
+
+  // Phases in the order they were first entered. Phases nest (e.g. "coords" contains
+  // its cg_coord_* calls), so their times add up to more than wallSeconds.
+  std::vector<CgnsWriterPhaseStats> phases;
+  std::vector<CgnsWriterSectionStats> sections;
+  int64_t connectivityBytesSaved = 0; // sum of the sections' bytesSaved
 };
 
 class CgnsWriter
@@ -36,6 +141,13 @@ class CgnsWriter
 public:
   // Write a VTK data object (vtkDataSet or vtkCompositeDataSet) to a CGNS file.
   // Throws std::runtime_error on failure.
+  // If stats is non-null it is overwritten with the timings of this call; when the
+  // call throws, it covers the work done before the error.
   static void Write(vtkDataObject* input, const std::string& fileName,
-                    const CgnsWriterOptions& opt = CgnsWriterOptions{});
+                    const CgnsWriterOptions& opt = CgnsWriterOptions{}, CgnsWriterStats* stats = nullptr);
+
+  // Write the trace spans recorded so far as Chrome trace JSON (chrome://tracing, Perfetto).
+  // Returns false when the file cannot be written or tracing was not compiled in
+  // (configure with -DCGNS_WRITER_TRACE=ON). Call it while no Write is running.
+  static bool DumpTrace(const std::string& fileName);
 };
@@ -0,0 +1,319 @@
+#include "CgnsWriterCore.h"
+#include "CgnsWriterCoreInternal.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cgns_writer::detail;
+
+namespace
+{
+// Owned copy of everything an UnstructuredMeshInfo / CgnsWriteOptions points to.
+struct Snapshot
+{
+  std::vector<double> points;
+  std::vector<unsigned char> connectivity;
+  std::vector<unsigned char> offsets;
+  std::vector<unsigned char> types;
+  std::vector<std::vector<unsigned char>> fieldData;
+  std::deque<std::string> strings; // deque: c_str() pointers stay valid as strings are added
+  std::vector<CgnsFieldInfo> pointFields;
+  std::vector<CgnsFieldInfo> cellFields;
+};
+
+struct JobState
+{
+  std::string path;
+  UnstructuredMeshInfo mesh = {};
+  CgnsWriteOptions options = {};
+  bool hasOptions = false;
+  Snapshot snapshot;
+  void (*release)(void*) = nullptr;
+  void* userData = nullptr;
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  int status = CGNS_JOB_PENDING;
+  std::string error;
+};
+
+size_t FieldElementSize(const int dataType)
+{
+  return (dataType == CGNS_FIELD_FLOAT32 || dataType == CGNS_FIELD_INT32) ? 4 : 8;
+}
+
+// Copies s into the snapshot; returns the owned copy, or nullptr for nullptr.
+const char* CopyString(Snapshot& snap, const char* s)
+{
+  if (!s)
+  {
+    return nullptr;
+  }
+  snap.strings.emplace_back(s);
+  return snap.strings.back().c_str();
+}
+
+std::vector<unsigned char> CopyBytes(const void* data, const size_t bytes)
+{
+  const auto* begin = static_cast<const unsigned char*>(data);
+  return std::vector<unsigned char>(begin, begin + bytes);
+}
+
+void CopyFields(Snapshot& snap, const CgnsFieldInfo* fields, const int numFields, const int64_t rows,
+                std::vector<CgnsFieldInfo>& out)
+{
+  out.assign(fields, fields + numFields);
+  for (CgnsFieldInfo& f : out)
+  {
+    const int64_t stride = f.stride != 0 ? f.stride : f.num_components;
+    const size_t count = static_cast<size_t>((rows - 1) * stride + f.num_components);
+    snap.fieldData.push_back(CopyBytes(f.data, count * FieldElementSize(f.data_type)));
+    f.data = snap.fieldData.back().data();
+    f.stride = stride;
+    f.name = CopyString(snap, f.name);
+  }
+}
+
+// Copies the mesh arrays so the caller may reuse its buffers as soon as the submit returns.
+void TakeSnapshot(JobState& job)
+{
+  Snapshot& snap = job.snapshot;
+  UnstructuredMeshInfo& mesh = job.mesh;
+  const size_t idSize = mesh.use_64bit_ids ? sizeof(int64_t) : sizeof(int32_t);
+
+  snap.points.assign(mesh.points, mesh.points + mesh.num_points * 3);
+  mesh.points = snap.points.data();
+
+  snap.connectivity = CopyBytes(mesh.connectivity, static_cast<size_t>(mesh.connectivity_size) * idSize);
+  mesh.connectivity = snap.connectivity.data();
+
+  snap.offsets = CopyBytes(mesh.offsets, static_cast<size_t>(mesh.num_cells + 1) * idSize);
+  mesh.offsets = snap.offsets.data();
+
+  snap.types = CopyBytes(mesh.types, static_cast<size_t>(mesh.num_cells));
+  mesh.types = snap.types.data();
+
+  CopyFields(snap, mesh.point_fields, mesh.num_point_fields, mesh.num_points, snap.pointFields);
+  mesh.point_fields = snap.pointFields.data();
+  CopyFields(snap, mesh.cell_fields, mesh.num_cell_fields, mesh.num_cells, snap.cellFields);
+  mesh.cell_fields = snap.cellFields.data();
+}
+
+// One background writer drains the queue in submission order. The thread is
+// started on demand and exits when the queue is empty; it is detached so
+// unloading the library never joins it.
+class AsyncWriter
+{
+public:
+  static AsyncWriter& Instance()
+  {
+    // Leaked on purpose: a detached worker may still reference it during process exit.
+    static AsyncWriter* instance = new AsyncWriter();
+    return *instance;
+  }
+
+  // Blocks while queueDepth jobs are pending, then runs prepare() and queues the job.
+  // Waiting before prepare() bounds the number of snapshots alive at once.
+  template <typename Prepare>
+  void Submit(const std::shared_ptr<JobState>& job, const int queueDepth, Prepare prepare)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    SlotFreed.wait(lock, [&] { return Pending < queueDepth; });
+    ++Pending;
+    lock.unlock();
+
+    try
+    {
+      prepare();
+    }
+    catch (...)
+    {
+      lock.lock();
+      --Pending;
+      lock.unlock();
+      SlotFreed.notify_all();
+      throw;
+    }
+
+    lock.lock();
+    Queue.push_back(job);
+    if (!WorkerRunning)
+    {
+      try
+      {
+        std::thread(&AsyncWriter::Run, this).detach();
+      }
+      catch (...)
+      {
+        Queue.pop_back();
+        --Pending;
+        lock.unlock();
+        SlotFreed.notify_all();
+        throw;
+      }
+      WorkerRunning = true;
+    }
+  }
+
+private:
+  void Run()
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (!Queue.empty())
+    {
+      std::shared_ptr<JobState> job = Queue.front();
+      Queue.pop_front();
+      lock.unlock();
+
+      Execute(*job);
+
+      lock.lock();
+      --Pending;
+      SlotFreed.notify_all();
+    }
+    WorkerRunning = false;
+  }
+
+  static void Execute(JobState& job)
+  {
+    const int rc = cgns_writer::WriteUnstructured(job.mesh, job.path.c_str(), job.hasOptions ? &job.options : nullptr);
+    const std::string error = rc == 0 ? std::string() : std::string(cgns_get_last_error());
+    if (job.release)
+    {
+      job.release(job.userData);
+    }
+    job.snapshot = Snapshot();
+
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.status = rc == 0 ? CGNS_JOB_SUCCEEDED : CGNS_JOB_FAILED;
+    job.error = error;
+    job.finished.notify_all();
+  }
+
+  std::mutex Mutex;
+  std::condition_variable SlotFreed;
+  std::deque<std::shared_ptr<JobState>> Queue;
+  int Pending = 0;
+  bool WorkerRunning = false;
+};
+} // namespace
+
+struct CgnsWriteJob
+{
+  std::shared_ptr<JobState> state;
+};
+
+extern "C" CGNS_WRITER_API int cgns_write_unstructured_async(const UnstructuredMeshInfo* mesh,
+                                                             const char* output_path,
+                                                             const CgnsWriteOptions* options,
+                                                             void (*release)(void* user_data),
+                                                             void* user_data,
+                                                             CgnsWriteJob** out_job)
+{
+  try
+  {
+    if (!out_job)
+    {
+      throw std::runtime_error("out_job is null");
+    }
+    *out_job = nullptr;
+    if (!mesh)
+    {
+      throw std::runtime_error("mesh is null");
+    }
+    if (!output_path || output_path[0] == '\0')
+    {
+      throw std::runtime_error("output_path is null or empty");
+    }
+    // Argument errors are reported here; topology errors surface through the job.
+    CheckStructSizes(mesh, options);
+    ValidateMesh(*mesh);
+
+    auto job = std::make_shared<JobState>();
+    job->path = output_path;
+    job->mesh = *mesh;
+    job->release = release;
+    job->userData = user_data;
+    if (options)
+    {
+      job->options = *options;
+      job->hasOptions = true;
+      job->options.base_name = CopyString(job->snapshot, options->base_name);
+      job->options.zone_name = CopyString(job->snapshot, options->zone_name);
+    }
+
+    const int queueDepth = (options && options->async_queue_depth > 0) ? options->async_queue_depth : 2;
+    AsyncWriter::Instance().Submit(job, queueDepth, [&] {
+      if (!release)
+      {
+        TakeSnapshot(*job);
+      }
+    });
+
+    *out_job = new CgnsWriteJob{ job };
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_job_poll(const CgnsWriteJob* job)
+{
+  if (!job)
+  {
+    SetLastError("job is null");
+    return CGNS_JOB_FAILED;
+  }
+  std::lock_guard<std::mutex> lock(job->state->mutex);
+  return job->state->status;
+}
+
+extern "C" CGNS_WRITER_API int cgns_job_wait(const CgnsWriteJob* job)
+{
+  if (!job)
+  {
+    SetLastError("job is null");
+    return 1;
+  }
+  JobState& state = *job->state;
+  std::unique_lock<std::mutex> lock(state.mutex);
+  state.finished.wait(lock, [&] { return state.status != CGNS_JOB_PENDING; });
+  SetLastError(state.error);
+  return state.status == CGNS_JOB_SUCCEEDED ? 0 : 1;
+}
+
+extern "C" CGNS_WRITER_API const char* cgns_job_error(const CgnsWriteJob* job)
+{
+  if (!job)
+  {
+    return "job is null";
+  }
+  std::lock_guard<std::mutex> lock(job->state->mutex);
+  // The string is only assigned once, when the job finishes, so the pointer stays valid.
+  return job->state->error.c_str();
+}
+
+extern "C" CGNS_WRITER_API void cgns_job_free(CgnsWriteJob* job)
+{
+  if (!job)
+  {
+    return;
+  }
+  {
+    JobState& state = *job->state;
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.finished.wait(lock, [&] { return state.status != CGNS_JOB_PENDING; });
+  }
+  delete job;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+// 32-bit element connectivity: when libcgns is built with a 64-bit cgsize_t, a section whose
+// node ids and offsets all fit in an int32_t is kept and written as Integer data, which halves
+// its size in memory and on disk. Header-only so that both cgns_writer and cgns_writer_dll can
+// use it; not part of either library's public API.
+
+#include <cgnslib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// cg_section_general_write / cg_elements_general_write / cg_poly_elements_general_write
+// (connectivity in a data type other than cgsize_t) are available from CGNS 4.1.
+#if defined(CGNS_VERSION) && CGNS_VERSION >= 4100
+#  define CGNS_WRITER_HAVE_GENERAL_SECTION 1
+#else
+#  define CGNS_WRITER_HAVE_GENERAL_SECTION 0
+#endif
+
+namespace cgns_writer
+{
+namespace connectivity
+{
+// Runs fn(block) for every block in [0, numBlocks), possibly concurrently.
+using ParallelFor = std::function<void(size_t, const std::function<void(size_t)>&)>;
+
+// True when sections can be narrowed: cgsize_t is wider than 32 bits and libcgns takes
+// connectivity in an explicit data type.
+constexpr bool kCanNarrow = sizeof(cgsize_t) > sizeof(int32_t) && CGNS_WRITER_HAVE_GENERAL_SECTION;
+
+// Copies values into out as int32_t, in numBlocks parallel blocks. Returns false and leaves
+// out empty when a value does not fit.
+inline bool NarrowTo32(const std::vector<cgsize_t>& values, std::vector<int32_t>& out, const size_t numBlocks,
+                       const ParallelFor& parallelFor)
+{
+  const int64_t n = static_cast<int64_t>(values.size());
+  out.resize(values.size());
+  std::atomic<bool> fits(true);
+  parallelFor(numBlocks, [&](const size_t b) {
+    const int64_t first = n * static_cast<int64_t>(b) / static_cast<int64_t>(numBlocks);
+    const int64_t last = n * static_cast<int64_t>(b + 1) / static_cast<int64_t>(numBlocks);
+    int64_t lo = 0;
+    int64_t hi = 0;
+    for (int64_t i = first; i < last; ++i)
+    {
+      const int64_t v = static_cast<int64_t>(values[static_cast<size_t>(i)]);
+      lo = std::min(lo, v);
+      hi = std::max(hi, v);
+      out[static_cast<size_t>(i)] = static_cast<int32_t>(v);
+    }
+    if (lo < std::numeric_limits<int32_t>::min() || hi > std::numeric_limits<int32_t>::max())
+    {
+      fits = false;
+    }
+  });
+  if (!fits)
+  {
+    std::vector<int32_t>().swap(out);
+  }
+  return fits;
+}
+
+// Moves the connectivity and offsets of a section (any struct with cgsize_t vectors conn and
+// offsets and int32_t vectors conn32 and offsets32) into conn32 and offsets32 when every value
+// fits, releasing the cgsize_t arrays one at a time. Returns whether the section was narrowed;
+// it is left as it was when it was not, or when kCanNarrow is false.
+template <typename SectionT>
+bool Narrow(SectionT& s, const size_t numBlocks, const ParallelFor& parallelFor)
+{
+  // Offsets run from 0 up to conn.size(), so the last one decides.
+  if (!kCanNarrow || s.conn.empty() ||
+      (!s.offsets.empty() && static_cast<int64_t>(s.offsets.back()) > std::numeric_limits<int32_t>::max()) ||
+      !NarrowTo32(s.conn, s.conn32, numBlocks, parallelFor))
+  {
+    return false;
+  }
+  std::vector<cgsize_t>().swap(s.conn);
+  NarrowTo32(s.offsets, s.offsets32, numBlocks, parallelFor);
+  std::vector<cgsize_t>().swap(s.offsets);
+  return true;
+}
+
+// Connectivity and offsets bytes of a section as handed to libcgns.
+template <typename SectionT>
+int64_t Bytes(const SectionT& s)
+{
+  return static_cast<int64_t>((s.conn.size() + s.offsets.size()) * sizeof(cgsize_t) +
+                              (s.conn32.size() + s.offsets32.size()) * sizeof(int32_t));
+}
+
+// Bytes a narrowed section saves over cgsize_t connectivity and offsets.
+template <typename SectionT>
+int64_t BytesSaved(const SectionT& s)
+{
+  return static_cast<int64_t>((s.conn32.size() + s.offsets32.size()) * (sizeof(cgsize_t) - sizeof(int32_t)));
+}
+
+// Writes a narrowed section as Integer data: cg_section_general_write creates the section, then
+// cg_elements_general_write, or cg_poly_elements_general_write for one with offsets, fills it.
+// Returns the libcgns error code. Only called for sections Narrow has narrowed.
+template <typename SectionT>
+int WriteNarrowed(const int fn, const int B, const int Z, const SectionT& s, int* S)
+{
+#if CGNS_WRITER_HAVE_GENERAL_SECTION
+  int ierr = cg_section_general_write(fn, B, Z, s.name.c_str(), s.type, CGNS_ENUMV(Integer), s.start, s.end,
+                                      static_cast<cgsize_t>(s.conn32.size()), 0, S);
+  if (ierr != CG_OK)
+  {
+    return ierr;
+  }
+  if (s.offsets32.empty())
+  {
+    return cg_elements_general_write(fn, B, Z, *S, s.start, s.end, CGNS_ENUMV(Integer), s.conn32.data());
+  }
+  return cg_poly_elements_general_write(fn, B, Z, *S, s.start, s.end, CGNS_ENUMV(Integer), s.conn32.data(),
+                                        s.offsets32.data());
+#else
+  (void)fn;
+  (void)B;
+  (void)Z;
+  (void)s;
+  (void)S;
+  return CG_ERROR;
+#endif
+}
+} // namespace connectivity
+} // namespace cgns_writer
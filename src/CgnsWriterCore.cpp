@@ -1,42 +1,87 @@
 #include "CgnsWriterCore.h"
+#include "CgnsWriterConnectivity.h"
+#include "CgnsWriterCoreInternal.h"
+#include "CgnsWriterNodeOrder.h"
+#include "CgnsWriterOutput.h"
+#include "CgnsWriterPolyhedra.h"
+#include "CgnsWriterReorder.h"
+#include "CgnsWriterTrace.h"
 
 #include <cgnslib.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace
 {
+using cgns_writer::output::DataTypeSize;
+
 thread_local std::string g_last_error;
 
-void SetLastError(const std::string& msg)
+// Stats of the last synchronous write on this thread. The C view points into record.
+struct LastStats
 {
-  g_last_error = msg;
+  cgns_writer::phase::Record record;
+  std::vector<CgnsPhaseStats> phases;
+  std::vector<CgnsSectionStats> sections;
+  CgnsWriteStats view = {};
+  bool valid = false;
+};
+thread_local LastStats g_last_stats;
+
+std::recursive_mutex& LibraryMutex()
+{
+  static std::recursive_mutex mutex;
+  return mutex;
 }
 
-void CheckCg(const int ierr, const std::string& what)
+// Guarded by LibraryMutex(): the compression level each open HDF5 file was created
+// with, and the level last passed to libcgns (-1 = not set by us yet).
+std::unordered_map<int, int> g_file_compression;
+int g_applied_compression = -1;
+
+std::unique_lock<std::recursive_mutex> AcquireLibrary(const bool timed)
 {
-  if (ierr == CG_OK)
-  {
-    return;
-  }
-  const char* msg = cg_get_error();
-  std::string err = msg ? msg : "Unknown CGNS error";
-  throw std::runtime_error(what + ": " + err);
+  const cgns_writer::phase::Scope wait(timed ? "cgns lock wait" : nullptr);
+  return std::unique_lock<std::recursive_mutex>(LibraryMutex());
 }
 
 constexpr unsigned char VTK_VERTEX = 1;
 constexpr unsigned char VTK_LINE = 3;
 constexpr unsigned char VTK_TRIANGLE = 5;
+constexpr unsigned char VTK_POLYGON = 7;
 constexpr unsigned char VTK_QUAD = 9;
 constexpr unsigned char VTK_TETRA = 10;
 constexpr unsigned char VTK_HEXAHEDRON = 12;
 constexpr unsigned char VTK_WEDGE = 13;
 constexpr unsigned char VTK_PYRAMID = 14;
+constexpr unsigned char VTK_QUADRATIC_EDGE = 21;
+constexpr unsigned char VTK_QUADRATIC_TRIANGLE = 22;
+constexpr unsigned char VTK_QUADRATIC_QUAD = 23;
+constexpr unsigned char VTK_QUADRATIC_TETRA = 24;
+constexpr unsigned char VTK_QUADRATIC_HEXAHEDRON = 25;
+constexpr unsigned char VTK_QUADRATIC_WEDGE = 26;
+constexpr unsigned char VTK_QUADRATIC_PYRAMID = 27;
+constexpr unsigned char VTK_BIQUADRATIC_QUAD = 28;
+constexpr unsigned char VTK_TRIQUADRATIC_HEXAHEDRON = 29;
+constexpr unsigned char VTK_BIQUADRATIC_QUADRATIC_WEDGE = 32;
+constexpr unsigned char VTK_POLYHEDRON = 42;
 
 bool MapVtkCellToCgns(const unsigned char vtkCellType,
                       CGNS_ENUMT(ElementType_t)& outType,
@@ -85,282 +130,1882 @@ bool MapVtkCellToCgns(const unsigned char vtkCellType,
       outNodes = 8;
       outDim = 3;
       return true;
+    // Quadratic cells; CgnsWriterNodeOrder.h puts their nodes in CGNS order.
+    case VTK_QUADRATIC_EDGE:
+      outType = CGNS_ENUMV(BAR_3);
+      outNodes = 3;
+      outDim = 1;
+      return true;
+    case VTK_QUADRATIC_TRIANGLE:
+      outType = CGNS_ENUMV(TRI_6);
+      outNodes = 6;
+      outDim = 2;
+      return true;
+    case VTK_QUADRATIC_QUAD:
+      outType = CGNS_ENUMV(QUAD_8);
+      outNodes = 8;
+      outDim = 2;
+      return true;
+    case VTK_BIQUADRATIC_QUAD:
+      outType = CGNS_ENUMV(QUAD_9);
+      outNodes = 9;
+      outDim = 2;
+      return true;
+    case VTK_QUADRATIC_TETRA:
+      outType = CGNS_ENUMV(TETRA_10);
+      outNodes = 10;
+      outDim = 3;
+      return true;
+    case VTK_QUADRATIC_PYRAMID:
+      outType = CGNS_ENUMV(PYRA_13);
+      outNodes = 13;
+      outDim = 3;
+      return true;
+    case VTK_QUADRATIC_WEDGE:
+      outType = CGNS_ENUMV(PENTA_15);
+      outNodes = 15;
+      outDim = 3;
+      return true;
+    case VTK_BIQUADRATIC_QUADRATIC_WEDGE:
+      outType = CGNS_ENUMV(PENTA_18);
+      outNodes = 18;
+      outDim = 3;
+      return true;
+    case VTK_QUADRATIC_HEXAHEDRON:
+      outType = CGNS_ENUMV(HEXA_20);
+      outNodes = 20;
+      outDim = 3;
+      return true;
+    case VTK_TRIQUADRATIC_HEXAHEDRON:
+      outType = CGNS_ENUMV(HEXA_27);
+      outNodes = 27;
+      outDim = 3;
+      return true;
+    // Variable node counts (outNodes = 0): a polygon lists its nodes, a polyhedron its face stream.
+    case VTK_POLYGON:
+      outType = CGNS_ENUMV(NGON_n);
+      outNodes = 0;
+      outDim = 2;
+      return true;
+    case VTK_POLYHEDRON:
+      outType = CGNS_ENUMV(NFACE_n);
+      outNodes = 0;
+      outDim = 3;
+      return true;
     default:
       return false;
   }
 }
 
-std::string DefaultSectionName(CGNS_ENUMT(ElementType_t) t)
+std::string ComponentSuffix(const int c)
 {
-  switch (t)
+  // Common convention
+  static const char* names[] = { "X", "Y", "Z", "W" };
+  if (c >= 0 && c < 4)
   {
-    case CGNS_ENUMV(NODE):
-      return "Nodes";
-    case CGNS_ENUMV(BAR_2):
-      return "Bars";
-    case CGNS_ENUMV(TRI_3):
-      return "Tris";
-    case CGNS_ENUMV(QUAD_4):
-      return "Quads";
-    case CGNS_ENUMV(TETRA_4):
-      return "Tets";
-    case CGNS_ENUMV(PYRA_5):
-      return "Pyrs";
-    case CGNS_ENUMV(PENTA_6):
-      return "Wedges";
-    case CGNS_ENUMV(HEXA_8):
-      return "Hexes";
-    default:
-      return "Elements";
+    return names[c];
   }
+  return "C" + std::to_string(c);
 }
 
-int64_t GetOffset(const UnstructuredMeshInfo& mesh, const int64_t index)
+CGNS_ENUMT(DataType_t) FieldMemoryType(const int dataType)
 {
-  if (mesh.use_64bit_ids)
+  switch (dataType)
   {
-    const auto* offsets = static_cast<const int64_t*>(mesh.offsets);
-    return offsets[index];
+    case CGNS_FIELD_FLOAT32:
+      return CGNS_ENUMV(RealSingle);
+    case CGNS_FIELD_INT32:
+      return CGNS_ENUMV(Integer);
+    case CGNS_FIELD_INT64:
+      return CGNS_ENUMV(LongInteger);
+    default:
+      return CGNS_ENUMV(RealDouble);
   }
-  const auto* offsets = static_cast<const int32_t*>(mesh.offsets);
-  return static_cast<int64_t>(offsets[index]);
 }
 
-int64_t GetConn(const UnstructuredMeshInfo& mesh, const int64_t index)
+// Min/max as selects with no early exit so the loop compiles to packed min/max instructions.
+template <typename IdT>
+void IdRangeImpl(const IdT* ids, const size_t count, int64_t& lo, int64_t& hi)
 {
-  if (mesh.use_64bit_ids)
+  IdT mn = std::numeric_limits<IdT>::max();
+  IdT mx = std::numeric_limits<IdT>::lowest();
+  for (size_t i = 0; i < count; ++i)
   {
-    const auto* conn = static_cast<const int64_t*>(mesh.connectivity);
-    return conn[index];
+    const IdT v = ids[i];
+    mn = v < mn ? v : mn;
+    mx = v > mx ? v : mx;
   }
-  const auto* conn = static_cast<const int32_t*>(mesh.connectivity);
-  return static_cast<int64_t>(conn[index]);
+  lo = static_cast<int64_t>(mn);
+  hi = static_cast<int64_t>(mx);
 }
 
-struct Section
-{
-  CGNS_ENUMT(ElementType_t) type = CGNS_ENUMV(ElementTypeNull);
-  std::string name;
-  int nodesPerElem = 0;
-  std::vector<cgsize_t> conn;
-  cgsize_t start = 0;
-  cgsize_t end = 0;
-};
-} // namespace
-
-int cgns_writer::WriteUnstructured(const UnstructuredMeshInfo& mesh,
-                                   const char* output_path,
-                                   const CgnsWriteOptions* options)
+template <typename T>
+void GatherAs(const cgns_writer::detail::StridedComponent& src, const int64_t first, const int64_t* rows,
+              const size_t n, void* dst)
 {
-  try
+  const T* in = static_cast<const T*>(src.data) + src.component;
+  T* out = static_cast<T*>(dst);
+  const int64_t stride = src.stride;
+  if (rows)
   {
-    if (!output_path || output_path[0] == '\0')
+    for (size_t k = 0; k < n; ++k)
     {
-      throw std::runtime_error("output_path is null or empty");
+      out[k] = in[rows[k] * stride];
     }
-    if (!mesh.points || mesh.num_points <= 0)
+  }
+  else
+  {
+    // Fixed-stride loads and unit-stride stores; compilers vectorize this with shuffles.
+    in += first * stride;
+    for (size_t k = 0; k < n; ++k)
     {
-      throw std::runtime_error("mesh.points is null or num_points <= 0");
+      out[k] = in[static_cast<int64_t>(k) * stride];
     }
-    if (!mesh.connectivity || mesh.connectivity_size <= 0)
+  }
+}
+
+// Gathers rows of one component in file order into a bounded block and flushes it
+// with a partial write; RealDouble -> RealSingle output is rounded on the way.
+class BlockedComponentWriter
+{
+public:
+  BlockedComponentWriter(const cgns_writer::detail::ArrayTarget& target, const CGNS_ENUMT(DataType_t) fileType,
+                         const cgns_writer::detail::StridedComponent& src, double* maxLoss)
+    : Target(target)
+    , FileType(fileType)
+    , Src(src)
+    , MaxLoss(maxLoss)
+    , Round(fileType == CGNS_ENUMV(RealSingle) && src.type == CGNS_ENUMV(RealDouble))
+  {
+  }
+
+  // Appends n rows at file position fileFirst: rows[0..n) when rows is set, else [first, first + n).
+  void Append(const int64_t fileFirst, const int64_t* rows, const int64_t first, const int64_t n)
+  {
+    if (Pending > 0 && fileFirst != PendingFirst + Pending)
     {
-      throw std::runtime_error("mesh.connectivity is null or connectivity_size <= 0");
+      Flush();
     }
-    if (!mesh.offsets || mesh.num_cells <= 0)
+    for (int64_t done = 0; done < n;)
     {
-      throw std::runtime_error("mesh.offsets is null or num_cells <= 0");
+      if (Pending == 0)
+      {
+        PendingFirst = fileFirst + done;
+        Filling.emplace("convert");
+      }
+      const int64_t m = std::min(n - done, kBlock - Pending);
+      Gather(rows ? rows + done : nullptr, first + done, m);
+      Pending += m;
+      done += m;
+      if (Pending == kBlock)
+      {
+        Flush();
+      }
     }
-    if (!mesh.types)
+  }
+
+  void Flush()
+  {
+    Filling.reset();
+    if (Pending == 0)
     {
-      throw std::runtime_error("mesh.types is null");
+      return;
     }
-
-    const bool useHdf5 = !options || options->use_hdf5 != 0;
-    const char* baseName =
-      (options && options->base_name && options->base_name[0] != '\0') ? options->base_name : "Base";
-    const char* zoneName =
-      (options && options->zone_name && options->zone_name[0] != '\0') ? options->zone_name : "Zone0";
-
-#ifdef CG_FILE_HDF5
-    if (useHdf5)
+    const cgsize_t rmin = static_cast<cgsize_t>(PendingFirst) + 1;
+    const cgsize_t rmax = static_cast<cgsize_t>(PendingFirst + Pending);
+    const void* block = Round ? static_cast<const void*>(Single.data()) : static_cast<const void*>(Bytes.data());
+    const cgns_writer::detail::CgnsAccess access(Target.fn,
+                                                 Target.S == 0 ? "cg_coord_partial_write" : "cg_field_partial_write",
+                                                 Pending * DataTypeSize(FileType));
+    int id = 0;
+    if (Target.S == 0)
     {
-      (void)cg_set_file_type(CG_FILE_HDF5);
+      cgns_writer::detail::CheckCg(
+        cg_coord_partial_write(Target.fn, Target.B, Target.Z, FileType, Target.name, &rmin, &rmax, block, &id),
+        std::string("cg_coord_partial_write(") + Target.name + ")");
     }
     else
     {
-      (void)cg_set_file_type(CG_FILE_ADF);
+      cgns_writer::detail::CheckCg(cg_field_partial_write(Target.fn, Target.B, Target.Z, Target.S, FileType,
+                                                          Target.name, &rmin, &rmax, block, &id),
+                                   std::string("cg_field_partial_write(") + Target.name + ")");
     }
-#else
-    (void)useHdf5;
-#endif
+    Pending = 0;
+  }
 
-    int fn = 0;
-    CheckCg(cg_open(output_path, CG_MODE_WRITE, &fn), "cg_open");
+private:
+  static constexpr int64_t kBlock = 1 << 16;
 
-    try
+  void Gather(const int64_t* rows, const int64_t first, const int64_t m)
+  {
+    const size_t n = static_cast<size_t>(m);
+    const size_t at = static_cast<size_t>(Pending);
+    if (Round)
     {
-      std::vector<double> x(static_cast<size_t>(mesh.num_points));
-      std::vector<double> y(static_cast<size_t>(mesh.num_points));
-      std::vector<double> z(static_cast<size_t>(mesh.num_points));
-      for (int64_t i = 0; i < mesh.num_points; ++i)
+      Single.resize(static_cast<size_t>(kBlock));
+      if (!rows)
       {
-        const int64_t base = i * 3;
-        x[static_cast<size_t>(i)] = mesh.points[base + 0];
-        y[static_cast<size_t>(i)] = mesh.points[base + 1];
-        z[static_cast<size_t>(i)] = mesh.points[base + 2];
+        // Round straight from the strided source.
+        const double* in = static_cast<const double*>(Src.data) + Src.component + first * Src.stride;
+        cgns_writer::output::RoundToSingle(in, static_cast<size_t>(Src.stride), n, Single.data() + at, MaxLoss);
+        return;
       }
+      Bytes.resize(n * sizeof(double));
+      GatherAs<double>(Src, first, rows, n, Bytes.data());
+      cgns_writer::output::RoundToSingle(reinterpret_cast<const double*>(Bytes.data()), 1, n, Single.data() + at,
+                                         MaxLoss);
+      return;
+    }
 
-      std::vector<Section> sections;
-      std::unordered_map<int, size_t> typeToSectionIndex;
+    switch (Src.type)
+    {
+      case CGNS_ENUMV(RealSingle):
+        GatherInto<float>(rows, first, n, at);
+        break;
+      case CGNS_ENUMV(Integer):
+        GatherInto<int32_t>(rows, first, n, at);
+        break;
+      case CGNS_ENUMV(LongInteger):
+        GatherInto<int64_t>(rows, first, n, at);
+        break;
+      default:
+        GatherInto<double>(rows, first, n, at);
+        break;
+    }
+  }
 
-      int cellDim = 0;
+  template <typename T>
+  void GatherInto(const int64_t* rows, const int64_t first, const size_t n, const size_t at)
+  {
+    Bytes.resize(static_cast<size_t>(kBlock) * sizeof(T));
+    GatherAs<T>(Src, first, rows, n, Bytes.data() + at * sizeof(T));
+  }
 
-      for (int64_t cellId = 0; cellId < mesh.num_cells; ++cellId)
-      {
-        const int64_t start = GetOffset(mesh, cellId);
-        const int64_t end = GetOffset(mesh, cellId + 1);
-        if (start < 0 || end < start || end > mesh.connectivity_size)
-        {
-          throw std::runtime_error("Invalid offsets/connectivity_size for cell " + std::to_string(cellId));
-        }
+  cgns_writer::detail::ArrayTarget Target;
+  CGNS_ENUMT(DataType_t) FileType;
+  cgns_writer::detail::StridedComponent Src;
+  double* MaxLoss = nullptr;
+  bool Round = false;
+  int64_t PendingFirst = 0;
+  int64_t Pending = 0;
+  std::vector<unsigned char> Bytes;
+  std::vector<float> Single;
+  // Times gathering as "convert", from the first row of a block until it is flushed.
+  std::optional<cgns_writer::phase::Scope> Filling;
+};
+} // namespace
 
-        const unsigned char vtkType = mesh.types[cellId];
-        CGNS_ENUMT(ElementType_t) cgnsType = CGNS_ENUMV(ElementTypeNull);
-        int nodesPerElem = 0;
-        int elemDim = 0;
-        if (!MapVtkCellToCgns(vtkType, cgnsType, nodesPerElem, elemDim))
-        {
-          throw std::runtime_error("Unsupported VTK cell type " + std::to_string(vtkType));
-        }
+namespace cgns_writer
+{
+namespace detail
+{
+void SetLastError(const std::string& msg)
+{
+  g_last_error = msg;
+}
 
-        const int64_t cellSize = end - start;
-        if (cellSize != nodesPerElem)
-        {
-          throw std::runtime_error("Cell " + std::to_string(cellId) + " has " +
-                                   std::to_string(cellSize) + " nodes, expected " +
-                                   std::to_string(nodesPerElem));
-        }
+void CheckCg(const int ierr, const std::string& what)
+{
+  if (ierr == CG_OK)
+  {
+    return;
+  }
+  const char* msg = cg_get_error();
+  std::string err = msg ? msg : "Unknown CGNS error";
+  throw std::runtime_error(what + ": " + err);
+}
 
-        cellDim = std::max(cellDim, elemDim);
+std::string DefaultSectionName(CGNS_ENUMT(ElementType_t) t)
+{
+  switch (t)
+  {
+    case CGNS_ENUMV(NODE):
+      return "Nodes";
+    case CGNS_ENUMV(BAR_2):
+      return "Bars";
+    case CGNS_ENUMV(TRI_3):
+      return "Tris";
+    case CGNS_ENUMV(QUAD_4):
+      return "Quads";
+    case CGNS_ENUMV(TETRA_4):
+      return "Tets";
+    case CGNS_ENUMV(PYRA_5):
+      return "Pyrs";
+    case CGNS_ENUMV(PENTA_6):
+      return "Wedges";
+    case CGNS_ENUMV(HEXA_8):
+      return "Hexes";
+    case CGNS_ENUMV(BAR_3):
+      return "Bars3";
+    case CGNS_ENUMV(TRI_6):
+      return "Tris6";
+    case CGNS_ENUMV(QUAD_8):
+      return "Quads8";
+    case CGNS_ENUMV(QUAD_9):
+      return "Quads9";
+    case CGNS_ENUMV(TETRA_10):
+      return "Tets10";
+    case CGNS_ENUMV(PYRA_13):
+      return "Pyrs13";
+    case CGNS_ENUMV(PENTA_15):
+      return "Wedges15";
+    case CGNS_ENUMV(PENTA_18):
+      return "Wedges18";
+    case CGNS_ENUMV(HEXA_20):
+      return "Hexes20";
+    case CGNS_ENUMV(HEXA_27):
+      return "Hexes27";
+    case CGNS_ENUMV(MIXED):
+      return "Mixed";
+    case CGNS_ENUMV(NGON_n):
+      return "Polygons";
+    case CGNS_ENUMV(NFACE_n):
+      return "Polyhedra";
+    default:
+      return "Elements";
+  }
+}
 
-        const int key = static_cast<int>(cgnsType);
-        size_t sidx = 0;
-        auto it = typeToSectionIndex.find(key);
-        if (it == typeToSectionIndex.end())
-        {
-          Section s;
-          s.type = cgnsType;
-          s.nodesPerElem = nodesPerElem;
-          s.name = DefaultSectionName(cgnsType);
-          sections.push_back(std::move(s));
-          sidx = sections.size() - 1;
-          typeToSectionIndex[key] = sidx;
-        }
-        else
-        {
-          sidx = it->second;
-        }
+const std::array<CellTypeInfo, 256>& CellTypeTable()
+{
+  static const std::array<CellTypeInfo, 256> table = [] {
+    std::array<CellTypeInfo, 256> t{};
+    for (int v = 0; v < 256; ++v)
+    {
+      CellTypeInfo& info = t[static_cast<size_t>(v)];
+      info.supported = MapVtkCellToCgns(static_cast<unsigned char>(v), info.type, info.nodesPerElem, info.dim);
+    }
+    return t;
+  }();
+  return table;
+}
 
-        Section& s = sections[sidx];
-        for (int64_t i = start; i < end; ++i)
-        {
-          const int64_t id = GetConn(mesh, i);
-          if (id < 0 || id >= mesh.num_points)
-          {
-            throw std::runtime_error("Connectivity id out of range at index " + std::to_string(i));
-          }
-          s.conn.push_back(static_cast<cgsize_t>(id + 1));
-        }
-      }
+const std::array<int64_t, 256>& NodesPerElemTable()
+{
+  static const std::array<int64_t, 256> table = [] {
+    std::array<int64_t, 256> t{};
+    for (size_t v = 0; v < t.size(); ++v)
+    {
+      t[v] = CellTypeTable()[v].nodesPerElem;
+    }
+    t[VTK_POLYGON] = -3;
+    return t;
+  }();
+  return table;
+}
 
-      cgsize_t elem = 1;
-      for (auto& s : sections)
-      {
-        const cgsize_t ne = static_cast<cgsize_t>(s.conn.size() / static_cast<size_t>(s.nodesPerElem));
-        if (ne == 0)
-        {
-          continue;
-        }
-        s.start = elem;
-        s.end = elem + ne - 1;
-        elem = s.end + 1;
-      }
+int ValidateLevel(const CgnsWriteOptions* options)
+{
+  const int level = options ? options->validate : CGNS_VALIDATE_FAST;
+  if (level != CGNS_VALIDATE_FAST && level != CGNS_VALIDATE_FULL && level != CGNS_VALIDATE_NONE)
+  {
+    throw std::runtime_error("Unknown validate level " + std::to_string(level));
+  }
+  return level;
+}
 
-      const cgsize_t nCellsWritten = elem - 1;
-      const cgsize_t nVerts = static_cast<cgsize_t>(mesh.num_points);
-      const int physDim = 3;
-      if (cellDim <= 0)
-      {
-        cellDim = 3;
-      }
+int SectionLayout(const CgnsWriteOptions* options)
+{
+  const int layout = options ? options->section_layout : CGNS_SECTIONS_BY_TYPE;
+  if (layout != CGNS_SECTIONS_BY_TYPE && layout != CGNS_SECTIONS_MIXED)
+  {
+    throw std::runtime_error("Unknown section layout " + std::to_string(layout));
+  }
+  return layout;
+}
 
-      int B = 0;
-      CheckCg(cg_base_write(fn, baseName, cellDim, physDim, &B), "cg_base_write");
-
-      cgsize_t size[3] = { 0 };
-      size[0] = nVerts;
-      size[1] = nCellsWritten;
-      size[2] = 0;
-
-      int Z = 0;
-      CheckCg(cg_zone_write(fn, B, zoneName, size, CGNS_ENUMV(Unstructured), &Z),
-              "cg_zone_write(Unstructured)");
-
-      int Cx = 0, Cy = 0, Cz = 0;
-      CheckCg(cg_coord_write(fn, B, Z, CGNS_ENUMV(RealDouble), "CoordinateX", x.data(), &Cx),
-              "cg_coord_write(CoordinateX)");
-      CheckCg(cg_coord_write(fn, B, Z, CGNS_ENUMV(RealDouble), "CoordinateY", y.data(), &Cy),
-              "cg_coord_write(CoordinateY)");
-      CheckCg(cg_coord_write(fn, B, Z, CGNS_ENUMV(RealDouble), "CoordinateZ", z.data(), &Cz),
-              "cg_coord_write(CoordinateZ)");
-
-      for (auto& s : sections)
-      {
-        if (s.conn.empty())
-        {
-          continue;
-        }
-        int S = 0;
-        CheckCg(cg_section_write(fn, B, Z, s.name.c_str(), s.type, s.start, s.end, 0, s.conn.data(), &S),
-                "cg_section_write(" + s.name + ")");
-      }
+int ReorderMethod(const CgnsWriteOptions* options)
+{
+  const int method = options ? options->reorder : CGNS_REORDER_NONE;
+  if (method != CGNS_REORDER_NONE && method != CGNS_REORDER_HILBERT && method != CGNS_REORDER_RCM)
+  {
+    throw std::runtime_error("Unknown reorder method " + std::to_string(method));
+  }
+  return method;
+}
 
-      CheckCg(cg_close(fn), "cg_close");
+void IdRange(const int32_t* ids, const size_t count, int64_t& lo, int64_t& hi)
+{
+  IdRangeImpl(ids, count, lo, hi);
+}
+
+void IdRange(const int64_t* ids, const size_t count, int64_t& lo, int64_t& hi)
+{
+  IdRangeImpl(ids, count, lo, hi);
+}
+
+int ResolveThreadCount(const CgnsWriteOptions* options)
+{
+  const int requested = options ? options->num_threads : 0;
+  if (requested < 0)
+  {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+  return std::max(1, requested);
+}
+
+void ParallelBlocks(const size_t numBlocks, const std::function<void(size_t)>& fn)
+{
+  std::vector<std::exception_ptr> errors(numBlocks);
+  auto run = [&](const size_t b) {
+    try
+    {
+      fn(b);
     }
     catch (...)
     {
-      cg_close(fn);
-      throw;
+      errors[b] = std::current_exception();
     }
+  };
 
-    SetLastError("");
-    return 0;
+  std::vector<std::thread> workers;
+  workers.reserve(numBlocks > 0 ? numBlocks - 1 : 0);
+  for (size_t b = 1; b < numBlocks; ++b)
+  {
+    workers.emplace_back(run, b);
   }
-  catch (const std::exception& ex)
+  if (numBlocks > 0)
   {
-    SetLastError(ex.what());
-    return 1;
+    run(0);
+  }
+  for (auto& t : workers)
+  {
+    t.join();
+  }
+
+  for (const auto& e : errors)
+  {
+    if (e)
+    {
+      std::rethrow_exception(e);
+    }
   }
 }
 
-extern "C" CGNS_WRITER_API int cgns_write_unstructured(const UnstructuredMeshInfo* mesh,
-                                                       const char* output_path,
-                                                       const CgnsWriteOptions* options)
+void SetCompression(const bool useHdf5, const int level)
 {
-  if (!mesh)
+  if (level < 0 || level > 9)
   {
-    SetLastError("mesh is null");
-    return 1;
+    throw std::runtime_error("compression_level must be in [0, 9], got " + std::to_string(level));
   }
-  return cgns_writer::WriteUnstructured(*mesh, output_path, options);
+  if (level > 0 && !useHdf5)
+  {
+    throw std::runtime_error("compression_level requires HDF5 output");
+  }
+#ifdef CG_CONFIG_HDF5_COMPRESS
+  if (useHdf5)
+  {
+    // libcgns keeps the level as process-wide state and reads it whenever a dataset is
+    // created, so it is tracked here and re-applied by CgnsAccess for each file.
+    const CgnsAccess access;
+    if (level != g_applied_compression)
+    {
+      CheckCg(cg_configure(CG_CONFIG_HDF5_COMPRESS, reinterpret_cast<void*>(static_cast<intptr_t>(level))),
+              "cg_configure(CG_CONFIG_HDF5_COMPRESS)");
+      g_applied_compression = level;
+    }
+  }
+#else
+  if (level > 0)
+  {
+    throw std::runtime_error("compression_level requires libcgns with CG_CONFIG_HDF5_COMPRESS");
+  }
+#endif
 }
 
-extern "C" CGNS_WRITER_API const char* cgns_get_last_error(void)
+int OpenForWrite(const char* output_path, const CgnsWriteOptions* options)
 {
-  return g_last_error.c_str();
+  const bool useHdf5 = !options || options->use_hdf5 != 0;
+  const int level = options ? options->compression_level : 0;
+  const CgnsAccess access(0, "cg_open");
+#ifdef CG_FILE_HDF5
+  if (useHdf5)
+  {
+    (void)cg_set_file_type(CG_FILE_HDF5);
+  }
+  else
+  {
+    (void)cg_set_file_type(CG_FILE_ADF);
+  }
+#endif
+  SetCompression(useHdf5, level);
+
+  int fn = 0;
+  CheckCg(cg_open(output_path, CG_MODE_WRITE, &fn), "cg_open");
+  // File ids are reused after cg_close, so an entry is simply overwritten by the next open.
+  if (useHdf5)
+  {
+    g_file_compression[fn] = level;
+  }
+  else
+  {
+    g_file_compression.erase(fn);
+  }
+  return fn;
+}
+
+CgnsAccess::CgnsAccess(const int fn, const char* call, const int64_t bytes)
+  : Lock(AcquireLibrary(call != nullptr))
+  , Held(call, bytes)
+{
+#ifdef CG_CONFIG_HDF5_COMPRESS
+  const auto it = fn > 0 ? g_file_compression.find(fn) : g_file_compression.end();
+  if (it != g_file_compression.end() && it->second != g_applied_compression)
+  {
+    CheckCg(cg_configure(CG_CONFIG_HDF5_COMPRESS, reinterpret_cast<void*>(static_cast<intptr_t>(it->second))),
+            "cg_configure(CG_CONFIG_HDF5_COMPRESS)");
+    g_applied_compression = it->second;
+  }
+#else
+  (void)fn;
+#endif
+}
+
+CGNS_ENUMT(DataType_t) PrecisionType(const int precision)
+{
+  return output::RealType(precision == CGNS_PRECISION_SINGLE);
+}
+
+bool CanWriteStrided(const CGNS_ENUMT(DataType_t) fileType, const CGNS_ENUMT(DataType_t) memType)
+{
+#if CGNS_WRITER_HAVE_GENERAL_WRITE
+  return fileType == memType;
+#else
+  (void)fileType;
+  (void)memType;
+  return false;
+#endif
+}
+
+void WriteStridedRange(const ArrayTarget& target, const CGNS_ENUMT(DataType_t) fileType,
+                       const StridedComponent& src, const int64_t srcFirst, const int64_t fileFirst,
+                       const int64_t count, double* maxLoss)
+{
+  if (count <= 0)
+  {
+    return;
+  }
+
+#if CGNS_WRITER_HAVE_GENERAL_WRITE
+  if (CanWriteStrided(fileType, src.type))
+  {
+    // Memory is viewed as a stride x rows array; the component is row [component+1, ...].
+    const cgsize_t rmin = static_cast<cgsize_t>(fileFirst) + 1;
+    const cgsize_t rmax = static_cast<cgsize_t>(fileFirst + count);
+    const cgsize_t mDims[2] = { static_cast<cgsize_t>(src.stride), static_cast<cgsize_t>(src.rows) };
+    const cgsize_t mMin[2] = { src.component + 1, static_cast<cgsize_t>(srcFirst) + 1 };
+    const cgsize_t mMax[2] = { src.component + 1, static_cast<cgsize_t>(srcFirst + count) };
+    const CgnsAccess access(target.fn, target.S == 0 ? "cg_coord_general_write" : "cg_field_general_write",
+                            count * DataTypeSize(fileType));
+    int id = 0;
+    if (target.S == 0)
+    {
+      CheckCg(cg_coord_general_write(target.fn, target.B, target.Z, target.name, fileType, &rmin, &rmax, src.type,
+                                     2, mDims, mMin, mMax, src.data, &id),
+              std::string("cg_coord_general_write(") + target.name + ")");
+    }
+    else
+    {
+      CheckCg(cg_field_general_write(target.fn, target.B, target.Z, target.S, target.name, fileType, &rmin, &rmax,
+                                     src.type, 2, mDims, mMin, mMax, src.data, &id),
+              std::string("cg_field_general_write(") + target.name + ")");
+    }
+    return;
+  }
+#endif
+
+  BlockedComponentWriter writer(target, fileType, src, maxLoss);
+  writer.Append(fileFirst, nullptr, srcFirst, count);
+  writer.Flush();
+}
+
+void WriteInterleavedCoords(const int fn, const int B, const int Z, const double* points, const int64_t first,
+                            const int64_t count, const CGNS_ENUMT(DataType_t) fileType, double* maxLoss)
+{
+  const phase::Scope timer("coords");
+  static const char* names[3] = { "CoordinateX", "CoordinateY", "CoordinateZ" };
+  for (int c = 0; c < 3; ++c)
+  {
+    ArrayTarget target;
+    target.fn = fn;
+    target.B = B;
+    target.Z = Z;
+    target.name = names[c];
+
+    StridedComponent src;
+    src.data = points;
+    src.type = CGNS_ENUMV(RealDouble);
+    src.stride = 3;
+    src.component = c;
+    src.rows = count;
+    WriteStridedRange(target, fileType, src, 0, first, count, maxLoss);
+  }
+}
+
+void WritePolySection(const int fn, const int B, const int Z, const Section& s, const int64_t bytes)
+{
+  int S = 0;
+  CheckCg(output::WritePolySection(fn, B, Z, s, &S, [&] { return CgnsAccess(fn, output::kPolySectionCall, bytes); }),
+          std::string(output::kPolySectionCall) + "(" + s.name + ")");
+}
+
+void ValidateFields(const CgnsFieldInfo* fields, const int numFields, const char* what)
+{
+  if (numFields < 0 || (numFields > 0 && !fields))
+  {
+    throw std::runtime_error(std::string(what) + " is null or has a negative count");
+  }
+  for (int i = 0; i < numFields; ++i)
+  {
+    const CgnsFieldInfo& f = fields[i];
+    const std::string label = std::string(what) + "[" + std::to_string(i) + "]";
+    if (!f.data)
+    {
+      throw std::runtime_error(label + ".data is null");
+    }
+    if (f.data_type < CGNS_FIELD_FLOAT64 || f.data_type > CGNS_FIELD_INT64)
+    {
+      throw std::runtime_error(label + " has unknown data_type " + std::to_string(f.data_type));
+    }
+    if (f.num_components < 1)
+    {
+      throw std::runtime_error(label + ".num_components must be >= 1");
+    }
+    if (f.stride != 0 && f.stride < f.num_components)
+    {
+      throw std::runtime_error(label + ".stride is smaller than num_components");
+    }
+  }
+}
+
+void WriteFieldSolution(const int fn, const int B, const int Z, const char* solName,
+                        const CGNS_ENUMT(GridLocation_t) loc, const CgnsFieldInfo* fields, const int numFields,
+                        const int64_t numRows, const int64_t* rowOrder, const int precision, double* maxLoss)
+{
+  if (numFields <= 0)
+  {
+    return;
+  }
+  const phase::Scope timer("fields");
+
+  ArrayTarget target;
+  target.fn = fn;
+  target.B = B;
+  target.Z = Z;
+  {
+    const CgnsAccess access(fn, "cg_sol_write");
+    CheckCg(cg_sol_write(fn, B, Z, solName, loc, &target.S), std::string("cg_sol_write(") + solName + ")");
+  }
+
+  // Shorter runs are cheaper to gather than to issue as separate strided writes.
+  constexpr int64_t kMinDirectRun = 1024;
+  const char* defaultPrefix = loc == CGNS_ENUMV(Vertex) ? "PointArray_" : "CellArray_";
+
+  for (int i = 0; i < numFields; ++i)
+  {
+    const CgnsFieldInfo& f = fields[i];
+    const std::string baseName =
+      (f.name && f.name[0] != '\0') ? std::string(f.name) : defaultPrefix + std::to_string(i);
+
+    StridedComponent src;
+    src.data = f.data;
+    src.type = FieldMemoryType(f.data_type);
+    src.stride = f.stride != 0 ? f.stride : f.num_components;
+    src.rows = numRows;
+    const CGNS_ENUMT(DataType_t) fileType =
+      f.data_type == CGNS_FIELD_FLOAT64 ? PrecisionType(precision) : src.type;
+
+    for (int c = 0; c < f.num_components; ++c)
+    {
+      const std::string fieldName =
+        (f.num_components == 1) ? baseName : (baseName + "_" + ComponentSuffix(c));
+      target.name = fieldName.c_str();
+      src.component = c;
+
+      if (!rowOrder)
+      {
+        WriteStridedRange(target, fileType, src, 0, 0, numRows, maxLoss);
+        continue;
+      }
+
+      // Long runs of consecutive rows go straight from the caller's buffer; the
+      // rest is gathered in file order and flushed in bounded blocks.
+      const bool direct = CanWriteStrided(fileType, src.type);
+      BlockedComponentWriter gathered(target, fileType, src, maxLoss);
+      int64_t e = 0;
+      while (e < numRows)
+      {
+        int64_t run = 1;
+        while (e + run < numRows && rowOrder[e + run] == rowOrder[e] + run)
+        {
+          ++run;
+        }
+        if (direct && run >= kMinDirectRun)
+        {
+          gathered.Flush();
+          WriteStridedRange(target, fileType, src, rowOrder[e], e, run, maxLoss);
+        }
+        else
+        {
+          gathered.Append(e, rowOrder + e, 0, run);
+        }
+        e += run;
+      }
+      gathered.Flush();
+    }
+  }
+}
+
+const char* BaseName(const CgnsWriteOptions* options)
+{
+  return (options && options->base_name && options->base_name[0] != '\0') ? options->base_name : "Base";
+}
+} // namespace detail
+} // namespace cgns_writer
+
+namespace
+{
+using namespace cgns_writer::detail;
+
+// Per-block state of the section builder.
+struct CellBlock
+{
+  int64_t first = 0;
+  int64_t last = 0;
+  std::array<int64_t, 256> counts{};     // cells per VTK type
+  std::array<int64_t, 256> firstCell{};  // first cell id per VTK type (valid when counts > 0)
+  int64_t polygonNodes = 0;              // connectivity entries of the block's VTK_POLYGON cells
+};
+
+// Branch-free check of cells [first, last): every cell has the node count of a supported
+// type, the block's connectivity span lies inside the array and every id in it is in
+// [0, num_points). Since every supported type has at least one node, the node count check
+// also proves the offsets strictly increasing, so no separate monotonicity pass is needed.
+// A face stream holds counts as well as ids, so blocks with polyhedra always fail here and
+// are checked by ValidateCellByCell.
+template <typename IdT>
+bool CellsAreValid(const UnstructuredMeshInfo& mesh, const int64_t first, const int64_t last)
+{
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto& nodesOfType = NodesPerElemTable();
+
+  const int64_t c0 = static_cast<int64_t>(offsets[first]);
+  const int64_t c1 = static_cast<int64_t>(offsets[last]);
+  if (c0 < 0 || c1 < c0 || c1 > mesh.connectivity_size)
+  {
+    return false;
+  }
+
+  int bad = 0;
+  for (int64_t cellId = first; cellId < last; ++cellId)
+  {
+    const int64_t size = static_cast<int64_t>(offsets[cellId + 1]) - static_cast<int64_t>(offsets[cellId]);
+    const int64_t expected = nodesOfType[mesh.types[cellId]];
+    bad |= static_cast<int>((expected > 0) & (size != expected)) |
+           static_cast<int>((expected < 0) & (size < -expected)) | static_cast<int>(expected == 0);
+  }
+  if (bad)
+  {
+    return false;
+  }
+
+  int64_t lo = 0;
+  int64_t hi = 0;
+  IdRange(static_cast<const IdT*>(mesh.connectivity) + c0, static_cast<size_t>(c1 - c0), lo, hi);
+  return lo >= 0 && hi < mesh.num_points;
+}
+
+// Checks that the face stream of polyhedron cellId fills conn[start, end) exactly, with at
+// least four faces of at least three nodes each, and that its node ids are in range.
+template <typename IdT>
+void ValidateFaceStream(const UnstructuredMeshInfo& mesh, const int64_t cellId, const int64_t start, const int64_t end)
+{
+  const auto* conn = static_cast<const IdT*>(mesh.connectivity);
+  const std::string cell = "Polyhedron " + std::to_string(cellId);
+  const int64_t numFaces = start < end ? static_cast<int64_t>(conn[start]) : 0;
+  if (numFaces < 4)
+  {
+    throw std::runtime_error(cell + " has " + std::to_string(numFaces) + " faces, expected at least 4");
+  }
+  int64_t at = start + 1;
+  for (int64_t f = 0; f < numFaces; ++f)
+  {
+    const int64_t n = at < end ? static_cast<int64_t>(conn[at]) : 0;
+    if (n < 3 || n > end - at - 1)
+    {
+      throw std::runtime_error(cell + ": face " + std::to_string(f) + " has " + std::to_string(n) +
+                               " nodes or overruns the cell's connectivity");
+    }
+    for (int64_t i = at + 1; i <= at + n; ++i)
+    {
+      const int64_t id = static_cast<int64_t>(conn[i]);
+      if (id < 0 || id >= mesh.num_points)
+      {
+        throw std::runtime_error("Connectivity id out of range at index " + std::to_string(i));
+      }
+    }
+    at += 1 + n;
+  }
+  if (at != end)
+  {
+    throw std::runtime_error(cell + " has " + std::to_string(end - at) + " entries after its last face");
+  }
+}
+
+// Slow path once CellsAreValid has failed: throws for the first bad cell of the block and
+// returns when there is none, which happens for blocks with polyhedra.
+template <typename IdT>
+void ValidateCellByCell(const UnstructuredMeshInfo& mesh, const int64_t first, const int64_t last)
+{
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto* conn = static_cast<const IdT*>(mesh.connectivity);
+  const auto& table = CellTypeTable();
+  for (int64_t cellId = first; cellId < last; ++cellId)
+  {
+    const int64_t start = static_cast<int64_t>(offsets[cellId]);
+    const int64_t end = static_cast<int64_t>(offsets[cellId + 1]);
+    if (start < 0 || end < start || end > mesh.connectivity_size)
+    {
+      throw std::runtime_error("Invalid offsets/connectivity_size for cell " + std::to_string(cellId));
+    }
+
+    const unsigned char vtkType = mesh.types[cellId];
+    const CellTypeInfo& info = table[vtkType];
+    if (!info.supported)
+    {
+      throw std::runtime_error("Unsupported VTK cell type " + std::to_string(vtkType));
+    }
+
+    if (vtkType == VTK_POLYHEDRON)
+    {
+      ValidateFaceStream<IdT>(mesh, cellId, start, end);
+      continue;
+    }
+
+    const int64_t cellSize = end - start;
+    if (vtkType == VTK_POLYGON ? cellSize < 3 : cellSize != info.nodesPerElem)
+    {
+      throw std::runtime_error("Cell " + std::to_string(cellId) + " has " + std::to_string(cellSize) +
+                               " nodes, expected " +
+                               (vtkType == VTK_POLYGON ? "at least 3" : std::to_string(info.nodesPerElem)));
+    }
+
+    for (int64_t i = start; i < end; ++i)
+    {
+      const int64_t id = static_cast<int64_t>(conn[i]);
+      if (id < 0 || id >= mesh.num_points)
+      {
+        throw std::runtime_error("Connectivity id out of range at index " + std::to_string(i));
+      }
+    }
+  }
+}
+
+// CGNS_VALIDATE_FULL only: rejects degenerate cells that list a node more than once.
+// Polyhedra are skipped: their face streams repeat every node by design.
+template <typename IdT>
+void ThrowOnRepeatedNodes(const UnstructuredMeshInfo& mesh, const int64_t first, const int64_t last)
+{
+  // Cells up to the largest fixed-size type (HEXA_27) compare every pair of nodes; larger
+  // polygons sort a copy of their ids instead, so the check stays O(n log n) per cell.
+  constexpr int64_t kMaxPairwiseNodes = 27;
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto* conn = static_cast<const IdT*>(mesh.connectivity);
+  std::vector<IdT> sorted;
+  for (int64_t cellId = first; cellId < last; ++cellId)
+  {
+    if (mesh.types[cellId] == VTK_POLYHEDRON)
+    {
+      continue;
+    }
+    const IdT* ids = conn + offsets[cellId];
+    const int64_t n = static_cast<int64_t>(offsets[cellId + 1] - offsets[cellId]);
+    const IdT* repeated = nullptr;
+    if (n <= kMaxPairwiseNodes)
+    {
+      for (int64_t a = 1; a < n && !repeated; ++a)
+      {
+        for (int64_t c = 0; c < a; ++c)
+        {
+          if (ids[a] == ids[c])
+          {
+            repeated = ids + a;
+            break;
+          }
+        }
+      }
+    }
+    else
+    {
+      sorted.assign(ids, ids + n);
+      std::sort(sorted.begin(), sorted.end());
+      const auto it = std::adjacent_find(sorted.begin(), sorted.end());
+      if (it != sorted.end())
+      {
+        repeated = &*it;
+      }
+    }
+    if (repeated)
+    {
+      throw std::runtime_error("Cell " + std::to_string(cellId) + " repeats node " +
+                               std::to_string(static_cast<int64_t>(*repeated)));
+    }
+  }
+}
+
+// Splits the cells into contiguous blocks (one per thread, at least kMinCellsPerBlock
+// cells each), validates every block to the given level and counts its cells per VTK type.
+template <typename IdT>
+std::vector<CellBlock> CountCellTypes(const UnstructuredMeshInfo& mesh, const int numThreads, const int validate)
+{
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto& table = CellTypeTable();
+
+  // Below this many cells per block, thread start-up costs more than it saves.
+  constexpr int64_t kMinCellsPerBlock = 1 << 16;
+  const int64_t maxBlocks = std::max<int64_t>(1, mesh.num_cells / kMinCellsPerBlock);
+  const size_t numBlocks = static_cast<size_t>(std::min<int64_t>(numThreads, maxBlocks));
+
+  std::vector<CellBlock> blocks(numBlocks);
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    blocks[b].first = mesh.num_cells * static_cast<int64_t>(b) / static_cast<int64_t>(numBlocks);
+    blocks[b].last = mesh.num_cells * static_cast<int64_t>(b + 1) / static_cast<int64_t>(numBlocks);
+  }
+
+  const cgns_writer::phase::Scope timer("validate");
+  if (validate == CGNS_VALIDATE_FULL)
+  {
+    if (offsets[0] != 0 || static_cast<int64_t>(offsets[mesh.num_cells]) != mesh.connectivity_size)
+    {
+      throw std::runtime_error("offsets must start at 0 and end at connectivity_size");
+    }
+  }
+
+  ParallelBlocks(numBlocks, [&](const size_t b) {
+    CellBlock& blk = blocks[b];
+    if (validate != CGNS_VALIDATE_NONE && !CellsAreValid<IdT>(mesh, blk.first, blk.last))
+    {
+      ValidateCellByCell<IdT>(mesh, blk.first, blk.last);
+    }
+    if (validate == CGNS_VALIDATE_FULL)
+    {
+      ThrowOnRepeatedNodes<IdT>(mesh, blk.first, blk.last);
+    }
+
+    for (int64_t cellId = blk.first; cellId < blk.last; ++cellId)
+    {
+      const unsigned char vtkType = mesh.types[cellId];
+      if (blk.counts[vtkType]++ == 0)
+      {
+        blk.firstCell[vtkType] = cellId;
+      }
+    }
+
+    // Sections can only be sized for supported types, so this holds even without validation.
+    for (size_t v = 0; v < blk.counts.size(); ++v)
+    {
+      if (blk.counts[v] > 0 && !table[v].supported)
+      {
+        throw std::runtime_error("Unsupported VTK cell type " + std::to_string(v));
+      }
+    }
+
+    // Polygon sections are sized from their node counts rather than their cell counts.
+    for (int64_t cellId = blk.first; blk.counts[VTK_POLYGON] > 0 && cellId < blk.last; ++cellId)
+    {
+      if (mesh.types[cellId] == VTK_POLYGON)
+      {
+        blk.polygonNodes += static_cast<int64_t>(offsets[cellId + 1]) - static_cast<int64_t>(offsets[cellId]);
+      }
+    }
+  });
+  return blocks;
+}
+
+// Groups the cells of counted blocks into one section per element type with a
+// counting sort: the block histograms size every section exactly, then a scatter
+// pass places each cell's shifted connectivity at its final position.
+// The blocks run concurrently; their histograms are prefix-summed so the output
+// is identical to the serial order.
+// Element ranges are assigned consecutively from 1. When elemToCell is non-null it
+// receives, for every written element (0-based), the input cell it came from.
+// Polygons go to an NGON_n section, whose offsets are filled in the same pass.
+template <typename IdT>
+void BuildSections(const UnstructuredMeshInfo& mesh, const std::vector<CellBlock>& blocks,
+                   std::vector<Section>& sections, int& cellDim, std::vector<int64_t>* elemToCell)
+{
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto* conn = static_cast<const IdT*>(mesh.connectivity);
+  const auto& table = CellTypeTable();
+  const size_t numBlocks = blocks.size();
+
+  const cgns_writer::phase::Scope sectionTimer("section");
+
+  // VTK types in order of first appearance across all blocks.
+  std::vector<std::pair<int64_t, unsigned char>> typeOrder;
+  for (int v = 0; v < 256; ++v)
+  {
+    for (const CellBlock& blk : blocks)
+    {
+      if (blk.counts[static_cast<size_t>(v)] > 0)
+      {
+        typeOrder.emplace_back(blk.firstCell[static_cast<size_t>(v)], static_cast<unsigned char>(v));
+        break;
+      }
+    }
+  }
+  std::sort(typeOrder.begin(), typeOrder.end());
+
+  // Create sections in order of first appearance and size them exactly.
+  std::array<size_t, 256> sectionOfType{};
+  for (const auto& entry : typeOrder)
+  {
+    const unsigned char vtkType = entry.second;
+    const CellTypeInfo& info = table[vtkType];
+    cellDim = std::max(cellDim, info.dim);
+
+    auto it = std::find_if(sections.begin(), sections.end(),
+                           [&](const Section& s) { return s.type == info.type; });
+    if (it == sections.end())
+    {
+      Section s;
+      s.type = info.type;
+      s.nodesPerElem = info.nodesPerElem;
+      s.name = DefaultSectionName(info.type);
+      sections.push_back(std::move(s));
+      it = sections.end() - 1;
+    }
+    for (const CellBlock& blk : blocks)
+    {
+      it->numElems += static_cast<cgsize_t>(blk.counts[vtkType]);
+    }
+    sectionOfType[vtkType] = static_cast<size_t>(it - sections.begin());
+  }
+
+  // Connectivity entries of a section's cells in block b.
+  auto sectionNodes = [&](const size_t b, const unsigned char vtkType) {
+    return vtkType == VTK_POLYGON
+             ? static_cast<size_t>(blocks[b].polygonNodes)
+             : static_cast<size_t>(blocks[b].counts[vtkType]) * static_cast<size_t>(table[vtkType].nodesPerElem);
+  };
+
+  std::vector<size_t> sectionSize(sections.size(), 0);
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    for (const auto& entry : typeOrder)
+    {
+      sectionSize[sectionOfType[entry.second]] += sectionNodes(b, entry.second);
+    }
+  }
+  cgsize_t elem = 1;
+  for (size_t si = 0; si < sections.size(); ++si)
+  {
+    Section& s = sections[si];
+    s.conn.resize(sectionSize[si]);
+    if (s.nodesPerElem == 0)
+    {
+      s.offsets.resize(static_cast<size_t>(s.numElems) + 1);
+      s.offsets.back() = static_cast<cgsize_t>(s.conn.size());
+    }
+    s.start = elem;
+    s.end = elem + s.numElems - 1;
+    elem = s.end + 1;
+  }
+  if (elemToCell)
+  {
+    elemToCell->resize(static_cast<size_t>(elem - 1));
+  }
+
+  // Exclusive prefix sums over blocks: the first element and connectivity entry each block
+  // writes in each section.
+  std::vector<std::vector<size_t>> firstElem(numBlocks, std::vector<size_t>(sections.size()));
+  std::vector<std::vector<size_t>> firstNode(numBlocks, std::vector<size_t>(sections.size()));
+  std::vector<size_t> usedElems(sections.size(), 0);
+  std::vector<size_t> usedNodes(sections.size(), 0);
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    firstElem[b] = usedElems;
+    firstNode[b] = usedNodes;
+    for (const auto& entry : typeOrder)
+    {
+      const size_t si = sectionOfType[entry.second];
+      usedElems[si] += static_cast<size_t>(blocks[b].counts[entry.second]);
+      usedNodes[si] += sectionNodes(b, entry.second);
+    }
+  }
+
+  // Pass 2: scatter shifted (1-based) connectivity into the section buffers.
+  ParallelBlocks(numBlocks, [&](const size_t b) {
+    const CellBlock& blk = blocks[b];
+    std::vector<size_t>& elemAt = firstElem[b];
+    std::vector<size_t>& nodeAt = firstNode[b];
+    for (int64_t cellId = blk.first; cellId < blk.last; ++cellId)
+    {
+      const int64_t start = static_cast<int64_t>(offsets[cellId]);
+      const int64_t end = static_cast<int64_t>(offsets[cellId + 1]);
+      const size_t si = sectionOfType[mesh.types[cellId]];
+      Section& s = sections[si];
+      const size_t e = elemAt[si]++;
+      if (elemToCell)
+      {
+        (*elemToCell)[static_cast<size_t>(s.start - 1) + e] = cellId;
+      }
+      if (!s.offsets.empty())
+      {
+        s.offsets[e] = static_cast<cgsize_t>(nodeAt[si]);
+      }
+      cgns_writer::node_order::CopyElements(mesh.types[cellId], conn + start, 1, end - start, 1,
+                                            s.conn.data() + nodeAt[si]);
+      nodeAt[si] += static_cast<size_t>(end - start);
+    }
+  });
+}
+
+// Writes the counted cells as one MIXED section in input order: element e is cell e,
+// stored as its CGNS element type followed by its 1-based node ids, and offsets[e] is
+// where it starts in conn. Cell c starts at c + offsets[c] - offsets[0], so every block
+// scatters independently and no element-to-cell map is needed.
+template <typename IdT>
+void BuildMixedSection(const UnstructuredMeshInfo& mesh, const std::vector<CellBlock>& blocks,
+                       std::vector<Section>& sections, int& cellDim)
+{
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto* conn = static_cast<const IdT*>(mesh.connectivity);
+  const auto& table = CellTypeTable();
+
+  const cgns_writer::phase::Scope sectionTimer("section");
+  for (size_t v = 0; v < table.size(); ++v)
+  {
+    for (const CellBlock& blk : blocks)
+    {
+      if (blk.counts[v] > 0)
+      {
+        cellDim = std::max(cellDim, table[v].dim);
+        break;
+      }
+    }
+  }
+  for (const CellBlock& blk : blocks)
+  {
+    if (blk.counts[VTK_POLYGON] > 0)
+    {
+      throw std::runtime_error("Cell " + std::to_string(blk.firstCell[VTK_POLYGON]) +
+                               " is a VTK_POLYGON, which a MIXED section cannot hold; use CGNS_SECTIONS_BY_TYPE");
+    }
+  }
+
+  const int64_t base = static_cast<int64_t>(offsets[0]);
+  Section s;
+  s.type = CGNS_ENUMV(MIXED);
+  s.name = DefaultSectionName(s.type);
+  s.numElems = static_cast<cgsize_t>(mesh.num_cells);
+  s.start = 1;
+  s.end = s.numElems;
+  s.conn.resize(static_cast<size_t>(mesh.num_cells + static_cast<int64_t>(offsets[mesh.num_cells]) - base));
+  s.offsets.resize(static_cast<size_t>(mesh.num_cells) + 1);
+  s.offsets.back() = static_cast<cgsize_t>(s.conn.size());
+
+  ParallelBlocks(blocks.size(), [&](const size_t b) {
+    const CellBlock& blk = blocks[b];
+    for (int64_t cellId = blk.first; cellId < blk.last; ++cellId)
+    {
+      const int64_t start = static_cast<int64_t>(offsets[cellId]);
+      const int64_t end = static_cast<int64_t>(offsets[cellId + 1]);
+      const int64_t at = cellId + start - base;
+      s.offsets[static_cast<size_t>(cellId)] = static_cast<cgsize_t>(at);
+      cgsize_t* dst = s.conn.data() + at;
+      *dst++ = static_cast<cgsize_t>(table[mesh.types[cellId]].type);
+      cgns_writer::node_order::CopyElements(mesh.types[cellId], conn + start, 1, end - start, 1, dst);
+    }
+  });
+  sections.push_back(std::move(s));
+}
+
+// True when the counted cells include polyhedra, which makes the zone polyhedral.
+bool HasPolyhedra(const std::vector<CellBlock>& blocks)
+{
+  return std::any_of(blocks.begin(), blocks.end(),
+                     [](const CellBlock& blk) { return blk.counts[VTK_POLYHEDRON] > 0; });
+}
+
+// Writes a polyhedral zone as an NGON_n section "Faces" holding every distinct face once
+// (elements 1..numFaces) and an NFACE_n section "Polyhedra" holding the cells in input order
+// by their signed face numbers. Linear 3D cells are converted to their faces as well; lower
+// dimensional and quadratic cells cannot be part of an NFACE_n zone. Returns the number of faces.
+template <typename IdT>
+cgsize_t BuildPolyhedralSections(const UnstructuredMeshInfo& mesh, const std::vector<CellBlock>& blocks,
+                                 std::vector<Section>& sections)
+{
+  for (size_t v = 0; v < 256; ++v)
+  {
+    const unsigned char vtkType = static_cast<unsigned char>(v);
+    for (const CellBlock& blk : blocks)
+    {
+      if (blk.counts[v] > 0 && vtkType != VTK_POLYHEDRON && !cgns_writer::polyhedra::FacesOfLinearCell(vtkType))
+      {
+        throw std::runtime_error("Cell " + std::to_string(blk.firstCell[v]) + " of VTK type " + std::to_string(v) +
+                                 " is not a linear 3D cell and cannot be written with VTK_POLYHEDRON cells (NFACE_n)");
+      }
+    }
+  }
+
+  const cgns_writer::phase::Scope sectionTimer("section");
+  cgns_writer::polyhedra::Sections poly;
+  cgns_writer::polyhedra::Build<IdT>(static_cast<const IdT*>(mesh.offsets), static_cast<const IdT*>(mesh.connectivity),
+                                     mesh.types, mesh.num_cells, blocks.size(), ParallelBlocks, poly);
+
+  Section faces;
+  faces.type = CGNS_ENUMV(NGON_n);
+  faces.name = "Faces";
+  faces.numElems = static_cast<cgsize_t>(poly.NumFaces());
+  faces.start = 1;
+  faces.end = faces.numElems;
+  faces.conn = std::move(poly.faceConn);
+  faces.offsets = std::move(poly.faceOffsets);
+
+  Section cells;
+  cells.type = CGNS_ENUMV(NFACE_n);
+  cells.name = DefaultSectionName(cells.type);
+  cells.numElems = static_cast<cgsize_t>(poly.NumCells());
+  cells.start = faces.end + 1;
+  cells.end = faces.end + cells.numElems;
+  cells.conn = std::move(poly.cellConn);
+  cells.offsets = std::move(poly.cellOffsets);
+
+  sections.push_back(std::move(faces));
+  sections.push_back(std::move(cells));
+  return sections.front().numElems;
+}
+
+// Sections of a counted mesh in the layout of the options; returns the number of NGON_n faces.
+template <typename IdT>
+cgsize_t BuildZoneSections(const UnstructuredMeshInfo& mesh, const std::vector<CellBlock>& blocks, const bool mixed,
+                           PreparedZone& zone, std::vector<int64_t>* elemToCell)
+{
+  if (HasPolyhedra(blocks))
+  {
+    zone.cellDim = 3;
+    return BuildPolyhedralSections<IdT>(mesh, blocks, zone.sections);
+  }
+  if (mixed)
+  {
+    BuildMixedSection<IdT>(mesh, blocks, zone.sections, zone.cellDim);
+  }
+  else
+  {
+    BuildSections<IdT>(mesh, blocks, zone.sections, zone.cellDim, elemToCell);
+  }
+  return 0;
+}
+
+// Topology of a validated mesh with its cells in a new order and its point ids renumbered.
+template <typename IdT>
+struct RenumberedCells
+{
+  std::vector<IdT> offsets;
+  std::vector<IdT> conn;
+  std::vector<unsigned char> types;
+  std::vector<int64_t> cellOrder; // new cell -> input cell
+};
+
+// Computes the options->reorder numbering of a validated mesh in numBlocks parallel blocks,
+// then copies its topology in that order and its coordinates into zone.points.
+template <typename IdT>
+RenumberedCells<IdT> Renumber(const UnstructuredMeshInfo& mesh, const int method, const size_t numBlocks,
+                              PreparedZone& zone)
+{
+  namespace reorder = cgns_writer::reorder;
+  const cgns_writer::phase::Scope timer("reorder");
+  const auto* offsets = static_cast<const IdT*>(mesh.offsets);
+  const auto* conn = static_cast<const IdT*>(mesh.connectivity);
+  const reorder::Cells<IdT> cells{ offsets, conn, mesh.types, mesh.num_cells };
+  reorder::Orders orders;
+  if (method == CGNS_REORDER_HILBERT)
+  {
+    const double* const xyz[3] = { mesh.points, mesh.points + 1, mesh.points + 2 };
+    orders = reorder::Hilbert<IdT>(xyz, 3, mesh.num_points, cells, numBlocks, ParallelBlocks);
+  }
+  else
+  {
+    orders = reorder::ReverseCuthillMcKee<IdT>(mesh.num_points, cells, numBlocks, ParallelBlocks);
+  }
+  const std::vector<int64_t> rank = reorder::Inverse(orders.points, numBlocks, ParallelBlocks);
+  const auto blockBegin = [&](const int64_t n, const size_t b) {
+    return n * static_cast<int64_t>(b) / static_cast<int64_t>(numBlocks);
+  };
+
+  RenumberedCells<IdT> out;
+  out.cellOrder = std::move(orders.cells);
+  out.offsets.assign(static_cast<size_t>(mesh.num_cells) + 1, 0);
+  out.types.resize(static_cast<size_t>(mesh.num_cells));
+  ParallelBlocks(numBlocks, [&](const size_t b) {
+    for (int64_t i = blockBegin(mesh.num_cells, b); i < blockBegin(mesh.num_cells, b + 1); ++i)
+    {
+      const int64_t c = out.cellOrder[static_cast<size_t>(i)];
+      out.offsets[static_cast<size_t>(i) + 1] = offsets[c + 1] - offsets[c];
+      out.types[static_cast<size_t>(i)] = mesh.types[c];
+    }
+  });
+  for (size_t i = 0; i < static_cast<size_t>(mesh.num_cells); ++i)
+  {
+    out.offsets[i + 1] += out.offsets[i];
+  }
+
+  // A face stream keeps its counts; everything else in the connectivity is a point id.
+  out.conn.resize(static_cast<size_t>(out.offsets.back()));
+  ParallelBlocks(numBlocks, [&](const size_t b) {
+    for (int64_t i = blockBegin(mesh.num_cells, b); i < blockBegin(mesh.num_cells, b + 1); ++i)
+    {
+      const int64_t c = out.cellOrder[static_cast<size_t>(i)];
+      const IdT* src = conn + offsets[c];
+      const IdT* const end = conn + offsets[c + 1];
+      IdT* dst = out.conn.data() + out.offsets[static_cast<size_t>(i)];
+      if (mesh.types[c] == VTK_POLYHEDRON)
+      {
+        *dst++ = *src++;
+        while (src < end)
+        {
+          const IdT n = *src++;
+          *dst++ = n;
+          for (IdT k = 0; k < n; ++k)
+          {
+            *dst++ = static_cast<IdT>(rank[static_cast<size_t>(*src++)]);
+          }
+        }
+        continue;
+      }
+      for (; src < end; ++src)
+      {
+        *dst++ = static_cast<IdT>(rank[static_cast<size_t>(*src)]);
+      }
+    }
+  });
+
+  zone.points.resize(3 * static_cast<size_t>(mesh.num_points));
+  ParallelBlocks(numBlocks, [&](const size_t b) {
+    for (int64_t i = blockBegin(mesh.num_points, b); i < blockBegin(mesh.num_points, b + 1); ++i)
+    {
+      const double* p = mesh.points + 3 * orders.points[static_cast<size_t>(i)];
+      std::copy(p, p + 3, zone.points.data() + 3 * i);
+    }
+  });
+  zone.pointOrder = std::move(orders.points);
+  return out;
+}
+
+// Validates, optionally renumbers and sections a mesh with IdT connectivity; returns the number of NGON_n faces.
+template <typename IdT>
+cgsize_t PrepareSections(const UnstructuredMeshInfo& mesh, const CgnsWriteOptions* options, const bool needElemToCell,
+                         PreparedZone& zone)
+{
+  const int numThreads = ResolveThreadCount(options);
+  const bool mixed = SectionLayout(options) == CGNS_SECTIONS_MIXED;
+  const int method = ReorderMethod(options);
+  std::vector<int64_t>* elemToCell = (needElemToCell || mesh.num_cell_fields > 0) ? &zone.elemToCell : nullptr;
+  const std::vector<CellBlock> blocks = CountCellTypes<IdT>(mesh, numThreads, ValidateLevel(options));
+  if (method == CGNS_REORDER_NONE)
+  {
+    return BuildZoneSections<IdT>(mesh, blocks, mixed, zone, elemToCell);
+  }
+
+  // The renumbered copy is valid by construction and is sectioned like any other mesh.
+  const RenumberedCells<IdT> renumbered = Renumber<IdT>(mesh, method, blocks.size(), zone);
+  UnstructuredMeshInfo view = mesh;
+  view.points = zone.points.data();
+  view.connectivity = const_cast<IdT*>(renumbered.conn.data());
+  view.offsets = const_cast<IdT*>(renumbered.offsets.data());
+  view.types = const_cast<unsigned char*>(renumbered.types.data());
+  view.connectivity_size = static_cast<int64_t>(renumbered.conn.size());
+  const cgsize_t numFaces = BuildZoneSections<IdT>(
+    view, CountCellTypes<IdT>(view, numThreads, CGNS_VALIDATE_NONE), mixed, zone, elemToCell);
+
+  // Elements follow the new cells; map them back to the input cells the fields are read from.
+  if (elemToCell && elemToCell->empty())
+  {
+    *elemToCell = renumbered.cellOrder;
+  }
+  else if (elemToCell)
+  {
+    for (int64_t& cell : *elemToCell)
+    {
+      cell = renumbered.cellOrder[static_cast<size_t>(cell)];
+    }
+  }
+  return numFaces;
+}
+
+// Moves the connectivity of every section whose values fit in 32 bits to its int32_t arrays,
+// converting each in blocks of at least kMinValuesPerBlock values on up to numThreads threads.
+void NarrowSections(std::vector<Section>& sections, const int numThreads)
+{
+  if (!cgns_writer::connectivity::kCanNarrow)
+  {
+    return;
+  }
+  // Below this many values per block, thread start-up costs more than the conversion saves.
+  constexpr int64_t kMinValuesPerBlock = 1 << 18;
+  const cgns_writer::phase::Scope timer("section");
+  for (Section& s : sections)
+  {
+    const int64_t maxBlocks = std::max<int64_t>(1, static_cast<int64_t>(s.conn.size()) / kMinValuesPerBlock);
+    cgns_writer::connectivity::Narrow(s, static_cast<size_t>(std::min<int64_t>(numThreads, maxBlocks)),
+                                      ParallelBlocks);
+  }
+}
+} // namespace
+
+namespace cgns_writer
+{
+namespace detail
+{
+void CheckStructSizes(const UnstructuredMeshInfo* mesh, const CgnsWriteOptions* options)
+{
+  auto check = [](const size_t size, const size_t expected, const char* type, const char* init) {
+    if (size != expected)
+    {
+      throw std::runtime_error(std::string(type) + ".struct_size is " + std::to_string(size) + ", expected " +
+                               std::to_string(expected) + ": initialize it with " + init +
+                               ", and build against the CgnsWriterExport.h of this library version (" +
+                               cgns_writer_version() + ")");
+    }
+  };
+  if (mesh)
+  {
+    check(mesh->struct_size, sizeof(UnstructuredMeshInfo), "UnstructuredMeshInfo", "cgns_mesh_info_init");
+  }
+  if (options)
+  {
+    check(options->struct_size, sizeof(CgnsWriteOptions), "CgnsWriteOptions", "cgns_write_options_init");
+  }
+}
+
+void ValidateMesh(const UnstructuredMeshInfo& mesh)
+{
+  if (!mesh.points || mesh.num_points <= 0)
+  {
+    throw std::runtime_error("mesh.points is null or num_points <= 0");
+  }
+  if (!mesh.connectivity || mesh.connectivity_size <= 0)
+  {
+    throw std::runtime_error("mesh.connectivity is null or connectivity_size <= 0");
+  }
+  if (!mesh.offsets || mesh.num_cells <= 0)
+  {
+    throw std::runtime_error("mesh.offsets is null or num_cells <= 0");
+  }
+  if (!mesh.types)
+  {
+    throw std::runtime_error("mesh.types is null");
+  }
+  ValidateFields(mesh.point_fields, mesh.num_point_fields, "mesh.point_fields");
+  ValidateFields(mesh.cell_fields, mesh.num_cell_fields, "mesh.cell_fields");
+}
+
+PreparedZone PrepareZone(const UnstructuredMeshInfo& mesh, const CgnsWriteOptions* options, const bool needElemToCell)
+{
+  ValidateMesh(mesh);
+  PreparedZone zone;
+  const cgsize_t numFaces = mesh.use_64bit_ids ? PrepareSections<int64_t>(mesh, options, needElemToCell, zone)
+                                               : PrepareSections<int32_t>(mesh, options, needElemToCell, zone);
+  zone.numCells = (zone.sections.empty() ? 0 : zone.sections.back().end) - numFaces;
+  NarrowSections(zone.sections, ResolveThreadCount(options));
+  return zone;
+}
+
+int WritePreparedZone(const int fn, const int B, const char* zoneName, const UnstructuredMeshInfo& mesh,
+                      const PreparedZone& zone, const CgnsWriteOptions* options, double* maxLoss)
+{
+  const cgsize_t nCellsWritten = zone.numCells;
+
+  cgsize_t size[3] = { 0 };
+  size[0] = static_cast<cgsize_t>(mesh.num_points);
+  size[1] = nCellsWritten;
+  size[2] = 0;
+
+  int Z = 0;
+  {
+    const CgnsAccess access(fn, "cg_zone_write");
+    CheckCg(cg_zone_write(fn, B, zoneName, size, CGNS_ENUMV(Unstructured), &Z), "cg_zone_write(Unstructured)");
+  }
+
+  WriteInterleavedCoords(fn, B, Z, zone.points.empty() ? mesh.points : zone.points.data(), 0, mesh.num_points,
+                         PrecisionType(options ? options->coord_precision : CGNS_PRECISION_DOUBLE), maxLoss);
+
+  for (const auto& s : zone.sections)
+  {
+    if (s.conn.empty() && s.conn32.empty())
+    {
+      continue;
+    }
+    const int64_t bytes = connectivity::Bytes(s);
+    const phase::SectionScope stats(zoneName, s.name, static_cast<int>(s.type), static_cast<int64_t>(s.numElems),
+                                    bytes, connectivity::BytesSaved(s));
+    if (!s.conn32.empty())
+    {
+      const CgnsAccess access(fn, "cg_section_general_write", bytes);
+      int S = 0;
+      CheckCg(connectivity::WriteNarrowed(fn, B, Z, s, &S), "cg_section_general_write(" + s.name + ")");
+      continue;
+    }
+    if (!s.offsets.empty())
+    {
+      WritePolySection(fn, B, Z, s, bytes);
+      continue;
+    }
+    const CgnsAccess access(fn, "cg_section_write", bytes);
+    int S = 0;
+    CheckCg(cg_section_write(fn, B, Z, s.name.c_str(), s.type, s.start, s.end, 0, s.conn.data(), &S),
+            "cg_section_write(" + s.name + ")");
+  }
+
+  WriteFieldSolution(fn, B, Z, "PointData", CGNS_ENUMV(Vertex), mesh.point_fields, mesh.num_point_fields,
+                     mesh.num_points, zone.pointOrder.empty() ? nullptr : zone.pointOrder.data(),
+                     options ? options->point_data_precision : CGNS_PRECISION_DOUBLE, maxLoss);
+  WriteFieldSolution(fn, B, Z, "CellData", CGNS_ENUMV(CellCenter), mesh.cell_fields, mesh.num_cell_fields,
+                     static_cast<int64_t>(nCellsWritten), zone.elemToCell.empty() ? nullptr : zone.elemToCell.data(),
+                     options ? options->cell_data_precision : CGNS_PRECISION_DOUBLE, maxLoss);
+  phase::AddZone(mesh.num_points, static_cast<int64_t>(nCellsWritten));
+  return Z;
+}
+} // namespace detail
+} // namespace cgns_writer
+
+namespace
+{
+// Highest cell dimension in mesh.types; unsupported types are left for PrepareZone to report.
+int ScanCellDim(const UnstructuredMeshInfo& mesh)
+{
+  if (!mesh.types || mesh.num_cells <= 0)
+  {
+    return 0;
+  }
+  std::array<bool, 256> seen{};
+  for (int64_t cellId = 0; cellId < mesh.num_cells; ++cellId)
+  {
+    seen[mesh.types[cellId]] = true;
+  }
+  const auto& table = CellTypeTable();
+  int cellDim = 0;
+  for (size_t v = 0; v < seen.size(); ++v)
+  {
+    if (seen[v] && table[v].supported)
+    {
+      cellDim = std::max(cellDim, table[v].dim);
+    }
+  }
+  return cellDim;
+}
+
+// Records the phases of one write call on the calling thread and publishes them
+// as the thread's last stats when it goes out of scope, whether the call failed or not.
+class StatsRecorder
+{
+public:
+  StatsRecorder()
+    : Start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~StatsRecorder()
+  {
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    LastStats& last = g_last_stats;
+    last.valid = false;
+    try
+    {
+      last.record = Recording.Finish();
+      last.phases.clear();
+      last.sections.clear();
+      CgnsWriteStats& v = last.view;
+      v = CgnsWriteStats{};
+      v.wall_seconds = wall;
+      for (const auto& t : last.record.timings)
+      {
+        last.phases.push_back(CgnsPhaseStats{ t.name, t.seconds, t.calls, t.bytes });
+        v.bytes_written += t.bytes;
+      }
+      for (const auto& sec : last.record.sections)
+      {
+        last.sections.push_back(CgnsSectionStats{ sec.zone.c_str(), sec.name.c_str(), sec.type, sec.elements,
+                                                  sec.bytes, sec.seconds, sec.bytesSaved });
+        v.connectivity_bytes_saved += sec.bytesSaved;
+      }
+      v.num_zones = last.record.zones;
+      v.num_points = last.record.points;
+      v.num_elements = last.record.elements;
+      v.phases = last.phases.data();
+      v.num_phases = static_cast<int>(last.phases.size());
+      v.sections = last.sections.data();
+      v.num_sections = static_cast<int>(last.sections.size());
+      last.valid = true;
+    }
+    catch (...)
+    {
+      // Out of memory while copying: report no stats rather than throwing from a destructor.
+    }
+  }
+
+  StatsRecorder(const StatsRecorder&) = delete;
+  StatsRecorder& operator=(const StatsRecorder&) = delete;
+
+private:
+  std::chrono::steady_clock::time_point Start;
+  cgns_writer::phase::Capture Recording;
+};
+
+double* ResetPrecisionLoss(const CgnsWriteOptions* options)
+{
+  double* maxLoss = options ? options->max_precision_loss : nullptr;
+  if (maxLoss)
+  {
+    *maxLoss = 0.0;
+  }
+  return maxLoss;
+}
+} // namespace
+
+int cgns_writer::WriteUnstructured(const UnstructuredMeshInfo& mesh,
+                                   const char* output_path,
+                                   const CgnsWriteOptions* options)
+{
+  CGNS_TRACE_SCOPE("WriteUnstructured");
+  const StatsRecorder stats;
+  try
+  {
+    if (!output_path || output_path[0] == '\0')
+    {
+      throw std::runtime_error("output_path is null or empty");
+    }
+    CheckStructSizes(&mesh, options);
+    ValidateMesh(mesh);
+
+    const char* baseName = BaseName(options);
+    const char* zoneName =
+      (options && options->zone_name && options->zone_name[0] != '\0') ? options->zone_name : "Zone0";
+
+    const int fn = OpenForWrite(output_path, options);
+
+    try
+    {
+      const PreparedZone zone = PrepareZone(mesh, options, false);
+
+      const int physDim = 3;
+      const int cellDim = zone.cellDim > 0 ? zone.cellDim : 3;
+
+      int B = 0;
+      {
+        const CgnsAccess access(fn, "cg_base_write");
+        CheckCg(cg_base_write(fn, baseName, cellDim, physDim, &B), "cg_base_write");
+      }
+
+      WritePreparedZone(fn, B, zoneName, mesh, zone, options, ResetPrecisionLoss(options));
+
+      const CgnsAccess access(fn, "cg_close");
+      CheckCg(cg_close(fn), "cg_close");
+    }
+    catch (...)
+    {
+      const CgnsAccess access(fn);
+      cg_close(fn);
+      throw;
+    }
+
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+int cgns_writer::WriteUnstructuredBatch(const UnstructuredMeshInfo* meshes,
+                                        const char* const* zone_names,
+                                        const int num_zones,
+                                        const char* output_path,
+                                        const CgnsWriteOptions* options)
+{
+  CGNS_TRACE_SCOPE("WriteUnstructuredBatch");
+  const StatsRecorder stats;
+  try
+  {
+    if (!output_path || output_path[0] == '\0')
+    {
+      throw std::runtime_error("output_path is null or empty");
+    }
+    if (!meshes || num_zones <= 0)
+    {
+      throw std::runtime_error("meshes is null or num_zones <= 0");
+    }
+    // meshes[0] first: only a matching size makes the array stride right for the others.
+    CheckStructSizes(meshes, options);
+    for (int z = 1; z < num_zones; ++z)
+    {
+      CheckStructSizes(&meshes[z], nullptr);
+    }
+
+    std::vector<std::string> zoneNames(static_cast<size_t>(num_zones));
+    int cellDim = 0;
+    for (int z = 0; z < num_zones; ++z)
+    {
+      const char* name = zone_names ? zone_names[z] : nullptr;
+      zoneNames[static_cast<size_t>(z)] = (name && name[0] != '\0') ? name : "Zone" + std::to_string(z);
+      cellDim = std::max(cellDim, ScanCellDim(meshes[z]));
+    }
+
+    const int fn = OpenForWrite(output_path, options);
+
+    // Zone z + 1 is validated and sorted on a worker while zone z is written, so at
+    // most two prepared zones are alive at a time. The worker never calls libcgns.
+    // Its phases are handed back with the zone and merged into the caller's stats.
+    struct Prepared
+    {
+      PreparedZone zone;
+      cgns_writer::phase::Record phases;
+    };
+    auto prepare = [&](const int z) {
+      CGNS_TRACE_SCOPE("PrepareZone");
+      cgns_writer::phase::Capture capture;
+      Prepared out;
+      try
+      {
+        out.zone = PrepareZone(meshes[z], options, false);
+      }
+      catch (const std::exception& ex)
+      {
+        throw std::runtime_error("Zone " + zoneNames[static_cast<size_t>(z)] + ": " + ex.what());
+      }
+      out.phases = capture.Finish();
+      return out;
+    };
+    std::future<Prepared> next;
+
+    try
+    {
+      next = std::async(std::launch::async, prepare, 0);
+
+      int B = 0;
+      {
+        const CgnsAccess access(fn, "cg_base_write");
+        CheckCg(cg_base_write(fn, BaseName(options), cellDim > 0 ? cellDim : 3, 3, &B), "cg_base_write");
+      }
+
+      double* maxLoss = ResetPrecisionLoss(options);
+      for (int z = 0; z < num_zones; ++z)
+      {
+        const Prepared prepared = next.get();
+        cgns_writer::phase::Merge(prepared.phases);
+        if (z + 1 < num_zones)
+        {
+          next = std::async(std::launch::async, prepare, z + 1);
+        }
+        WritePreparedZone(fn, B, zoneNames[static_cast<size_t>(z)].c_str(), meshes[z], prepared.zone, options,
+                          maxLoss);
+      }
+
+      const CgnsAccess access(fn, "cg_close");
+      CheckCg(cg_close(fn), "cg_close");
+    }
+    catch (...)
+    {
+      if (next.valid())
+      {
+        next.wait();
+      }
+      const CgnsAccess access(fn);
+      cg_close(fn);
+      throw;
+    }
+
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_write_unstructured(const UnstructuredMeshInfo* mesh,
+                                                       const char* output_path,
+                                                       const CgnsWriteOptions* options)
+{
+  if (!mesh)
+  {
+    SetLastError("mesh is null");
+    return 1;
+  }
+  return cgns_writer::WriteUnstructured(*mesh, output_path, options);
+}
+
+extern "C" CGNS_WRITER_API int cgns_write_unstructured_batch(const UnstructuredMeshInfo* meshes,
+                                                             const char* const* zone_names,
+                                                             int num_zones,
+                                                             const char* output_path,
+                                                             const CgnsWriteOptions* options)
+{
+  return cgns_writer::WriteUnstructuredBatch(meshes, zone_names, num_zones, output_path, options);
+}
+
+extern "C" CGNS_WRITER_API void cgns_mesh_info_init(UnstructuredMeshInfo* mesh)
+{
+  if (mesh)
+  {
+    *mesh = UnstructuredMeshInfo{};
+    mesh->struct_size = sizeof(UnstructuredMeshInfo);
+  }
+}
+
+extern "C" CGNS_WRITER_API void cgns_write_options_init(CgnsWriteOptions* options)
+{
+  if (options)
+  {
+    *options = CgnsWriteOptions{};
+    options->struct_size = sizeof(CgnsWriteOptions);
+    options->use_hdf5 = 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API const char* cgns_get_last_error(void)
+{
+  return g_last_error.c_str();
+}
+
+extern "C" CGNS_WRITER_API const CgnsWriteStats* cgns_writer_get_last_stats(void)
+{
+  return g_last_stats.valid ? &g_last_stats.view : nullptr;
+}
+
+extern "C" CGNS_WRITER_API int cgns_writer_trace_dump(const char* path)
+{
+#if CGNS_WRITER_ENABLE_TRACE
+  if (!path || path[0] == '\0')
+  {
+    path = std::getenv("CGNS_WRITER_TRACE_FILE");
+  }
+  if (!path || path[0] == '\0')
+  {
+    SetLastError("path is null and CGNS_WRITER_TRACE_FILE is not set");
+    return 1;
+  }
+  if (!cgns_writer::trace::Dump(path))
+  {
+    SetLastError(std::string("Cannot write trace file ") + path);
+    return 1;
+  }
+  SetLastError("");
+  return 0;
+#else
+  (void)path;
+  SetLastError("Tracing is not compiled in; configure with -DCGNS_WRITER_TRACE=ON");
+  return 1;
+#endif
 }
 
 extern "C" CGNS_WRITER_API const char* cgns_writer_version(void)
 {
-  return "0.1.0";
+  return "0.2.0";
 }
@@ -9,4 +9,11 @@ namespace cgns_writer
 CGNS_WRITER_API int WriteUnstructured(const UnstructuredMeshInfo& mesh,
                                       const char* output_path,
                                       const CgnsWriteOptions* options);
+
+// C++ 内部入口：在同一个 base 下写入多个 zone，见 cgns_write_unstructured_batch。
+CGNS_WRITER_API int WriteUnstructuredBatch(const UnstructuredMeshInfo* meshes,
+                                           const char* const* zone_names,
+                                           int num_zones,
+                                           const char* output_path,
+                                           const CgnsWriteOptions* options);
 } // namespace cgns_writer
@@ -0,0 +1,212 @@
+#pragma once
+
+// cgns_writer_dll 内部共享的辅助函数，不属于公开 API。
+
+#include "CgnsWriterExport.h"
+#include "CgnsWriterPhaseTimer.h"
+
+#include <cgnslib.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// cg_coord_general_write / cg_field_general_write (memory-strided I/O) are available from CGNS 4.0.
+#if defined(CGNS_VERSION) && CGNS_VERSION >= 4000
+#  define CGNS_WRITER_HAVE_GENERAL_WRITE 1
+#else
+#  define CGNS_WRITER_HAVE_GENERAL_WRITE 0
+#endif
+
+namespace cgns_writer
+{
+namespace detail
+{
+// Sets the thread-local message returned by cgns_get_last_error.
+void SetLastError(const std::string& msg);
+
+// Throws std::runtime_error with the libcgns error text when ierr != CG_OK.
+void CheckCg(int ierr, const std::string& what);
+
+struct CellTypeInfo
+{
+  CGNS_ENUMT(ElementType_t) type = CGNS_ENUMV(ElementTypeNull);
+  int nodesPerElem = 0; // 0 for VTK_POLYGON (NGON_n) and VTK_POLYHEDRON (NFACE_n), whose size varies
+  int dim = 0;
+  bool supported = false;
+};
+
+// VTK cell type -> CGNS element info, indexed directly by the unsigned char type id.
+const std::array<CellTypeInfo, 256>& CellTypeTable();
+
+// Node counts for branch-free lookups: n > 0 = exactly n, n < 0 = at least -n (VTK_POLYGON),
+// 0 = unsupported or VTK_POLYHEDRON, whose face stream is only checked cell by cell.
+const std::array<int64_t, 256>& NodesPerElemTable();
+
+std::string DefaultSectionName(CGNS_ENUMT(ElementType_t) t);
+
+// Resolves and checks CgnsWriteOptions::validate (CGNS_VALIDATE_FAST when options is null).
+int ValidateLevel(const CgnsWriteOptions* options);
+
+// Resolves and checks CgnsWriteOptions::section_layout (CGNS_SECTIONS_BY_TYPE when options is null).
+int SectionLayout(const CgnsWriteOptions* options);
+
+// Smallest and largest of count ids (lo > hi when count == 0). Branch-free and vectorizable.
+void IdRange(const int32_t* ids, size_t count, int64_t& lo, int64_t& hi);
+void IdRange(const int64_t* ids, size_t count, int64_t& lo, int64_t& hi);
+
+// Resolves and checks CgnsWriteOptions::reorder (CGNS_REORDER_NONE when options is null).
+int ReorderMethod(const CgnsWriteOptions* options);
+
+// Resolves CgnsWriteOptions::num_threads: 0/1 = serial, <0 = all hardware threads.
+int ResolveThreadCount(const CgnsWriteOptions* options);
+
+// Runs fn(block) for every block in [0, numBlocks), one thread per block.
+// Block 0 runs on the calling thread. If several blocks fail, the exception
+// of the lowest block is rethrown so errors match the serial cell order.
+void ParallelBlocks(size_t numBlocks, const std::function<void(size_t)>& fn);
+
+// Validates level (0-9) and applies it as the libcgns HDF5 deflate level for files opened next.
+void SetCompression(bool useHdf5, int level);
+
+// Selects the file type from options->use_hdf5, applies options->compression_level
+// and opens output_path with CG_MODE_WRITE.
+int OpenForWrite(const char* output_path, const CgnsWriteOptions* options);
+
+// Exclusive access to libcgns for the lifetime of the object. libcgns is not
+// re-entrant and keeps process-wide state (open-file table, cg_goto position,
+// error text, file type, HDF5 compression level), so every libcgns call and the
+// CheckCg reading its error runs inside one. Scopes nest on the same thread.
+// Given a file opened by OpenForWrite, the scope re-applies that file's
+// compression level in case a write to another file changed it. Keep scopes
+// around libcgns calls only, so validation, sectioning and conversion of
+// concurrent writes stay parallel. When call is set, the wait for the lock and
+// the time the scope is held are recorded as the phases "cgns lock wait" and call,
+// with bytes (the data handed to libcgns) added to call.
+class CgnsAccess
+{
+public:
+  explicit CgnsAccess(int fn = 0, const char* call = nullptr, int64_t bytes = 0);
+  CgnsAccess(const CgnsAccess&) = delete;
+  CgnsAccess& operator=(const CgnsAccess&) = delete;
+
+private:
+  std::unique_lock<std::recursive_mutex> Lock;
+  phase::Scope Held;
+};
+
+// File data type for a CGNS_PRECISION_* value.
+CGNS_ENUMT(DataType_t) PrecisionType(int precision);
+
+// Destination of a strided array write: a grid coordinate (S == 0) or a field of FlowSolution S.
+struct ArrayTarget
+{
+  int fn = 0;
+  int B = 0;
+  int Z = 0;
+  int S = 0;
+  const char* name = nullptr;
+};
+
+// One component of an interleaved array: row i is data[i * stride + component], i < rows.
+struct StridedComponent
+{
+  const void* data = nullptr;
+  CGNS_ENUMT(DataType_t) type = CGNS_ENUMV(RealDouble);
+  int64_t stride = 1;
+  int component = 0;
+  int64_t rows = 0;
+};
+
+// True when a fileType array can be written from memory of memType without a scratch copy.
+bool CanWriteStrided(CGNS_ENUMT(DataType_t) fileType, CGNS_ENUMT(DataType_t) memType);
+
+// Writes rows [srcFirst, srcFirst + count) of src to file entries [fileFirst, fileFirst + count).
+// fileType must equal src.type, or be RealSingle for RealDouble input (rounded, tracked in maxLoss).
+void WriteStridedRange(const ArrayTarget& target, CGNS_ENUMT(DataType_t) fileType, const StridedComponent& src,
+                       int64_t srcFirst, int64_t fileFirst, int64_t count, double* maxLoss);
+
+// Writes CoordinateX/Y/Z for points [first, first + count) of zone Z from an
+// interleaved [x0, y0, z0, x1, ...] buffer. Double output uses strided general
+// writes so no per-component copy is made; single output (and libcgns without
+// general writes) goes through a bounded scratch block.
+void WriteInterleavedCoords(int fn, int B, int Z, const double* points, int64_t first, int64_t count,
+                            CGNS_ENUMT(DataType_t) fileType, double* maxLoss);
+
+// Throws when a CgnsFieldInfo array is malformed; what names the array in the message.
+void ValidateFields(const CgnsFieldInfo* fields, int numFields, const char* what);
+
+// Writes FlowSolution solName at location loc with one CGNS field per component.
+// Without rowOrder, file entry e holds row e; with it, file entry e holds row rowOrder[e]
+// (used to follow the section order of cells). Contiguous runs of rows are written
+// straight from the caller's buffer, the rest is gathered through a bounded block.
+void WriteFieldSolution(int fn, int B, int Z, const char* solName, CGNS_ENUMT(GridLocation_t) loc,
+                        const CgnsFieldInfo* fields, int numFields, int64_t numRows, const int64_t* rowOrder,
+                        int precision, double* maxLoss);
+
+// One element section of a zone, with connectivity already shifted to 1-based ids.
+struct Section
+{
+  CGNS_ENUMT(ElementType_t) type = CGNS_ENUMV(ElementTypeNull);
+  std::string name;
+  int nodesPerElem = 0;
+  cgsize_t numElems = 0;
+  std::vector<cgsize_t> conn;
+  std::vector<cgsize_t> offsets; // MIXED/NGON_n/NFACE_n only: start of each element in conn, then conn.size()
+  // conn and offsets as 32-bit integers once connectivity::Narrow has moved them here; conn and offsets
+  // are then empty.
+  std::vector<int32_t> conn32;
+  std::vector<int32_t> offsets32;
+  cgsize_t start = 0;
+  cgsize_t end = 0;
+};
+
+// Writes a section that has offsets (MIXED, NGON_n, NFACE_n); see output::WritePolySection.
+void WritePolySection(int fn, int B, int Z, const Section& s, int64_t bytes);
+
+// Everything computed for a zone before libcgns is touched.
+struct PreparedZone
+{
+  std::vector<Section> sections;
+  std::vector<int64_t> elemToCell; // written element (0-based) -> input cell; empty unless requested or MIXED
+  int cellDim = 0;
+  cgsize_t numCells = 0; // elements that are cells: all but the NGON_n faces of a polyhedral zone
+
+  // Set when options->reorder renumbers the points: the interleaved coordinates in the new
+  // order, and the input point of every written vertex.
+  std::vector<double> points;
+  std::vector<int64_t> pointOrder;
+};
+
+// Throws unless mesh and options (either may be null) carry the struct_size of this library's
+// CgnsWriterExport.h, before any other member is read.
+void CheckStructSizes(const UnstructuredMeshInfo* mesh, const CgnsWriteOptions* options);
+
+// Throws when the geometry, topology or field descriptors of mesh are malformed.
+void ValidateMesh(const UnstructuredMeshInfo& mesh);
+
+// Validates mesh (to options->validate) and sorts its cells into sections using
+// options->num_threads. elemToCell is filled when needElemToCell is set or the
+// mesh carries cell fields, except with CGNS_SECTIONS_MIXED, where the single
+// section keeps the input cell order and elemToCell stays empty. Meshes with VTK_POLYHEDRON
+// cells become an NGON_n section of their deduplicated faces and an NFACE_n section of the
+// cells in input order (elemToCell stays empty), whatever the layout. With options->reorder the
+// points and cells are renumbered first and sectioned in their new order; elemToCell then maps
+// back to input cells in every layout when requested or needed. Sections whose ids and offsets
+// fit in 32 bits are then narrowed to conn32/offsets32 (see CgnsWriterConnectivity.h).
+// Does not call libcgns.
+PreparedZone PrepareZone(const UnstructuredMeshInfo& mesh, const CgnsWriteOptions* options, bool needElemToCell);
+
+// Writes zone, coordinates, sections and the mesh's PointData/CellData solutions, in the
+// order of the prepared zone; returns Z. Narrowed sections are written as Integer data.
+int WritePreparedZone(int fn, int B, const char* zoneName, const UnstructuredMeshInfo& mesh,
+                      const PreparedZone& zone, const CgnsWriteOptions* options, double* maxLoss);
+
+// options->base_name, or "Base" when unset.
+const char* BaseName(const CgnsWriteOptions* options);
+} // namespace detail
+} // namespace cgns_writer
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef _WIN32
@@ -16,7 +17,32 @@
 extern "C" {
 #endif
 
+// 场数据的内存类型
+enum {
+    CGNS_FIELD_FLOAT64 = 0,   // double，按 CgnsWriteOptions 中的精度写出
+    CGNS_FIELD_FLOAT32 = 1,   // float，写为 RealSingle
+    CGNS_FIELD_INT32 = 2,     // int32_t，写为 Integer
+    CGNS_FIELD_INT64 = 3      // int64_t，写为 LongInteger
+};
+
+// 一个点场或单元场。第 i 个点/单元的第 c 个分量位于 data[i * stride + c]（以元素计），
+// 每个分量直接从该缓冲区写出，不做整体拷贝。
 typedef struct {
+    const char* name;         // 场名称，NULL 时使用 "PointArray_<序号>" / "CellArray_<序号>"；
+                              // 多分量场写为 name_X / name_Y / name_Z / name_W / name_C<c>
+    int data_type;            // CGNS_FIELD_*
+    int num_components;       // 分量数 (>= 1)
+    const void* data;         // 交错存储的场数据，长度至少 (n - 1) * stride + num_components
+    int64_t stride;           // 相邻点/单元之间的元素间隔，0 = num_components
+} CgnsFieldInfo;
+
+// UnstructuredMeshInfo 与 CgnsWriteOptions 按指针跨越 DLL 边界，且随版本在末尾追加成员。
+// 二者的首个成员 struct_size 必须等于调用方头文件中的 sizeof，库据此拒绝用不同版本头文件编译的调用方，
+// 而不是越界读取；用 cgns_mesh_info_init / cgns_write_options_init 初始化即可。
+
+typedef struct {
+    size_t struct_size;       // sizeof(UnstructuredMeshInfo)，见 cgns_mesh_info_init
+
     // --- 节点数据 ---
     double* points;           // [x0, y0, z0, x1, y1, z1, ...]
     int64_t num_points;       // 顶点数量
@@ -29,25 +55,254 @@ typedef struct {
     int64_t num_cells;        // 单元数量
 
     unsigned char* types;     // VTK 单元类型数组 (VTK_WEDGE=13, etc.)
+                              // 支持线性单元及二次单元 VTK_QUADRATIC_EDGE/TRIANGLE/QUAD/TETRA/PYRAMID/WEDGE/HEXAHEDRON、
+                              // VTK_BIQUADRATIC_QUAD、VTK_BIQUADRATIC_QUADRATIC_WEDGE、VTK_TRIQUADRATIC_HEXAHEDRON，
+                              // 节点按 VTK 顺序给出，写入时重排为 CGNS 顺序
+                              // VTK_POLYGON(7) 单元为 >= 3 个节点，写入 NGON_n section；
+                              // VTK_POLYHEDRON(42) 单元的连接段是 VTK 面流 [面数, 面0节点数, 面0节点..., 面1节点数, ...]。
+                              // 含多面体的 zone 写为 NGON_n（去重后的面）+ NFACE_n（按输入顺序的单元，面号带方向符号），
+                              // 其中只能有三维单元，此时忽略 section_layout
 
     // --- 格式标志 ---
     int use_64bit_ids;        // connectivity/offsets 是 1 = int64_t*, 0 = int32_t*
+
+    // --- 场数据（可选）---
+    const CgnsFieldInfo* point_fields; // 点场，写入 Vertex 位置的 FlowSolution "PointData"
+    int num_point_fields;
+    const CgnsFieldInfo* cell_fields;  // 单元场（按输入单元顺序），写入 CellCenter 位置的 FlowSolution "CellData"，
+                                       // 自动重排为 section 中的单元顺序（CGNS_SECTIONS_MIXED 时无需重排）
+    int num_cell_fields;
 } UnstructuredMeshInfo;
 
+// 浮点输出精度
+enum {
+    CGNS_PRECISION_DOUBLE = 0,   // RealDouble（默认）
+    CGNS_PRECISION_SINGLE = 1    // RealSingle：文件体积和 I/O 时间减半，适合仅用于可视化的输出
+};
+
+// 输入校验级别
+enum {
+    CGNS_VALIDATE_FAST = 0,   // 默认：无分支的整块检查（偏移/单元节点数/节点编号范围），失败后再定位首个出错单元
+    CGNS_VALIDATE_FULL = 1,   // FAST 之外还要求 offsets[0] == 0、offsets[num_cells] == connectivity_size，且单元内节点不重复
+    CGNS_VALIDATE_NONE = 2    // 跳过校验（仅保留不支持单元类型的检查）；输入无效时行为未定义，仅用于可信的求解器输出
+};
+// 会话接口没有 offsets，FULL 与 FAST 相同：只检查每块连接的节点编号范围。
+
+// 单元分段方式
+enum {
+    CGNS_SECTIONS_BY_TYPE = 0,   // 默认：每种单元类型一个 section，单元按类型重排
+    CGNS_SECTIONS_MIXED = 1      // 单个 MIXED section：逐单元的类型标记 + 偏移数组，保持输入单元顺序，
+                                 // 省去重排及单元场的按序收集，单元场直接从输入缓冲区连续写出；
+                                 // CGNS 的 MIXED 不能包含 NGON_n，因此不支持 VTK_POLYGON 单元
+};
+
+// 点与单元的重排方式：按局部性重新编号后写出，改善读取端的缓存与 HDF5 分块局部性
+enum {
+    CGNS_REORDER_NONE = 0,       // 默认：保持输入顺序
+    CGNS_REORDER_HILBERT = 1,    // 点按坐标、单元按形心（节点坐标均值）沿 Hilbert 曲线排序
+    CGNS_REORDER_RCM = 2         // 点按共单元节点图的逆 Cuthill-McKee 顺序，单元按其最小的新节点号排序
+};
+// 重排在分段之前进行，需额外拷贝一份坐标和拓扑；点场和单元场按新顺序收集写出，不拷贝。
+// 写出的点/单元顺序即新顺序，调用方需要原编号时自行保存映射。会话接口不重排。
+
 typedef struct {
+    size_t struct_size;      // sizeof(CgnsWriteOptions)，见 cgns_write_options_init
     int use_hdf5;            // 1=HDF5(默认), 0=ADF
     const char* base_name;   // CGNS base 名称，NULL="Base"
     const char* zone_name;   // Zone 名称，NULL="Zone0"
+    int num_threads;         // 分段/校验线程数：0 或 1 = 单线程，>1 = 指定线程数，<0 = 全部硬件线程
+    int coord_precision;     // 坐标精度：CGNS_PRECISION_DOUBLE（默认）/ CGNS_PRECISION_SINGLE
+    double* max_precision_loss; // 非 NULL 时返回单精度输出（就近舍入）引入的最大绝对误差；会话中需保持有效直到 close
+    int point_data_precision;   // CGNS_FIELD_FLOAT64 点场的输出精度，默认 CGNS_PRECISION_DOUBLE
+    int cell_data_precision;    // CGNS_FIELD_FLOAT64 单元场的输出精度，默认 CGNS_PRECISION_DOUBLE
+    int compression_level;      // HDF5 deflate 压缩级别：0 = 不压缩（默认），1-9 = 压缩，仅 use_hdf5 时有效。
+                                // 数据集的分块布局由 libcgns 决定；库内按文件记录该级别，并发写不同文件时互不影响
+    int async_queue_depth;      // cgns_write_unstructured_async 允许同时挂起（排队或正在写）的作业数，0 = 2
+    int validate;               // 输入校验级别 CGNS_VALIDATE_*，默认 CGNS_VALIDATE_FAST
+    int section_layout;         // 单元分段方式 CGNS_SECTIONS_*，默认 CGNS_SECTIONS_BY_TYPE；会话接口始终按类型分段
+    int reorder;                // 点与单元的重排方式 CGNS_REORDER_*，默认 CGNS_REORDER_NONE；按 num_threads 并行计算
 } CgnsWriteOptions;
 
+// 将 *mesh 清零并设置 struct_size。
+CGNS_WRITER_API void cgns_mesh_info_init(UnstructuredMeshInfo* mesh);
+
+// 将 *options 设为默认值（use_hdf5 = 1，其余为 0）并设置 struct_size。
+CGNS_WRITER_API void cgns_write_options_init(CgnsWriteOptions* options);
+
 // 返回 0 表示成功，非 0 表示失败。失败原因可通过 cgns_get_last_error 获取。
+// 线程安全：多个线程可同时写不同的文件。libcgns 不可重入，库内只串行化对 libcgns 的调用，
+// 校验、分段排序和场数据转换在各调用线程上并行执行。同一文件不能被并发写入。
+// libcgns 以 64 位 cgsize_t 构建（且版本 >= 4.1）时，节点编号与偏移都不超过 int32 范围的 section
+// 自动以 32 位整数（Integer）保存和写出，节省的字节数见 CgnsSectionStats::bytes_saved。
 CGNS_WRITER_API int cgns_write_unstructured(const UnstructuredMeshInfo* mesh,
                                             const char* output_path,
                                             const CgnsWriteOptions* options);
 
+// 在一次 open/close 中把 num_zones 个网格写入同一个 base，每个网格一个 zone（例如按分区写出）。
+// zone_names 可为 NULL，或其中某项为 NULL，此时使用 "Zone<序号>"；options->zone_name 被忽略。
+// 下一个 zone 的校验与分段排序在后台线程上与当前 zone 的写入重叠进行，
+// 因此峰值内存约为两个 zone 的分段数据之和。base 的单元维度取所有 zone 的最大值。
+CGNS_WRITER_API int cgns_write_unstructured_batch(const UnstructuredMeshInfo* meshes,
+                                                  const char* const* zone_names,
+                                                  int num_zones,
+                                                  const char* output_path,
+                                                  const CgnsWriteOptions* options);
+
+// --- 异步写入 ---
+// 作业状态（cgns_job_poll 的返回值）
+enum {
+    CGNS_JOB_PENDING = 0,     // 排队中或正在写入
+    CGNS_JOB_SUCCEEDED = 1,
+    CGNS_JOB_FAILED = 2
+};
+
+typedef struct CgnsWriteJob CgnsWriteJob;
+
+// 提交一次 cgns_write_unstructured，分段与 HDF5 写入在库内唯一的后台写线程上按提交顺序执行。
+// release 为 NULL 时，调用内会复制 mesh 的全部数组（含场数据），返回后调用方即可修改或释放缓冲区；
+// release 非 NULL 时不做复制，调用方须保持缓冲区有效，直到写线程在作业结束（无论成败）后调用 release(user_data)。
+// 若已有 options->async_queue_depth 个作业挂起，本调用会阻塞到有作业完成为止，因此快照占用的内存有上界。
+// 参数错误在本调用中直接返回；网格拓扑错误和 I/O 错误通过作业报告。options->max_precision_loss
+// 若非 NULL，须在作业完成前保持有效。后台作业可与其他线程上的同步写入函数同时进行。
+// 进程退出前应对所有作业调用 cgns_job_wait 或 cgns_job_free。
+CGNS_WRITER_API int cgns_write_unstructured_async(const UnstructuredMeshInfo* mesh,
+                                                  const char* output_path,
+                                                  const CgnsWriteOptions* options,
+                                                  void (*release)(void* user_data),
+                                                  void* user_data,
+                                                  CgnsWriteJob** out_job);
+
+// 返回作业状态 CGNS_JOB_*，不阻塞。
+CGNS_WRITER_API int cgns_job_poll(const CgnsWriteJob* job);
+
+// 阻塞直到作业结束。返回 0 表示成功，非 0 表示失败，失败原因同时写入 cgns_get_last_error。
+CGNS_WRITER_API int cgns_job_wait(const CgnsWriteJob* job);
+
+// 返回作业的错误信息；作业未结束或成功时为空字符串。指针在 cgns_job_free 之前有效。
+CGNS_WRITER_API const char* cgns_job_error(const CgnsWriteJob* job);
+
+// 等待作业结束并释放句柄。
+CGNS_WRITER_API void cgns_job_free(CgnsWriteJob* job);
+
+// --- 分块流式写入 ---
+// 按分区逐块写入非结构网格，峰值内存只取决于单次传入的块大小，与网格总规模无关。
+// 调用顺序：open -> define_zone -> define_section (每种单元类型一次) -> append_coords / append_elements
+// (任意顺序、任意块大小) -> close。可多次 define_zone 在同一 base 下写入多个 zone。
+// 所有函数返回 0 表示成功，非 0 表示失败（原因见 cgns_get_last_error）。单个会话对象不是线程安全的，不同会话可在不同线程上同时使用。
+typedef struct CgnsSession CgnsSession;
+
+// 打开输出文件并写入 base。cell_dim 为 base 的单元维度，0 = 3。
+CGNS_WRITER_API int cgns_session_open(const char* output_path,
+                                      const CgnsWriteOptions* options,
+                                      int cell_dim,
+                                      CgnsSession** out_session);
+
+// 定义下一个非结构 zone 的总点数和总单元数；zone_name 为 NULL 时使用 "Zone<序号>"。
+// 上一个 zone 必须已经写完整。
+CGNS_WRITER_API int cgns_session_define_zone(CgnsSession* session,
+                                             const char* zone_name,
+                                             int64_t num_points,
+                                             int64_t num_cells);
+
+// 为当前 zone 声明一个单元类型的 section 及其单元总数，单元编号按声明顺序连续分配。
+// 仅支持节点数固定的单元类型（不支持 VTK_POLYGON / VTK_POLYHEDRON）。
+CGNS_WRITER_API int cgns_session_define_section(CgnsSession* session,
+                                                unsigned char vtk_type,
+                                                int64_t num_elements);
+
+// 追加 count 个点，points 为交错坐标 [x0, y0, z0, x1, ...]。
+CGNS_WRITER_API int cgns_session_append_coords(CgnsSession* session,
+                                               const double* points,
+                                               int64_t count);
+
+// 向 vtk_type 对应的 section 追加 num_elements 个单元。connectivity 为 0 基节点编号，
+// 每个单元的节点数由单元类型决定（无需 offsets）；use_64bit_ids 含义同 UnstructuredMeshInfo。
+CGNS_WRITER_API int cgns_session_append_elements(CgnsSession* session,
+                                                 unsigned char vtk_type,
+                                                 const void* connectivity,
+                                                 int64_t num_elements,
+                                                 int use_64bit_ids);
+
+// 检查当前 zone 是否写完整，关闭文件并释放会话（无论成功与否 session 都会失效）。
+CGNS_WRITER_API int cgns_session_close(CgnsSession* session);
+
+// --- 时间序列写入 ---
+// 网格只写一次，之后每个时间步追加一组 FlowSolution_t；文件句柄在各步之间保持打开，
+// 每步的开销只与该步的场数据量有关。close 时写入 BaseIterativeData_t (TimeValues)、
+// ZoneIterativeData_t (FlowSolutionPointers)，并将 SimulationType 设为 TimeAccurate。
+// 所有函数返回 0 表示成功，非 0 表示失败（原因见 cgns_get_last_error）。单个对象不是线程安全的，不同对象可在不同线程上同时使用。
+typedef struct CgnsTimeSeries CgnsTimeSeries;
+
+// 打开输出文件并写入网格。mesh 中的场作为不随时间变化的 "PointData" / "CellData" 写入；
+// mesh 的几何与拓扑数组在 open 返回后即可释放。
+CGNS_WRITER_API int cgns_timeseries_open(const char* output_path,
+                                         const UnstructuredMeshInfo* mesh,
+                                         const CgnsWriteOptions* options,
+                                         CgnsTimeSeries** out_series);
+
+// 追加一个时间步（步号从 1 开始）。点场写入 Vertex 位置的 "PointData_<步号>"，
+// 单元场写入 CellCenter 位置的 "CellData_<步号>"，行数分别为网格的点数与单元数，
+// 点场和单元场按输入点/单元顺序给出（options->reorder 的重排在各步沿用）。失败的步不会记入迭代数据，
+// 但仍占用其步号（其中已写出的部分 FlowSolution_t 保留在文件中），之后的步可以继续追加。
+CGNS_WRITER_API int cgns_timeseries_append_step(CgnsTimeSeries* series,
+                                                double time,
+                                                const CgnsFieldInfo* point_fields,
+                                                int num_point_fields,
+                                                const CgnsFieldInfo* cell_fields,
+                                                int num_cell_fields);
+
+// 写入迭代数据，关闭文件并释放对象（无论成功与否 series 都会失效）。
+CGNS_WRITER_API int cgns_timeseries_close(CgnsTimeSeries* series);
+
 // 返回最近一次失败的错误信息（线程局部存储）。
 CGNS_WRITER_API const char* cgns_get_last_error(void);
 
+// --- 写入统计 ---
+// 一个阶段的累计统计。阶段可以嵌套（如 "coords" 包含其中的 cg_coord_*_write），
+// 因此各阶段时间之和可能大于总时间。
+typedef struct {
+    const char* name;         // 阶段名："validate"、"reorder"、"section"、"coords"、"fields"、"convert"、"cgns lock wait"，
+                              // 或 libcgns 调用名（如 "cg_section_write"、"cg_field_general_write"）
+    double seconds;           // 墙钟时间，含嵌套阶段
+    int64_t calls;            // 进入次数
+    int64_t bytes;            // 该阶段交给 libcgns 的数据量（压缩前），不写数据的阶段为 0
+} CgnsPhaseStats;
+
+// 一个 element section 的统计。
+typedef struct {
+    const char* zone_name;
+    const char* name;         // section 名
+    int element_type;         // CGNS ElementType_t
+    int64_t num_elements;
+    int64_t bytes;            // 连接数组字节数
+    double seconds;           // 写出该 section 的墙钟时间
+    int64_t bytes_saved;      // 连接数组以 32 位整数写出而比 64 位 cgsize_t 节省的字节数，未收窄时为 0
+} CgnsSectionStats;
+
+typedef struct {
+    double wall_seconds;      // 整个调用的墙钟时间
+    int64_t bytes_written;    // 坐标、连接与场数据交给 libcgns 的总字节数（压缩前，不含文件元数据）
+    int num_zones;            // 已写出的 zone 数
+    int64_t num_points;       // 已写出 zone 的点数之和
+    int64_t num_elements;     // 已写出 zone 的单元数之和
+    const CgnsPhaseStats* phases;     // 按首次进入的顺序
+    int num_phases;
+    const CgnsSectionStats* sections; // 按写出顺序
+    int num_sections;
+    int64_t connectivity_bytes_saved; // 各 section 的 bytes_saved 之和
+} CgnsWriteStats;
+
+// 返回本线程最近一次 cgns_write_unstructured / cgns_write_unstructured_batch 调用的统计（无论成败，
+// 失败时只含失败前完成的部分）；本线程尚未调用过时返回 NULL。返回的指针及其中的数组在本线程下一次
+// 写入调用之前有效。批量写入中后台线程上的校验与分段也计入，其时间与写入重叠。
+// 异步作业、会话和时间序列接口不记录统计。
+CGNS_WRITER_API const CgnsWriteStats* cgns_writer_get_last_stats(void);
+
+// 将已记录的 trace span 写为 Chrome trace JSON（可在 chrome://tracing 或 Perfetto 中打开）。
+// 仅当以 -DCGNS_WRITER_TRACE=ON 构建时记录 span，否则返回失败；path 为 NULL 时使用环境变量
+// CGNS_WRITER_TRACE_FILE（设置该变量时进程退出时也会自动写出）。应在没有写入进行时调用。
+CGNS_WRITER_API int cgns_writer_trace_dump(const char* path);
+
 // 返回库版本字符串。
 CGNS_WRITER_API const char* cgns_writer_version(void);
 
@@ -0,0 +1,99 @@
+#pragma once
+
+// Node order of VTK's quadratic cells in CGNS. Most of them number their nodes the same way
+// in both (corners, then mid-edge nodes, then face and volume centres); the wedges and
+// hexahedra list their mid-edge nodes in a different edge order and are permuted here.
+// Header-only so that both cgns_writer and cgns_writer_dll can use it; not part of either
+// library's public API.
+
+#include <cgnslib.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace cgns_writer
+{
+namespace node_order
+{
+constexpr unsigned char kVtkQuadraticHexahedron = 25;
+constexpr unsigned char kVtkQuadraticWedge = 26;
+constexpr unsigned char kVtkTriquadraticHexahedron = 29;
+constexpr unsigned char kVtkBiquadraticQuadraticWedge = 32;
+
+// CGNS node k of an element is VTK node Perm[k]. VTK lists the mid-edge nodes of the top
+// face before those of the vertical edges, CGNS the vertical ones first; HEXA_27 also
+// orders its face centres bottom, front, right, back, left, top where VTK goes -x, +x, -y,
+// +y, -z, +z.
+inline constexpr std::array<unsigned char, 15> kPenta15 = {
+  0, 1, 2, 3, 4, 5, // corners
+  6, 7, 8,          // bottom edges
+  12, 13, 14,       // vertical edges
+  9, 10, 11,        // top edges
+};
+inline constexpr std::array<unsigned char, 18> kPenta18 = {
+  0, 1, 2, 3, 4, 5, // corners
+  6, 7, 8,          // bottom edges
+  12, 13, 14,       // vertical edges
+  9, 10, 11,        // top edges
+  15, 16, 17,       // quadrilateral face centres
+};
+inline constexpr std::array<unsigned char, 20> kHexa20 = {
+  0, 1, 2, 3, 4, 5, 6, 7, // corners
+  8, 9, 10, 11,           // bottom edges
+  16, 17, 18, 19,         // vertical edges
+  12, 13, 14, 15,         // top edges
+};
+inline constexpr std::array<unsigned char, 27> kHexa27 = {
+  0, 1, 2, 3, 4, 5, 6, 7, // corners
+  8, 9, 10, 11,           // bottom edges
+  16, 17, 18, 19,         // vertical edges
+  12, 13, 14, 15,         // top edges
+  24, 22, 21, 23, 20, 25, // face centres
+  26,                     // volume centre
+};
+
+// Copies count elements of one type, Perm.size() nodes each, to dst in CGNS order plus
+// shift. The permutation is a template argument, so the inner loop unrolls into plain moves.
+template <const auto& Perm, typename IdT>
+void CopyPermuted(const IdT* ids, const int64_t count, const cgsize_t shift, cgsize_t* dst)
+{
+  constexpr size_t n = Perm.size();
+  for (int64_t e = 0; e < count; ++e, ids += n, dst += n)
+  {
+    for (size_t k = 0; k < n; ++k)
+    {
+      dst[k] = static_cast<cgsize_t>(ids[Perm[k]]) + shift;
+    }
+  }
+}
+
+// Copies count elements of VTK type vtkType with n nodes each (n is the node count of the
+// type, or of the one cell when count is 1) to dst in CGNS order, adding shift to every id.
+template <typename IdT>
+void CopyElements(const unsigned char vtkType, const IdT* ids, const int64_t count, const int64_t n,
+                  const cgsize_t shift, cgsize_t* dst)
+{
+  switch (vtkType)
+  {
+    case kVtkQuadraticWedge:
+      CopyPermuted<kPenta15>(ids, count, shift, dst);
+      return;
+    case kVtkBiquadraticQuadraticWedge:
+      CopyPermuted<kPenta18>(ids, count, shift, dst);
+      return;
+    case kVtkQuadraticHexahedron:
+      CopyPermuted<kHexa20>(ids, count, shift, dst);
+      return;
+    case kVtkTriquadraticHexahedron:
+      CopyPermuted<kHexa27>(ids, count, shift, dst);
+      return;
+    default:
+      for (int64_t i = 0; i < count * n; ++i)
+      {
+        dst[i] = static_cast<cgsize_t>(ids[i]) + shift;
+      }
+  }
+}
+} // namespace node_order
+} // namespace cgns_writer
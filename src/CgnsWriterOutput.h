@@ -0,0 +1,91 @@
+#pragma once
+
+// File data types and the section write used by both writers: real precision, rounding to
+// single precision, and sections with offsets (MIXED, NGON_n, NFACE_n). Header-only so that
+// both cgns_writer and cgns_writer_dll can use it; not part of either library's public API.
+
+#include "CgnsWriterPolyhedra.h"
+
+#include <cgnslib.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// cg_poly_section_write (MIXED/NGON_n/NFACE_n with an ElementStartOffset array) is available from CGNS 4.0;
+// older versions store the element types (MIXED) or sizes (NGON_n/NFACE_n) inline and take the connectivity alone.
+#if defined(CGNS_VERSION) && CGNS_VERSION >= 4000
+#  define CGNS_WRITER_HAVE_POLY_SECTION 1
+#else
+#  define CGNS_WRITER_HAVE_POLY_SECTION 0
+#endif
+
+namespace cgns_writer
+{
+namespace output
+{
+// RealSingle or RealDouble.
+inline CGNS_ENUMT(DataType_t) RealType(const bool single)
+{
+  return single ? CGNS_ENUMV(RealSingle) : CGNS_ENUMV(RealDouble);
+}
+
+// Bytes per value of a file data type, for the write statistics.
+inline int64_t DataTypeSize(const CGNS_ENUMT(DataType_t) type)
+{
+  return (type == CGNS_ENUMV(RealSingle) || type == CGNS_ENUMV(Integer)) ? 4 : 8;
+}
+
+// Rounds count doubles, read with the given stride, to float (round-to-nearest).
+// When maxLoss is non-null it is raised to the largest |src - dst| seen.
+inline void RoundToSingle(const double* src, const size_t stride, const size_t count, float* dst, double* maxLoss)
+{
+  // Branch-free loops with independent iterations so the compiler can vectorize both variants.
+  if (!maxLoss)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      dst[i] = static_cast<float>(src[i * stride]);
+    }
+    return;
+  }
+
+  double loss = *maxLoss;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const double v = src[i * stride];
+    const float f = static_cast<float>(v);
+    dst[i] = f;
+    const double err = std::fabs(v - static_cast<double>(f));
+    loss = err > loss ? err : loss;
+  }
+  *maxLoss = loss;
+}
+
+// The libcgns call WritePolySection makes, for timers and error messages.
+constexpr const char* kPolySectionCall =
+  CGNS_WRITER_HAVE_POLY_SECTION ? "cg_poly_section_write" : "cg_section_write";
+
+// Writes a section that has offsets (any struct with name, type, start, end and cgsize_t vectors
+// conn and offsets) with cg_poly_section_write, or with cg_section_write and inline element
+// types (MIXED) or sizes before CGNS 4.0. hold() returns the object that times, and if need be
+// serializes, the libcgns call; it is created after any conversion. Returns the libcgns error code.
+template <typename SectionT, typename Hold>
+int WritePolySection(const int fn, const int B, const int Z, const SectionT& s, int* S, const Hold& hold)
+{
+#if CGNS_WRITER_HAVE_POLY_SECTION
+  const auto held = hold();
+  return cg_poly_section_write(fn, B, Z, s.name.c_str(), s.type, s.start, s.end, 0, s.conn.data(), s.offsets.data(),
+                               S);
+#else
+  // MIXED connectivity already holds its element types inline; NGON_n/NFACE_n need their sizes.
+  const std::vector<cgsize_t> sized =
+    s.type == CGNS_ENUMV(MIXED) ? std::vector<cgsize_t>() : polyhedra::InlineSizes(s.conn, s.offsets);
+  const auto held = hold();
+  return cg_section_write(fn, B, Z, s.name.c_str(), s.type, s.start, s.end, 0,
+                          sized.empty() ? s.conn.data() : sized.data(), S);
+#endif
+}
+} // namespace output
+} // namespace cgns_writer
@@ -0,0 +1,247 @@
+#pragma once
+
+// Per-thread phase timers behind cgns_writer_get_last_stats, the stats
+// out-parameter of CgnsWriter::Write and the benchmarks. Header-only so that
+// both cgns_writer and cgns_writer_dll can record into it; not part of either
+// library's public API. Each binary that compiles it has its own copy of the
+// thread-local state, so a reader must be linked into the same binary as the
+// writer code it times (cgns_writer_bench compiles the core sources in).
+// When tracing is compiled in (CgnsWriterTrace.h), every Scope is also a trace span.
+
+#include "CgnsWriterTrace.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cgns_writer
+{
+namespace phase
+{
+struct Timing
+{
+  const char* name = nullptr; // string literal passed to Scope
+  double seconds = 0.0;
+  int64_t calls = 0;
+  int64_t bytes = 0; // data handed to libcgns inside the phase
+};
+
+struct SectionTiming
+{
+  std::string zone;
+  std::string name;
+  int type = 0; // CGNS ElementType_t
+  int64_t elements = 0;
+  int64_t bytes = 0;
+  int64_t bytesSaved = 0; // by writing the connectivity as 32-bit integers
+  double seconds = 0.0;
+};
+
+// Everything recorded on a thread since recording was enabled.
+struct Record
+{
+  std::vector<Timing> timings;
+  std::vector<SectionTiming> sections;
+  int zones = 0;
+  int64_t points = 0;
+  int64_t elements = 0;
+};
+
+struct ThreadState
+{
+  bool enabled = false;
+  Record record;
+};
+
+inline ThreadState& State()
+{
+  thread_local ThreadState state;
+  return state;
+}
+
+// Starts or stops recording on the calling thread and clears what was recorded.
+// Recording is off by default, which makes a Scope cost a single branch.
+inline void Enable(const bool on)
+{
+  State().enabled = on;
+  State().record = Record();
+}
+
+// Returns the calling thread's timings in first-seen order and clears them.
+inline std::vector<Timing> Take()
+{
+  std::vector<Timing> out;
+  out.swap(State().record.timings);
+  return out;
+}
+
+inline void Add(const char* name, const double seconds, const int64_t calls, const int64_t bytes)
+{
+  std::vector<Timing>& timings = State().record.timings;
+  for (Timing& t : timings)
+  {
+    if (t.name == name || std::strcmp(t.name, name) == 0)
+    {
+      t.seconds += seconds;
+      t.calls += calls;
+      t.bytes += bytes;
+      return;
+    }
+  }
+  timings.push_back(Timing{ name, seconds, calls, bytes });
+}
+
+// Adds what another thread recorded (e.g. a zone prepared in the background)
+// to the calling thread's record. Its phases overlap the caller's in time.
+inline void Merge(const Record& from)
+{
+  if (!State().enabled)
+  {
+    return;
+  }
+  for (const Timing& t : from.timings)
+  {
+    Add(t.name, t.seconds, t.calls, t.bytes);
+  }
+  Record& to = State().record;
+  to.sections.insert(to.sections.end(), from.sections.begin(), from.sections.end());
+  to.zones += from.zones;
+  to.points += from.points;
+  to.elements += from.elements;
+}
+
+// Counts a written zone with its point and element counts.
+inline void AddZone(const int64_t points, const int64_t elements)
+{
+  if (State().enabled)
+  {
+    Record& r = State().record;
+    ++r.zones;
+    r.points += points;
+    r.elements += elements;
+  }
+}
+
+// Adds its lifetime to the phase `name` when recording is enabled on this thread,
+// together with `bytes` of data written inside it. Scopes nest; a phase includes
+// the time of the phases nested inside it.
+class Scope
+{
+public:
+  explicit Scope(const char* name, const int64_t bytes = 0)
+    : Name(State().enabled ? name : nullptr)
+    , Bytes(bytes)
+#if CGNS_WRITER_ENABLE_TRACE
+    , Trace(name)
+#endif
+  {
+    if (Name)
+    {
+      Start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~Scope()
+  {
+    if (Name)
+    {
+      Add(Name, std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count(), 1, Bytes);
+    }
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  const char* Name;
+  int64_t Bytes;
+  std::chrono::steady_clock::time_point Start;
+#if CGNS_WRITER_ENABLE_TRACE
+  trace::Span Trace;
+#endif
+};
+
+// Records one element section of `zone` and the time until the scope ends.
+class SectionScope
+{
+public:
+  SectionScope(const std::string& zone, const std::string& name, const int type, const int64_t elements,
+               const int64_t bytes, const int64_t bytesSaved = 0)
+    : Enabled(State().enabled)
+  {
+    if (Enabled)
+    {
+      Section.zone = zone;
+      Section.name = name;
+      Section.type = type;
+      Section.elements = elements;
+      Section.bytes = bytes;
+      Section.bytesSaved = bytesSaved;
+      Start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~SectionScope()
+  {
+    if (Enabled)
+    {
+      Section.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+      State().record.sections.push_back(std::move(Section));
+    }
+  }
+
+  SectionScope(const SectionScope&) = delete;
+  SectionScope& operator=(const SectionScope&) = delete;
+
+private:
+  bool Enabled;
+  SectionTiming Section;
+  std::chrono::steady_clock::time_point Start;
+};
+
+// Records into an empty Record for its lifetime, whether or not recording was
+// enabled on the thread before. Finish (or the destructor) restores the outer
+// recording and merges the captured data into it, so a caller timing a write
+// still sees the phases of the write.
+class Capture
+{
+public:
+  Capture()
+    : OuterEnabled(State().enabled)
+  {
+    Outer = std::move(State().record);
+    State().record = Record();
+    State().enabled = true;
+  }
+
+  ~Capture() { Finish(); }
+
+  // Returns what was recorded since construction; later calls return an empty Record.
+  Record Finish()
+  {
+    Record captured;
+    if (Done)
+    {
+      return captured;
+    }
+    Done = true;
+    captured = std::move(State().record);
+    State().record = std::move(Outer);
+    State().enabled = OuterEnabled;
+    Merge(captured);
+    return captured;
+  }
+
+  Capture(const Capture&) = delete;
+  Capture& operator=(const Capture&) = delete;
+
+private:
+  bool OuterEnabled;
+  bool Done = false;
+  Record Outer;
+};
+} // namespace phase
+} // namespace cgns_writer
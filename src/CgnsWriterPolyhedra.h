@@ -0,0 +1,445 @@
+#pragma once
+
+// NGON_n/NFACE_n sections of polyhedral zones: every face of every cell goes through a
+// concurrent open-addressing hash table keyed by its canonical node list, so a face shared
+// by two cells is stored once in NGON_n and referenced by both cells in NFACE_n.
+// Header-only so that both cgns_writer and cgns_writer_dll can use it; not part of either
+// library's public API.
+
+#include <cgnslib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace cgns_writer
+{
+namespace polyhedra
+{
+constexpr unsigned char kVtkPolygon = 7;
+constexpr unsigned char kVtkTetra = 10;
+constexpr unsigned char kVtkHexahedron = 12;
+constexpr unsigned char kVtkWedge = 13;
+constexpr unsigned char kVtkPyramid = 14;
+constexpr unsigned char kVtkPolyhedron = 42;
+
+// Faces of a linear 3D VTK cell in its local node numbering, in VTK's order and with
+// VTK's orientation (normals pointing out of the cell by the right-hand rule).
+struct LinearFaces
+{
+  int numFaces;
+  int sizes[6];
+  int nodes[6][4];
+};
+
+// Null for types that are not linear 3D cells.
+inline const LinearFaces* FacesOfLinearCell(const unsigned char vtkType)
+{
+  static const LinearFaces tetra = { 4, { 3, 3, 3, 3 }, { { 0, 1, 3 }, { 1, 2, 3 }, { 2, 0, 3 }, { 0, 2, 1 } } };
+  static const LinearFaces pyramid = {
+    5, { 4, 3, 3, 3, 3 }, { { 0, 3, 2, 1 }, { 0, 1, 4 }, { 1, 2, 4 }, { 2, 3, 4 }, { 3, 0, 4 } }
+  };
+  static const LinearFaces wedge = {
+    5, { 3, 3, 4, 4, 4 }, { { 0, 1, 2 }, { 3, 5, 4 }, { 0, 3, 4, 1 }, { 1, 4, 5, 2 }, { 2, 5, 3, 0 } }
+  };
+  static const LinearFaces hexahedron = { 6,
+                                          { 4, 4, 4, 4, 4, 4 },
+                                          { { 0, 4, 7, 3 },
+                                            { 1, 2, 6, 5 },
+                                            { 0, 1, 5, 4 },
+                                            { 3, 7, 6, 2 },
+                                            { 0, 3, 2, 1 },
+                                            { 4, 5, 6, 7 } } };
+  switch (vtkType)
+  {
+    case kVtkTetra:
+      return &tetra;
+    case kVtkPyramid:
+      return &pyramid;
+    case kVtkWedge:
+      return &wedge;
+    case kVtkHexahedron:
+      return &hexahedron;
+    default:
+      return nullptr;
+  }
+}
+
+// The two sections of a polyhedral zone. Faces are elements 1..NumFaces() and cells the
+// elements after them, in input cell order. NFACE_n lists the faces of each cell as signed
+// element numbers: positive when the stored face points out of the cell, negative when the
+// cell sees it reversed.
+struct Sections
+{
+  std::vector<cgsize_t> faceConn;    // NGON_n: 1-based node ids
+  std::vector<cgsize_t> faceOffsets; // NGON_n: start of each face in faceConn, then faceConn.size()
+  std::vector<cgsize_t> cellConn;    // NFACE_n: signed face element numbers
+  std::vector<cgsize_t> cellOffsets; // NFACE_n: start of each cell in cellConn, then cellConn.size()
+
+  int64_t NumFaces() const { return faceOffsets.empty() ? 0 : static_cast<int64_t>(faceOffsets.size()) - 1; }
+  int64_t NumCells() const { return cellOffsets.empty() ? 0 : static_cast<int64_t>(cellOffsets.size()) - 1; }
+};
+
+// Runs fn(block) for every block in [0, numBlocks), possibly concurrently.
+using ParallelFor = std::function<void(size_t, const std::function<void(size_t)>&)>;
+
+namespace detail
+{
+// Reads the faces of cells stored like vtkCellArray: cell c is types[c] with the entries
+// conn[offsets[c]] .. conn[offsets[c + 1] - 1]. A polyhedron holds the VTK face stream
+// [numFaces, n0, ids of face 0..., n1, ids of face 1..., ...]; other cells hold their nodes.
+template <typename IdT>
+class CellFaceReader
+{
+public:
+  CellFaceReader(const IdT* offsets, const IdT* conn, const unsigned char* types)
+    : Offsets(offsets)
+    , Conn(conn)
+    , Types(types)
+  {
+  }
+
+  int64_t NumFaces(const int64_t c) const
+  {
+    if (Types[c] == kVtkPolyhedron)
+    {
+      return static_cast<int64_t>(Conn[Offsets[c]]);
+    }
+    const LinearFaces* faces = FacesOfLinearCell(Types[c]);
+    return faces ? faces->numFaces : 0;
+  }
+
+  // Calls fn(k, nodes, n) for the faces of cell c in order; nodes is only valid during the call.
+  template <typename Fn>
+  void ForEachFace(const int64_t c, std::vector<int64_t>& scratch, Fn&& fn) const
+  {
+    const IdT* cell = Conn + Offsets[c];
+    if (Types[c] == kVtkPolyhedron)
+    {
+      const int64_t numFaces = static_cast<int64_t>(cell[0]);
+      const IdT* face = cell + 1;
+      for (int64_t k = 0; k < numFaces; ++k)
+      {
+        const int64_t n = static_cast<int64_t>(face[0]);
+        scratch.assign(face + 1, face + 1 + n);
+        fn(k, scratch.data(), n);
+        face += 1 + n;
+      }
+      return;
+    }
+    const LinearFaces* faces = FacesOfLinearCell(Types[c]);
+    for (int k = 0; faces && k < faces->numFaces; ++k)
+    {
+      scratch.resize(static_cast<size_t>(faces->sizes[k]));
+      for (int j = 0; j < faces->sizes[k]; ++j)
+      {
+        scratch[static_cast<size_t>(j)] = static_cast<int64_t>(cell[faces->nodes[k][j]]);
+      }
+      fn(static_cast<int64_t>(k), scratch.data(), static_cast<int64_t>(faces->sizes[k]));
+    }
+  }
+
+  // Node ids of face k of cell c.
+  void Face(const int64_t c, const int64_t k, std::vector<int64_t>& nodes) const
+  {
+    const IdT* cell = Conn + Offsets[c];
+    if (Types[c] == kVtkPolyhedron)
+    {
+      const IdT* face = cell + 1;
+      for (int64_t i = 0; i < k; ++i)
+      {
+        face += 1 + static_cast<int64_t>(face[0]);
+      }
+      nodes.assign(face + 1, face + 1 + static_cast<int64_t>(face[0]));
+      return;
+    }
+    const LinearFaces* faces = FacesOfLinearCell(Types[c]);
+    nodes.resize(static_cast<size_t>(faces->sizes[k]));
+    for (int j = 0; j < faces->sizes[k]; ++j)
+    {
+      nodes[static_cast<size_t>(j)] = static_cast<int64_t>(cell[faces->nodes[k][j]]);
+    }
+  }
+
+private:
+  const IdT* Offsets;
+  const IdT* Conn;
+  const unsigned char* Types;
+};
+
+// Writes the canonical form of a face to canon[0, n) and returns its hash: the cycle starts
+// at the smallest node and runs towards its smaller neighbour, so a face and the same face
+// seen from the other cell (reversed) have equal forms. reversed tells which one it was.
+inline uint64_t Canonicalize(const int64_t* nodes, const int64_t n, int64_t* canon, bool& reversed)
+{
+  int64_t m = 0;
+  for (int64_t i = 1; i < n; ++i)
+  {
+    m = nodes[i] < nodes[m] ? i : m;
+  }
+  const int64_t prev = m == 0 ? n - 1 : m - 1;
+  const int64_t next = m + 1 == n ? 0 : m + 1;
+  reversed = nodes[prev] < nodes[next];
+  uint64_t h = static_cast<uint64_t>(n) * 0x9E3779B97F4A7C15ull;
+  int64_t at = m;
+  for (int64_t i = 0; i < n; ++i)
+  {
+    const int64_t v = nodes[at];
+    canon[i] = v;
+    h = (h ^ static_cast<uint64_t>(v)) * 0xFF51AFD7ED558CCDull;
+    h ^= h >> 32;
+    at = reversed ? (at == 0 ? n - 1 : at - 1) : (at + 1 == n ? 0 : at + 1);
+  }
+  return h;
+}
+} // namespace detail
+
+// Builds the NGON_n and NFACE_n sections of numCells 3D cells stored as described for
+// detail::CellFaceReader (linear VTK_TETRA/PYRAMID/WEDGE/HEXAHEDRON cells and VTK_POLYHEDRON
+// face streams, already validated). The cells are split into numBlocks contiguous blocks
+// that run through parallelFor.
+//
+// Face instances (a face as seen by one cell) are numbered cell by cell and inserted
+// concurrently into a table of 64-bit slots, each holding an instance and 24 bits of its
+// hash so that most probes are decided without looking at the instance's nodes. A slot
+// keeps the smallest instance of its face, so the stored face is where it first appears
+// in cell order and the output does not depend on thread timing. Faces are numbered in
+// that order too.
+template <typename IdT>
+void Build(const IdT* offsets, const IdT* conn, const unsigned char* types, const int64_t numCells,
+           const size_t numBlocks, const ParallelFor& parallelFor, Sections& out)
+{
+  const detail::CellFaceReader<IdT> reader(offsets, conn, types);
+  std::vector<int64_t> blockFirst(numBlocks + 1);
+  for (size_t b = 0; b <= numBlocks; ++b)
+  {
+    blockFirst[b] = numCells * static_cast<int64_t>(b) / static_cast<int64_t>(numBlocks);
+  }
+
+  // Face instances of cell c are [cellOffsets[c], cellOffsets[c + 1]).
+  out.cellOffsets.assign(static_cast<size_t>(numCells) + 1, 0);
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t c = blockFirst[b]; c < blockFirst[b + 1]; ++c)
+    {
+      out.cellOffsets[static_cast<size_t>(c) + 1] = static_cast<cgsize_t>(reader.NumFaces(c));
+    }
+  });
+  for (size_t c = 0; c < static_cast<size_t>(numCells); ++c)
+  {
+    out.cellOffsets[c + 1] += out.cellOffsets[c];
+  }
+  const int64_t numInstances = static_cast<int64_t>(out.cellOffsets.back());
+
+  constexpr int kInstanceBits = 40;
+  constexpr uint64_t kInstanceMask = (uint64_t(1) << kInstanceBits) - 1;
+  constexpr uint64_t kEmpty = ~uint64_t(0);
+  if (static_cast<uint64_t>(numInstances) >= kInstanceMask)
+  {
+    throw std::runtime_error("Too many cell faces for the polyhedral face table");
+  }
+
+  // Load factor at most 1/2 keeps probe sequences short.
+  size_t capacity = 1;
+  while (capacity < 2 * static_cast<size_t>(numInstances))
+  {
+    capacity <<= 1;
+  }
+  const size_t mask = capacity - 1;
+  std::unique_ptr<std::atomic<uint64_t>[]> table(new std::atomic<uint64_t>[capacity]);
+  parallelFor(numBlocks, [&](const size_t b) {
+    const size_t lo = capacity * b / numBlocks;
+    const size_t hi = capacity * (b + 1) / numBlocks;
+    for (size_t s = lo; s < hi; ++s)
+    {
+      table[s].store(kEmpty, std::memory_order_relaxed);
+    }
+  });
+
+  // cellOf[i] is the cell of instance i, for comparing it with later instances; slotOf[i]
+  // is the slot of its face.
+  std::vector<int64_t> cellOf(static_cast<size_t>(numInstances));
+  std::vector<unsigned char> reversed(static_cast<size_t>(numInstances));
+  std::vector<int64_t> slotOf(static_cast<size_t>(numInstances));
+  parallelFor(numBlocks, [&](const size_t b) {
+    // Instances are inserted in batches. The slots of a batch are read before any of them
+    // is inserted, so that their cache misses overlap instead of waiting one by one behind
+    // the compare-exchanges.
+    constexpr size_t kBatch = 256;
+    struct Pending
+    {
+      int64_t instance;
+      uint64_t hash;
+      size_t canonAt; // in canon
+      int64_t size;
+    };
+    std::vector<Pending> batch;
+    std::vector<int64_t> canon;
+    std::vector<int64_t> scratch;
+    std::vector<int64_t> other;
+    std::vector<int64_t> otherCanon;
+
+    // True when instance j has the canonical form p.
+    auto sameFace = [&](const int64_t j, const Pending& p) {
+      const int64_t cell = cellOf[static_cast<size_t>(j)];
+      reader.Face(cell, j - static_cast<int64_t>(out.cellOffsets[static_cast<size_t>(cell)]), other);
+      if (static_cast<int64_t>(other.size()) != p.size)
+      {
+        return false;
+      }
+      bool unused = false;
+      otherCanon.resize(other.size());
+      detail::Canonicalize(other.data(), p.size, otherCanon.data(), unused);
+      return std::equal(otherCanon.begin(), otherCanon.end(), canon.begin() + static_cast<std::ptrdiff_t>(p.canonAt));
+    };
+
+    auto insert = [&](const Pending& p) {
+      const uint64_t tag = p.hash & ~kInstanceMask;
+      const uint64_t entry = tag | static_cast<uint64_t>(p.instance);
+      size_t slot = static_cast<size_t>(p.hash) & mask;
+      uint64_t cur = table[slot].load(std::memory_order_acquire);
+      for (;;)
+      {
+        if (cur == kEmpty)
+        {
+          if (table[slot].compare_exchange_weak(cur, entry, std::memory_order_acq_rel, std::memory_order_acquire))
+          {
+            break;
+          }
+          continue;
+        }
+        if ((cur & ~kInstanceMask) == tag && sameFace(static_cast<int64_t>(cur & kInstanceMask), p))
+        {
+          // A filled slot only ever changes to a smaller instance of the same face.
+          while (entry < cur &&
+                 !table[slot].compare_exchange_weak(cur, entry, std::memory_order_acq_rel, std::memory_order_acquire))
+          {
+          }
+          break;
+        }
+        slot = (slot + 1) & mask;
+        cur = table[slot].load(std::memory_order_acquire);
+      }
+      slotOf[static_cast<size_t>(p.instance)] = static_cast<int64_t>(slot);
+    };
+
+    auto flush = [&] {
+      for (const Pending& p : batch)
+      {
+        (void)table[static_cast<size_t>(p.hash) & mask].load(std::memory_order_relaxed);
+      }
+      for (const Pending& p : batch)
+      {
+        insert(p);
+      }
+      batch.clear();
+      canon.clear();
+    };
+
+    for (int64_t c = blockFirst[b]; c < blockFirst[b + 1]; ++c)
+    {
+      reader.ForEachFace(c, scratch, [&](const int64_t k, const int64_t* nodes, const int64_t n) {
+        const int64_t i = static_cast<int64_t>(out.cellOffsets[static_cast<size_t>(c)]) + k;
+        const size_t at = canon.size();
+        canon.resize(at + static_cast<size_t>(n));
+        bool rev = false;
+        const uint64_t h = detail::Canonicalize(nodes, n, canon.data() + at, rev);
+        cellOf[static_cast<size_t>(i)] = c;
+        reversed[static_cast<size_t>(i)] = rev ? 1 : 0;
+        batch.push_back(Pending{ i, h, at, n });
+      });
+      if (batch.size() >= kBatch)
+      {
+        flush();
+      }
+    }
+    flush();
+  });
+
+  // slotOf becomes the face's first instance; the first instances are the faces, counted per block.
+  std::vector<int64_t> blockFaces(numBlocks + 1, 0);
+  std::vector<int64_t> blockFaceNodes(numBlocks + 1, 0);
+  parallelFor(numBlocks, [&](const size_t b) {
+    std::vector<int64_t> scratch;
+    for (int64_t c = blockFirst[b]; c < blockFirst[b + 1]; ++c)
+    {
+      reader.ForEachFace(c, scratch, [&](const int64_t k, const int64_t*, const int64_t n) {
+        const size_t i = static_cast<size_t>(out.cellOffsets[static_cast<size_t>(c)] + k);
+        slotOf[i] = static_cast<int64_t>(table[static_cast<size_t>(slotOf[i])].load(std::memory_order_relaxed) &
+                                         kInstanceMask);
+        if (slotOf[i] == static_cast<int64_t>(i))
+        {
+          ++blockFaces[b + 1];
+          blockFaceNodes[b + 1] += n;
+        }
+      });
+    }
+  });
+  table.reset();
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    blockFaces[b + 1] += blockFaces[b];
+    blockFaceNodes[b + 1] += blockFaceNodes[b];
+  }
+
+  // NGON_n in first-appearance order, each face as its first cell lists it. cellOf is
+  // reused to hold the 0-based face number of each first instance.
+  out.faceConn.resize(static_cast<size_t>(blockFaceNodes[numBlocks]));
+  out.faceOffsets.resize(static_cast<size_t>(blockFaces[numBlocks]) + 1);
+  out.faceOffsets.back() = static_cast<cgsize_t>(out.faceConn.size());
+  parallelFor(numBlocks, [&](const size_t b) {
+    std::vector<int64_t> scratch;
+    int64_t face = blockFaces[b];
+    int64_t at = blockFaceNodes[b];
+    for (int64_t c = blockFirst[b]; c < blockFirst[b + 1]; ++c)
+    {
+      reader.ForEachFace(c, scratch, [&](const int64_t k, const int64_t* nodes, const int64_t n) {
+        const size_t i = static_cast<size_t>(out.cellOffsets[static_cast<size_t>(c)] + k);
+        if (slotOf[i] != static_cast<int64_t>(i))
+        {
+          return;
+        }
+        cellOf[i] = face;
+        out.faceOffsets[static_cast<size_t>(face++)] = static_cast<cgsize_t>(at);
+        for (int64_t j = 0; j < n; ++j)
+        {
+          out.faceConn[static_cast<size_t>(at++)] = static_cast<cgsize_t>(nodes[j]) + 1;
+        }
+      });
+    }
+  });
+
+  // NFACE_n: the cell's faces in its own order, negated where its orientation differs
+  // from the stored one.
+  out.cellConn.resize(static_cast<size_t>(numInstances));
+  parallelFor(numBlocks, [&](const size_t b) {
+    const size_t lo = static_cast<size_t>(out.cellOffsets[static_cast<size_t>(blockFirst[b])]);
+    const size_t hi = static_cast<size_t>(out.cellOffsets[static_cast<size_t>(blockFirst[b + 1])]);
+    for (size_t i = lo; i < hi; ++i)
+    {
+      const size_t first = static_cast<size_t>(slotOf[i]);
+      const cgsize_t elem = static_cast<cgsize_t>(cellOf[first]) + 1;
+      out.cellConn[i] = reversed[i] == reversed[first] ? elem : -elem;
+    }
+  });
+}
+
+// The layout of NGON_n/NFACE_n before CGNS 4.0, which has no offsets array: every element
+// is its entry count followed by its entries.
+inline std::vector<cgsize_t> InlineSizes(const std::vector<cgsize_t>& conn, const std::vector<cgsize_t>& offsets)
+{
+  std::vector<cgsize_t> out;
+  out.reserve(conn.size() + offsets.size());
+  for (size_t e = 0; e + 1 < offsets.size(); ++e)
+  {
+    out.push_back(offsets[e + 1] - offsets[e]);
+    out.insert(out.end(), conn.begin() + offsets[e], conn.begin() + offsets[e + 1]);
+  }
+  return out;
+}
+} // namespace polyhedra
+} // namespace cgns_writer
@@ -0,0 +1,463 @@
+#pragma once
+
+// Locality orders for the points and cells of an unstructured zone, so that readers of the
+// file touch nearby memory and HDF5 chunks for nearby parts of the mesh: a Hilbert curve
+// through the point coordinates and cell centroids, or reverse Cuthill-McKee on the graph of
+// points that share a cell. Header-only so that both cgns_writer and cgns_writer_dll can use
+// it; not part of either library's public API.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace cgns_writer
+{
+namespace reorder
+{
+constexpr unsigned char kVtkPolyhedron = 42;
+
+// Runs fn(block) for every block in [0, numBlocks), possibly concurrently.
+using ParallelFor = std::function<void(size_t, const std::function<void(size_t)>&)>;
+
+// Cells stored like vtkCellArray: cell c holds the entries conn[offsets[c]] .. conn[offsets[c + 1] - 1].
+// With types, a VTK_POLYHEDRON cell holds its face stream [numFaces, n0, ids..., n1, ids..., ...]
+// and its points are visited once per face; without, every entry is a point id.
+template <typename IdT>
+struct Cells
+{
+  const IdT* offsets = nullptr;
+  const IdT* conn = nullptr;
+  const unsigned char* types = nullptr;
+  int64_t count = 0;
+
+  template <typename Fn>
+  void ForEachPoint(const int64_t c, Fn&& fn) const
+  {
+    const IdT* at = conn + offsets[c];
+    const IdT* const end = conn + offsets[c + 1];
+    if (types && types[c] == kVtkPolyhedron && at < end)
+    {
+      for (++at; at < end; at += 1 + static_cast<int64_t>(at[0]))
+      {
+        for (int64_t k = 1; k <= static_cast<int64_t>(at[0]); ++k)
+        {
+          fn(static_cast<int64_t>(at[k]));
+        }
+      }
+      return;
+    }
+    for (; at < end; ++at)
+    {
+      fn(static_cast<int64_t>(*at));
+    }
+  }
+};
+
+// New numbering of a zone: points[i] is the input point that becomes point i, cells[i] the
+// input cell that becomes cell i.
+struct Orders
+{
+  std::vector<int64_t> points;
+  std::vector<int64_t> cells;
+};
+
+namespace detail
+{
+// First item of block b when n items are split into numBlocks contiguous blocks.
+inline int64_t BlockBegin(const int64_t n, const size_t b, const size_t numBlocks)
+{
+  return n * static_cast<int64_t>(b) / static_cast<int64_t>(numBlocks);
+}
+
+// Bits per axis of a Hilbert key; three axes fill 63 bits.
+constexpr int kHilbertBits = 21;
+constexpr uint32_t kHilbertMax = (uint32_t(1) << kHilbertBits) - 1;
+
+// Position of the cell (x, y, z) of a 2^21 grid along the 3D Hilbert curve, with Skilling's
+// transform ("Programming the Hilbert curve", 2004) followed by bit interleaving.
+inline uint64_t HilbertKey(const uint32_t x, const uint32_t y, const uint32_t z)
+{
+  uint32_t v[3] = { x, y, z };
+  constexpr uint32_t top = uint32_t(1) << (kHilbertBits - 1);
+  for (uint32_t q = top; q > 1; q >>= 1)
+  {
+    const uint32_t p = q - 1;
+    for (int i = 0; i < 3; ++i)
+    {
+      if (v[i] & q)
+      {
+        v[0] ^= p;
+      }
+      else
+      {
+        const uint32_t t = (v[0] ^ v[i]) & p;
+        v[0] ^= t;
+        v[i] ^= t;
+      }
+    }
+  }
+  v[1] ^= v[0];
+  v[2] ^= v[1];
+  uint32_t t = 0;
+  for (uint32_t q = top; q > 1; q >>= 1)
+  {
+    if (v[2] & q)
+    {
+      t ^= q - 1;
+    }
+  }
+  uint64_t key = 0;
+  for (int b = kHilbertBits - 1; b >= 0; --b)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      key = (key << 1) | (((v[i] ^ t) >> b) & 1u);
+    }
+  }
+  return key;
+}
+
+// Indices [0, keys.size()) sorted by key, ties in index order, so the result does not depend
+// on numBlocks. The blocks are sorted concurrently, then merged pairwise, each round in parallel.
+inline std::vector<int64_t> SortByKey(const std::vector<uint64_t>& keys, const size_t numBlocks,
+                                      const ParallelFor& parallelFor)
+{
+  struct Entry
+  {
+    uint64_t key;
+    int64_t index;
+  };
+  const auto less = [](const Entry& a, const Entry& b) {
+    return a.key < b.key || (a.key == b.key && a.index < b.index);
+  };
+  const int64_t n = static_cast<int64_t>(keys.size());
+  std::vector<Entry> runs(keys.size());
+  std::vector<Entry> merged(keys.size());
+  std::vector<int64_t> bounds(numBlocks + 1);
+  for (size_t b = 0; b <= numBlocks; ++b)
+  {
+    bounds[b] = BlockBegin(n, b, numBlocks);
+  }
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t i = bounds[b]; i < bounds[b + 1]; ++i)
+    {
+      runs[static_cast<size_t>(i)] = Entry{ keys[static_cast<size_t>(i)], i };
+    }
+    std::sort(runs.begin() + bounds[b], runs.begin() + bounds[b + 1], less);
+  });
+  while (bounds.size() > 2)
+  {
+    const size_t numRuns = bounds.size() - 1;
+    parallelFor((numRuns + 1) / 2, [&](const size_t p) {
+      const auto first = static_cast<ptrdiff_t>(bounds[2 * p]);
+      const auto middle = static_cast<ptrdiff_t>(bounds[std::min(2 * p + 1, numRuns)]);
+      const auto last = static_cast<ptrdiff_t>(bounds[std::min(2 * p + 2, numRuns)]);
+      std::merge(runs.begin() + first, runs.begin() + middle, runs.begin() + middle, runs.begin() + last,
+                 merged.begin() + first, less);
+    });
+    runs.swap(merged);
+    std::vector<int64_t> next;
+    for (size_t r = 0; r < numRuns; r += 2)
+    {
+      next.push_back(bounds[r]);
+    }
+    next.push_back(n);
+    bounds.swap(next);
+  }
+  std::vector<int64_t> order(keys.size());
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t i = BlockBegin(n, b, numBlocks); i < BlockBegin(n, b + 1, numBlocks); ++i)
+    {
+      order[static_cast<size_t>(i)] = runs[static_cast<size_t>(i)].index;
+    }
+  });
+  return order;
+}
+
+// The order of cells by the smallest new number of their points; cells without points go last.
+template <typename IdT>
+std::vector<int64_t> CellsByFirstPoint(const Cells<IdT>& cells, const std::vector<int64_t>& rank,
+                                       const size_t numBlocks, const ParallelFor& parallelFor)
+{
+  std::vector<uint64_t> keys(static_cast<size_t>(cells.count));
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t c = BlockBegin(cells.count, b, numBlocks); c < BlockBegin(cells.count, b + 1, numBlocks); ++c)
+    {
+      uint64_t key = std::numeric_limits<uint64_t>::max();
+      cells.ForEachPoint(c, [&](const int64_t id) {
+        key = std::min(key, static_cast<uint64_t>(rank[static_cast<size_t>(id)]));
+      });
+      keys[static_cast<size_t>(c)] = key;
+    }
+  });
+  return SortByKey(keys, numBlocks, parallelFor);
+}
+} // namespace detail
+
+// rank[order[i]] = i.
+inline std::vector<int64_t> Inverse(const std::vector<int64_t>& order, const size_t numBlocks,
+                                    const ParallelFor& parallelFor)
+{
+  const int64_t n = static_cast<int64_t>(order.size());
+  std::vector<int64_t> rank(order.size());
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t i = detail::BlockBegin(n, b, numBlocks); i < detail::BlockBegin(n, b + 1, numBlocks); ++i)
+    {
+      rank[static_cast<size_t>(order[static_cast<size_t>(i)])] = i;
+    }
+  });
+  return rank;
+}
+
+// Orders points and cells along a Hilbert curve through the bounding box of the points:
+// points by their coordinates, cells by the mean of their points. Point p is at
+// (xyz[0][p * stride], xyz[1][p * stride], xyz[2][p * stride]); non-finite coordinates count
+// as the low corner of the box. Keys are computed and sorted in numBlocks parallel blocks.
+template <typename IdT>
+Orders Hilbert(const double* const xyz[3], const int64_t stride, const int64_t numPoints, const Cells<IdT>& cells,
+               const size_t numBlocks, const ParallelFor& parallelFor)
+{
+  using detail::BlockBegin;
+  struct Box
+  {
+    double lo[3] = { HUGE_VAL, HUGE_VAL, HUGE_VAL };
+    double hi[3] = { -HUGE_VAL, -HUGE_VAL, -HUGE_VAL };
+  };
+  std::vector<Box> boxes(numBlocks);
+  parallelFor(numBlocks, [&](const size_t b) {
+    Box& box = boxes[b];
+    for (int64_t p = BlockBegin(numPoints, b, numBlocks); p < BlockBegin(numPoints, b + 1, numBlocks); ++p)
+    {
+      for (int d = 0; d < 3; ++d)
+      {
+        const double v = xyz[d][p * stride];
+        if (std::isfinite(v))
+        {
+          box.lo[d] = std::min(box.lo[d], v);
+          box.hi[d] = std::max(box.hi[d], v);
+        }
+      }
+    }
+  });
+  double lo[3] = { 0.0, 0.0, 0.0 };
+  double scale[3] = { 0.0, 0.0, 0.0 };
+  for (int d = 0; d < 3; ++d)
+  {
+    double blo = HUGE_VAL;
+    double bhi = -HUGE_VAL;
+    for (const Box& box : boxes)
+    {
+      blo = std::min(blo, box.lo[d]);
+      bhi = std::max(bhi, box.hi[d]);
+    }
+    const double extent = bhi - blo;
+    lo[d] = blo;
+    scale[d] = (extent > 0.0 && std::isfinite(extent)) ? detail::kHilbertMax / extent : 0.0;
+  }
+  // NaN fails both comparisons and lands on 0 like the low corner.
+  const auto key = [&](const double x, const double y, const double z) {
+    const double v[3] = { x, y, z };
+    uint32_t q[3];
+    for (int d = 0; d < 3; ++d)
+    {
+      const double t = (v[d] - lo[d]) * scale[d];
+      q[d] = t > 0.0 ? (t < detail::kHilbertMax ? static_cast<uint32_t>(t) : detail::kHilbertMax) : 0u;
+    }
+    return detail::HilbertKey(q[0], q[1], q[2]);
+  };
+
+  Orders out;
+  std::vector<uint64_t> keys(static_cast<size_t>(numPoints));
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t p = BlockBegin(numPoints, b, numBlocks); p < BlockBegin(numPoints, b + 1, numBlocks); ++p)
+    {
+      keys[static_cast<size_t>(p)] = key(xyz[0][p * stride], xyz[1][p * stride], xyz[2][p * stride]);
+    }
+  });
+  out.points = detail::SortByKey(keys, numBlocks, parallelFor);
+
+  keys.assign(static_cast<size_t>(cells.count), 0);
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t c = BlockBegin(cells.count, b, numBlocks); c < BlockBegin(cells.count, b + 1, numBlocks); ++c)
+    {
+      double sum[3] = { 0.0, 0.0, 0.0 };
+      int64_t n = 0;
+      cells.ForEachPoint(c, [&](const int64_t id) {
+        for (int d = 0; d < 3; ++d)
+        {
+          sum[d] += xyz[d][id * stride];
+        }
+        ++n;
+      });
+      const double inv = n > 0 ? 1.0 / static_cast<double>(n) : 0.0;
+      keys[static_cast<size_t>(c)] = n > 0 ? key(sum[0] * inv, sum[1] * inv, sum[2] * inv) : 0;
+    }
+  });
+  out.cells = detail::SortByKey(keys, numBlocks, parallelFor);
+  return out;
+}
+
+// Orders the points by reverse Cuthill-McKee on the graph in which two points are adjacent
+// when they share a cell, and the cells by the smallest new number of their points. Each
+// connected part starts from a pseudo-peripheral point: the lowest-degree point of the last
+// level of a breadth-first sweep from its lowest-degree point. The degree of a point is
+// taken as the number of cell entries naming it, which avoids building the point graph;
+// neighbours are reached through the cells around a point instead, every cell scanned once.
+// Points of no cell keep their relative order after all others. The cells around each point,
+// the degree sort and the cell order are computed in numBlocks parallel blocks; the sweeps
+// themselves are sequential.
+template <typename IdT>
+Orders ReverseCuthillMcKee(const int64_t numPoints, const Cells<IdT>& cells, const size_t numBlocks,
+                           const ParallelFor& parallelFor)
+{
+  using detail::BlockBegin;
+  const size_t np = static_cast<size_t>(numPoints);
+
+  // Cells around each point: around[first[p]] .. around[first[p + 1] - 1], in cell order.
+  std::unique_ptr<std::atomic<int64_t>[]> cursor(new std::atomic<int64_t>[np + 1]);
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t p = BlockBegin(numPoints + 1, b, numBlocks); p < BlockBegin(numPoints + 1, b + 1, numBlocks); ++p)
+    {
+      cursor[static_cast<size_t>(p)].store(0, std::memory_order_relaxed);
+    }
+  });
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t c = BlockBegin(cells.count, b, numBlocks); c < BlockBegin(cells.count, b + 1, numBlocks); ++c)
+    {
+      cells.ForEachPoint(c, [&](const int64_t id) {
+        cursor[static_cast<size_t>(id)].fetch_add(1, std::memory_order_relaxed);
+      });
+    }
+  });
+  std::vector<int64_t> first(np + 1, 0);
+  for (size_t p = 0; p < np; ++p)
+  {
+    first[p + 1] = first[p] + cursor[p].load(std::memory_order_relaxed);
+    cursor[p].store(first[p], std::memory_order_relaxed);
+  }
+  std::vector<int64_t> around(static_cast<size_t>(first[np]));
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t c = BlockBegin(cells.count, b, numBlocks); c < BlockBegin(cells.count, b + 1, numBlocks); ++c)
+    {
+      cells.ForEachPoint(c, [&](const int64_t id) {
+        around[static_cast<size_t>(cursor[static_cast<size_t>(id)].fetch_add(1, std::memory_order_relaxed))] = c;
+      });
+    }
+  });
+  cursor.reset();
+  parallelFor(numBlocks, [&](const size_t b) {
+    for (int64_t p = BlockBegin(numPoints, b, numBlocks); p < BlockBegin(numPoints, b + 1, numBlocks); ++p)
+    {
+      std::sort(around.begin() + first[static_cast<size_t>(p)], around.begin() + first[static_cast<size_t>(p) + 1]);
+    }
+  });
+  const auto degree = [&](const int64_t p) {
+    return first[static_cast<size_t>(p) + 1] - first[static_cast<size_t>(p)];
+  };
+
+  std::vector<uint64_t> keys(np);
+  for (size_t p = 0; p < np; ++p)
+  {
+    keys[p] = static_cast<uint64_t>(degree(static_cast<int64_t>(p)));
+  }
+  const std::vector<int64_t> byDegree = detail::SortByKey(keys, numBlocks, parallelFor);
+  std::vector<uint64_t>().swap(keys);
+
+  // Cuthill-McKee: points are numbered level by level, the unnumbered neighbours of each
+  // point in order of increasing degree. rank is -1 until a point is reached.
+  std::vector<int64_t> rank(np, -1);
+  std::vector<char> scanned(static_cast<size_t>(cells.count), 0);
+  std::vector<int64_t> touched; // cells scanned by the current sweep
+  std::vector<int64_t> order;
+  std::vector<int64_t> reached;
+  order.reserve(np);
+  // Numbers the part of start and returns the lowest-degree point of its last level.
+  const auto sweep = [&](const int64_t start) {
+    rank[static_cast<size_t>(start)] = static_cast<int64_t>(order.size());
+    order.push_back(start);
+    size_t head = order.size() - 1;
+    size_t levelBegin = head;
+    while (head < order.size())
+    {
+      levelBegin = head;
+      const size_t levelEnd = order.size();
+      for (; head < levelEnd; ++head)
+      {
+        const int64_t p = order[head];
+        reached.clear();
+        for (int64_t i = first[static_cast<size_t>(p)]; i < first[static_cast<size_t>(p) + 1]; ++i)
+        {
+          const int64_t c = around[static_cast<size_t>(i)];
+          if (scanned[static_cast<size_t>(c)])
+          {
+            continue;
+          }
+          scanned[static_cast<size_t>(c)] = 1;
+          touched.push_back(c);
+          cells.ForEachPoint(c, [&](const int64_t id) {
+            if (rank[static_cast<size_t>(id)] == -1)
+            {
+              rank[static_cast<size_t>(id)] = -2;
+              reached.push_back(id);
+            }
+          });
+        }
+        std::sort(reached.begin(), reached.end(), [&](const int64_t a, const int64_t b) {
+          return degree(a) < degree(b) || (degree(a) == degree(b) && a < b);
+        });
+        for (const int64_t q : reached)
+        {
+          rank[static_cast<size_t>(q)] = static_cast<int64_t>(order.size());
+          order.push_back(q);
+        }
+      }
+    }
+    return *std::min_element(order.begin() + static_cast<ptrdiff_t>(levelBegin), order.end(),
+                             [&](const int64_t a, const int64_t b) {
+                               return degree(a) < degree(b) || (degree(a) == degree(b) && a < b);
+                             });
+  };
+  for (const int64_t s : byDegree)
+  {
+    if (degree(s) == 0 || rank[static_cast<size_t>(s)] >= 0)
+    {
+      continue;
+    }
+    // A first sweep finds the far end of the part, which is numbered again from there.
+    const size_t begin = order.size();
+    const int64_t far = sweep(s);
+    for (size_t i = begin; i < order.size(); ++i)
+    {
+      rank[static_cast<size_t>(order[i])] = -1;
+    }
+    order.resize(begin);
+    for (const int64_t c : touched)
+    {
+      scanned[static_cast<size_t>(c)] = 0;
+    }
+    touched.clear();
+    sweep(far);
+    touched.clear();
+  }
+  std::reverse(order.begin(), order.end());
+  for (size_t p = 0; p < np; ++p)
+  {
+    if (degree(static_cast<int64_t>(p)) == 0)
+    {
+      order.push_back(static_cast<int64_t>(p));
+    }
+  }
+
+  Orders out;
+  out.points = std::move(order);
+  out.cells = detail::CellsByFirstPoint(cells, Inverse(out.points, numBlocks, parallelFor), numBlocks, parallelFor);
+  return out;
+}
+} // namespace reorder
+} // namespace cgns_writer
@@ -0,0 +1,401 @@
+#include "CgnsWriterCoreInternal.h"
+#include "CgnsWriterNodeOrder.h"
+
+#include <cgnslib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace cgns_writer::detail;
+
+struct CgnsSession
+{
+  struct SessionSection
+  {
+    unsigned char vtkType = 0;
+    int nodesPerElem = 0;
+    int S = 0;
+    cgsize_t start = 0;
+    cgsize_t end = 0;
+    cgsize_t written = 0;
+  };
+
+  int fn = 0;
+  int B = 0;
+  int zoneCount = 0;
+  CGNS_ENUMT(DataType_t) coordType = CGNS_ENUMV(RealDouble);
+  double* maxPrecisionLoss = nullptr;
+  int validate = CGNS_VALIDATE_FAST;
+
+  // Current zone; Z == 0 until cgns_session_define_zone has been called.
+  int Z = 0;
+  std::string zoneName;
+  int64_t numPoints = 0;
+  int64_t numCells = 0;
+  int64_t pointsWritten = 0;
+  cgsize_t nextElem = 1;
+  std::vector<SessionSection> sections;
+
+  // Per-chunk scratch; bounded by the largest chunk passed in, not by the zone size.
+  std::vector<cgsize_t> connScratch;
+};
+
+namespace
+{
+void RequireZone(const CgnsSession& s)
+{
+  if (s.Z == 0)
+  {
+    throw std::runtime_error("No zone defined; call cgns_session_define_zone first");
+  }
+}
+
+void CheckZoneComplete(const CgnsSession& s)
+{
+  if (s.Z == 0)
+  {
+    return;
+  }
+  if (s.pointsWritten != s.numPoints)
+  {
+    throw std::runtime_error("Zone " + s.zoneName + ": " + std::to_string(s.pointsWritten) + " of " +
+                             std::to_string(s.numPoints) + " points written");
+  }
+  if (s.nextElem - 1 != static_cast<cgsize_t>(s.numCells))
+  {
+    throw std::runtime_error("Zone " + s.zoneName + ": sections cover " + std::to_string(s.nextElem - 1) +
+                             " of " + std::to_string(s.numCells) + " cells");
+  }
+  for (const auto& sec : s.sections)
+  {
+    if (sec.written != sec.end - sec.start + 1)
+    {
+      throw std::runtime_error("Zone " + s.zoneName + ": section for VTK type " + std::to_string(sec.vtkType) +
+                               " has " + std::to_string(sec.written) + " of " +
+                               std::to_string(sec.end - sec.start + 1) + " elements written");
+    }
+  }
+}
+
+// Range-checks the whole chunk with one min/max reduction and only searches for the
+// offending index when it fails, so the shift (and node reordering of quadratic types)
+// itself stays branch-free.
+template <typename IdT>
+void ShiftConnectivity(const IdT* conn, const unsigned char vtkType, const int64_t numElements, const int nodesPerElem,
+                       const int64_t numPoints, const int validate, cgsize_t* out)
+{
+  const size_t count = static_cast<size_t>(numElements) * static_cast<size_t>(nodesPerElem);
+  if (validate != CGNS_VALIDATE_NONE)
+  {
+    int64_t lo = 0;
+    int64_t hi = 0;
+    IdRange(conn, count, lo, hi);
+    if (lo < 0 || hi >= numPoints)
+    {
+      for (size_t i = 0; i < count; ++i)
+      {
+        const int64_t id = static_cast<int64_t>(conn[i]);
+        if (id < 0 || id >= numPoints)
+        {
+          throw std::runtime_error("Connectivity id out of range at index " + std::to_string(i));
+        }
+      }
+    }
+  }
+  cgns_writer::node_order::CopyElements(vtkType, conn, numElements, nodesPerElem, 1, out);
+}
+} // namespace
+
+extern "C" CGNS_WRITER_API int cgns_session_open(const char* output_path,
+                                                 const CgnsWriteOptions* options,
+                                                 const int cell_dim,
+                                                 CgnsSession** out_session)
+{
+  try
+  {
+    if (!out_session)
+    {
+      throw std::runtime_error("out_session is null");
+    }
+    *out_session = nullptr;
+    if (!output_path || output_path[0] == '\0')
+    {
+      throw std::runtime_error("output_path is null or empty");
+    }
+    CheckStructSizes(nullptr, options);
+
+    auto* s = new CgnsSession();
+    s->coordType = PrecisionType(options ? options->coord_precision : CGNS_PRECISION_DOUBLE);
+    s->maxPrecisionLoss = options ? options->max_precision_loss : nullptr;
+    s->validate = ValidateLevel(options);
+    if (s->maxPrecisionLoss)
+    {
+      *s->maxPrecisionLoss = 0.0;
+    }
+    try
+    {
+      s->fn = OpenForWrite(output_path, options);
+      const CgnsAccess access(s->fn, "cg_base_write");
+      try
+      {
+        CheckCg(cg_base_write(s->fn, BaseName(options), cell_dim > 0 ? cell_dim : 3, 3, &s->B), "cg_base_write");
+      }
+      catch (...)
+      {
+        cg_close(s->fn);
+        throw;
+      }
+    }
+    catch (...)
+    {
+      delete s;
+      throw;
+    }
+
+    *out_session = s;
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_session_define_zone(CgnsSession* session,
+                                                        const char* zone_name,
+                                                        const int64_t num_points,
+                                                        const int64_t num_cells)
+{
+  try
+  {
+    if (!session)
+    {
+      throw std::runtime_error("session is null");
+    }
+    if (num_points <= 0 || num_cells <= 0)
+    {
+      throw std::runtime_error("num_points and num_cells must be > 0");
+    }
+    CheckZoneComplete(*session);
+
+    session->zoneName = (zone_name && zone_name[0] != '\0') ? std::string(zone_name)
+                                                            : "Zone" + std::to_string(session->zoneCount);
+    session->numPoints = num_points;
+    session->numCells = num_cells;
+    session->pointsWritten = 0;
+    session->nextElem = 1;
+    session->sections.clear();
+
+    cgsize_t size[3] = { static_cast<cgsize_t>(num_points), static_cast<cgsize_t>(num_cells), 0 };
+    session->Z = 0;
+    const CgnsAccess access(session->fn, "cg_zone_write");
+    CheckCg(cg_zone_write(session->fn, session->B, session->zoneName.c_str(), size, CGNS_ENUMV(Unstructured),
+                          &session->Z),
+            "cg_zone_write(Unstructured)");
+    ++session->zoneCount;
+
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_session_define_section(CgnsSession* session,
+                                                           const unsigned char vtk_type,
+                                                           const int64_t num_elements)
+{
+  try
+  {
+    if (!session)
+    {
+      throw std::runtime_error("session is null");
+    }
+    RequireZone(*session);
+    if (num_elements <= 0)
+    {
+      throw std::runtime_error("num_elements must be > 0");
+    }
+
+    const CellTypeInfo& info = CellTypeTable()[vtk_type];
+    if (!info.supported)
+    {
+      throw std::runtime_error("Unsupported VTK cell type " + std::to_string(vtk_type));
+    }
+    if (info.nodesPerElem == 0)
+    {
+      throw std::runtime_error("VTK cell type " + std::to_string(vtk_type) +
+                               " has no fixed node count and cannot be streamed into a session");
+    }
+    for (const auto& sec : session->sections)
+    {
+      if (sec.vtkType == vtk_type)
+      {
+        throw std::runtime_error("Section for VTK type " + std::to_string(vtk_type) + " already defined");
+      }
+    }
+    if (session->nextElem - 1 + num_elements > session->numCells)
+    {
+      throw std::runtime_error("Sections exceed the zone's num_cells");
+    }
+
+    CgnsSession::SessionSection sec;
+    sec.vtkType = vtk_type;
+    sec.nodesPerElem = info.nodesPerElem;
+    sec.start = session->nextElem;
+    sec.end = sec.start + static_cast<cgsize_t>(num_elements) - 1;
+
+    const std::string name = DefaultSectionName(info.type);
+    const CgnsAccess access(session->fn, "cg_section_partial_write");
+    CheckCg(cg_section_partial_write(session->fn, session->B, session->Z, name.c_str(), info.type, sec.start,
+                                     sec.end, 0, &sec.S),
+            "cg_section_partial_write(" + name + ")");
+
+    session->nextElem = sec.end + 1;
+    session->sections.push_back(sec);
+
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_session_append_coords(CgnsSession* session,
+                                                          const double* points,
+                                                          const int64_t count)
+{
+  try
+  {
+    if (!session)
+    {
+      throw std::runtime_error("session is null");
+    }
+    RequireZone(*session);
+    if (!points || count <= 0)
+    {
+      throw std::runtime_error("points is null or count <= 0");
+    }
+    if (session->pointsWritten + count > session->numPoints)
+    {
+      throw std::runtime_error("Appending " + std::to_string(count) + " points exceeds the zone's num_points");
+    }
+
+    WriteInterleavedCoords(session->fn, session->B, session->Z, points, session->pointsWritten, count,
+                           session->coordType, session->maxPrecisionLoss);
+    session->pointsWritten += count;
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_session_append_elements(CgnsSession* session,
+                                                            const unsigned char vtk_type,
+                                                            const void* connectivity,
+                                                            const int64_t num_elements,
+                                                            const int use_64bit_ids)
+{
+  try
+  {
+    if (!session)
+    {
+      throw std::runtime_error("session is null");
+    }
+    RequireZone(*session);
+    if (!connectivity || num_elements <= 0)
+    {
+      throw std::runtime_error("connectivity is null or num_elements <= 0");
+    }
+
+    auto it = std::find_if(session->sections.begin(), session->sections.end(),
+                           [&](const CgnsSession::SessionSection& sec) { return sec.vtkType == vtk_type; });
+    if (it == session->sections.end())
+    {
+      throw std::runtime_error("No section defined for VTK type " + std::to_string(vtk_type));
+    }
+    CgnsSession::SessionSection& sec = *it;
+    if (sec.written + num_elements > sec.end - sec.start + 1)
+    {
+      throw std::runtime_error("Appending " + std::to_string(num_elements) +
+                               " elements exceeds the section size for VTK type " + std::to_string(vtk_type));
+    }
+
+    const size_t count = static_cast<size_t>(num_elements) * static_cast<size_t>(sec.nodesPerElem);
+    std::vector<cgsize_t>& scratch = session->connScratch;
+    scratch.resize(count);
+    if (use_64bit_ids)
+    {
+      ShiftConnectivity(static_cast<const int64_t*>(connectivity), vtk_type, num_elements, sec.nodesPerElem,
+                        session->numPoints, session->validate, scratch.data());
+    }
+    else
+    {
+      ShiftConnectivity(static_cast<const int32_t*>(connectivity), vtk_type, num_elements, sec.nodesPerElem,
+                        session->numPoints, session->validate, scratch.data());
+    }
+
+    const cgsize_t first = sec.start + sec.written;
+    const cgsize_t last = first + static_cast<cgsize_t>(num_elements) - 1;
+    const CgnsAccess access(session->fn, "cg_elements_partial_write", static_cast<int64_t>(count * sizeof(cgsize_t)));
+    CheckCg(cg_elements_partial_write(session->fn, session->B, session->Z, sec.S, first, last, scratch.data()),
+            "cg_elements_partial_write");
+
+    sec.written += static_cast<cgsize_t>(num_elements);
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_session_close(CgnsSession* session)
+{
+  if (!session)
+  {
+    SetLastError("session is null");
+    return 1;
+  }
+
+  std::string error;
+  try
+  {
+    CheckZoneComplete(*session);
+  }
+  catch (const std::exception& ex)
+  {
+    error = ex.what();
+  }
+
+  {
+    const CgnsAccess access(session->fn, "cg_close");
+    const int ierr = cg_close(session->fn);
+    if (error.empty() && ierr != CG_OK)
+    {
+      const char* msg = cg_get_error();
+      error = std::string("cg_close: ") + (msg ? msg : "Unknown CGNS error");
+    }
+  }
+  delete session;
+
+  SetLastError(error);
+  return error.empty() ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+#include "CgnsWriterCoreInternal.h"
+
+#include <cgnslib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace cgns_writer::detail;
+
+struct CgnsTimeSeries
+{
+  int fn = 0;
+  int B = 0;
+  int Z = 0;
+  int64_t numPoints = 0;
+  int64_t numCells = 0;
+
+  // Written element -> input cell; empty when the sections keep the input cell order.
+  std::vector<int64_t> elemToCell;
+  // Written vertex -> input point; empty unless the points were reordered.
+  std::vector<int64_t> pointOrder;
+
+  int pointPrecision = CGNS_PRECISION_DOUBLE;
+  int cellPrecision = CGNS_PRECISION_DOUBLE;
+  double* maxPrecisionLoss = nullptr;
+
+  // Steps attempted so far, failed ones included: a failed step may already have created its
+  // FlowSolution nodes, so its number is never reused.
+  int64_t stepsStarted = 0;
+
+  // One entry per appended step; empty names mean the step has no fields at that location.
+  std::vector<double> times;
+  std::vector<std::string> pointSolutions;
+  std::vector<std::string> cellSolutions;
+};
+
+namespace
+{
+// Name length of a CGNS node, the element width of the FlowSolutionPointers arrays.
+constexpr int kNameLength = 32;
+
+bool IsIdentity(const std::vector<int64_t>& order)
+{
+  for (size_t e = 0; e < order.size(); ++e)
+  {
+    if (order[e] != static_cast<int64_t>(e))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes a (32 x steps) character array under the current cg_goto node; "Null" marks a missing step.
+void WriteNameArray(const char* arrayName, const std::vector<std::string>& names)
+{
+  std::vector<char> buf(names.size() * kNameLength, ' ');
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    const std::string& n = names[i].empty() ? std::string("Null") : names[i];
+    std::copy(n.begin(), n.begin() + std::min<size_t>(n.size(), kNameLength), buf.begin() + i * kNameLength);
+  }
+  const cgsize_t dims[2] = { kNameLength, static_cast<cgsize_t>(names.size()) };
+  CheckCg(cg_array_write(arrayName, CGNS_ENUMV(Character), 2, dims, buf.data()),
+          std::string("cg_array_write(") + arrayName + ")");
+}
+
+void WriteIterativeData(const CgnsTimeSeries& ts)
+{
+  const int numSteps = static_cast<int>(ts.times.size());
+  if (numSteps == 0)
+  {
+    return;
+  }
+
+  CheckCg(cg_simulation_type_write(ts.fn, ts.B, CGNS_ENUMV(TimeAccurate)), "cg_simulation_type_write");
+
+  CheckCg(cg_biter_write(ts.fn, ts.B, "BaseIterativeData", numSteps), "cg_biter_write");
+  CheckCg(cg_goto(ts.fn, ts.B, "BaseIterativeData_t", 1, "end"), "cg_goto(BaseIterativeData)");
+  const cgsize_t numValues = numSteps;
+  CheckCg(cg_array_write("TimeValues", CGNS_ENUMV(RealDouble), 1, &numValues, ts.times.data()),
+          "cg_array_write(TimeValues)");
+
+  CheckCg(cg_ziter_write(ts.fn, ts.B, ts.Z, "ZoneIterativeData"), "cg_ziter_write");
+  CheckCg(cg_goto(ts.fn, ts.B, "Zone_t", ts.Z, "ZoneIterativeData_t", 1, "end"), "cg_goto(ZoneIterativeData)");
+
+  // FlowSolutionPointers holds one solution per step: the vertex one when present.
+  // Steps with both locations also get the per-location pointer arrays.
+  std::vector<std::string> pointers(ts.times.size());
+  bool anyPoint = false;
+  bool anyCell = false;
+  for (size_t i = 0; i < pointers.size(); ++i)
+  {
+    pointers[i] = !ts.pointSolutions[i].empty() ? ts.pointSolutions[i] : ts.cellSolutions[i];
+    anyPoint = anyPoint || !ts.pointSolutions[i].empty();
+    anyCell = anyCell || !ts.cellSolutions[i].empty();
+  }
+  WriteNameArray("FlowSolutionPointers", pointers);
+  if (anyPoint && anyCell)
+  {
+    WriteNameArray("FlowSolutionVertexPointers", ts.pointSolutions);
+    WriteNameArray("FlowSolutionCellCenterPointers", ts.cellSolutions);
+  }
+}
+} // namespace
+
+extern "C" CGNS_WRITER_API int cgns_timeseries_open(const char* output_path,
+                                                    const UnstructuredMeshInfo* mesh,
+                                                    const CgnsWriteOptions* options,
+                                                    CgnsTimeSeries** out_series)
+{
+  try
+  {
+    if (!out_series)
+    {
+      throw std::runtime_error("out_series is null");
+    }
+    *out_series = nullptr;
+    if (!output_path || output_path[0] == '\0')
+    {
+      throw std::runtime_error("output_path is null or empty");
+    }
+    if (!mesh)
+    {
+      throw std::runtime_error("mesh is null");
+    }
+    CheckStructSizes(mesh, options);
+
+    PreparedZone zone = PrepareZone(*mesh, options, true);
+
+    auto* ts = new CgnsTimeSeries();
+    ts->numPoints = mesh->num_points;
+    ts->numCells = static_cast<int64_t>(zone.numCells);
+    ts->pointPrecision = options ? options->point_data_precision : CGNS_PRECISION_DOUBLE;
+    ts->cellPrecision = options ? options->cell_data_precision : CGNS_PRECISION_DOUBLE;
+    ts->maxPrecisionLoss = options ? options->max_precision_loss : nullptr;
+    if (ts->maxPrecisionLoss)
+    {
+      *ts->maxPrecisionLoss = 0.0;
+    }
+    try
+    {
+      ts->fn = OpenForWrite(output_path, options);
+      try
+      {
+        const int cellDim = zone.cellDim > 0 ? zone.cellDim : 3;
+        {
+          const CgnsAccess access(ts->fn, "cg_base_write");
+          CheckCg(cg_base_write(ts->fn, BaseName(options), cellDim, 3, &ts->B), "cg_base_write");
+        }
+        const char* zoneName =
+          (options && options->zone_name && options->zone_name[0] != '\0') ? options->zone_name : "Zone0";
+        ts->Z = WritePreparedZone(ts->fn, ts->B, zoneName, *mesh, zone, options, ts->maxPrecisionLoss);
+      }
+      catch (...)
+      {
+        const CgnsAccess access(ts->fn);
+        cg_close(ts->fn);
+        throw;
+      }
+    }
+    catch (...)
+    {
+      delete ts;
+      throw;
+    }
+
+    // Only the permutations outlive open; drop them when they are the identity.
+    if (!IsIdentity(zone.elemToCell))
+    {
+      ts->elemToCell = std::move(zone.elemToCell);
+    }
+    if (!IsIdentity(zone.pointOrder))
+    {
+      ts->pointOrder = std::move(zone.pointOrder);
+    }
+
+    *out_series = ts;
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_timeseries_append_step(CgnsTimeSeries* series,
+                                                           const double time,
+                                                           const CgnsFieldInfo* point_fields,
+                                                           const int num_point_fields,
+                                                           const CgnsFieldInfo* cell_fields,
+                                                           const int num_cell_fields)
+{
+  try
+  {
+    if (!series)
+    {
+      throw std::runtime_error("series is null");
+    }
+    ValidateFields(point_fields, num_point_fields, "point_fields");
+    ValidateFields(cell_fields, num_cell_fields, "cell_fields");
+
+    const std::string step = std::to_string(++series->stepsStarted);
+    const std::string pointName = num_point_fields > 0 ? "PointData_" + step : std::string();
+    const std::string cellName = num_cell_fields > 0 ? "CellData_" + step : std::string();
+
+    WriteFieldSolution(series->fn, series->B, series->Z, pointName.c_str(), CGNS_ENUMV(Vertex), point_fields,
+                       num_point_fields, series->numPoints,
+                       series->pointOrder.empty() ? nullptr : series->pointOrder.data(), series->pointPrecision,
+                       series->maxPrecisionLoss);
+    WriteFieldSolution(series->fn, series->B, series->Z, cellName.c_str(), CGNS_ENUMV(CellCenter), cell_fields,
+                       num_cell_fields, series->numCells,
+                       series->elemToCell.empty() ? nullptr : series->elemToCell.data(), series->cellPrecision,
+                       series->maxPrecisionLoss);
+
+    series->times.push_back(time);
+    series->pointSolutions.push_back(pointName);
+    series->cellSolutions.push_back(cellName);
+
+    SetLastError("");
+    return 0;
+  }
+  catch (const std::exception& ex)
+  {
+    SetLastError(ex.what());
+    return 1;
+  }
+}
+
+extern "C" CGNS_WRITER_API int cgns_timeseries_close(CgnsTimeSeries* series)
+{
+  if (!series)
+  {
+    SetLastError("series is null");
+    return 1;
+  }
+
+  std::string error;
+  {
+    // The cg_goto position used by WriteIterativeData is global, so hold access across all of it.
+    const CgnsAccess access(series->fn, "cg_close");
+    try
+    {
+      WriteIterativeData(*series);
+    }
+    catch (const std::exception& ex)
+    {
+      error = ex.what();
+    }
+
+    const int ierr = cg_close(series->fn);
+    if (error.empty() && ierr != CG_OK)
+    {
+      const char* msg = cg_get_error();
+      error = std::string("cg_close: ") + (msg ? msg : "Unknown CGNS error");
+    }
+  }
+  delete series;
+
+  SetLastError(error);
+  return error.empty() ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+#pragma once
+
+// Span tracing for profiling exports, written as Chrome trace JSON (load the file
+// in chrome://tracing or https://ui.perfetto.dev).
+//
+// Configure with -DCGNS_WRITER_TRACE=ON to compile it in. Otherwise
+// CGNS_WRITER_ENABLE_TRACE is 0, the CGNS_TRACE_* macros expand to nothing and
+// nothing in this header is used.
+//
+// When it is compiled in, each thread records into its own fixed-size ring
+// buffer without locking; once the ring is full, the oldest spans are
+// overwritten. Only registering a thread's buffer takes a lock. Buffers of
+// finished threads are kept for the dump and handed to the next new thread.
+// The spans are written out by Dump, and at process exit to the file named by
+// the CGNS_WRITER_TRACE_FILE environment variable when it is set. Dump reads
+// the rings of other threads without synchronising with them, so call it while
+// no traced write is running. Like the phase timers, every binary that
+// compiles this header has its own buffers.
+
+#ifndef CGNS_WRITER_ENABLE_TRACE
+#  define CGNS_WRITER_ENABLE_TRACE 0
+#endif
+
+#if CGNS_WRITER_ENABLE_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cgns_writer
+{
+namespace trace
+{
+// A span argument: a number, or a string with static lifetime (a literal or a VTK class name).
+struct Arg
+{
+  const char* key = nullptr;
+  const char* str = nullptr;
+  int64_t num = 0;
+};
+
+struct Event
+{
+  const char* name = nullptr; // string literal
+  int64_t beginNs = 0;
+  int64_t endNs = 0;
+  uint32_t tid = 0;
+  Arg args[2];
+};
+
+// Single-producer ring: only the owning thread writes events and bumps head.
+struct Ring
+{
+  static constexpr size_t kCapacity = 1 << 14;
+
+  std::unique_ptr<Event[]> events{ new Event[kCapacity] };
+  std::atomic<uint64_t> head{ 0 };
+  bool inUse = false; // guarded by Registry::Mutex
+};
+
+class Registry
+{
+public:
+  // Never destroyed, so threads that exit during static destruction can still release their rings.
+  static Registry& Get()
+  {
+    static Registry* const registry = new Registry();
+    return *registry;
+  }
+
+  int64_t Now() const
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count();
+  }
+
+  Ring* Acquire()
+  {
+    const std::lock_guard<std::mutex> lock(Mutex);
+    for (const auto& ring : Rings)
+    {
+      if (!ring->inUse)
+      {
+        ring->inUse = true;
+        return ring.get();
+      }
+    }
+    Rings.push_back(std::unique_ptr<Ring>(new Ring()));
+    Rings.back()->inUse = true;
+    return Rings.back().get();
+  }
+
+  void Release(Ring* ring)
+  {
+    const std::lock_guard<std::mutex> lock(Mutex);
+    ring->inUse = false;
+  }
+
+  uint32_t NextThreadId() { return ++LastThreadId; }
+
+  // Writes every recorded span to path; returns false when the file cannot be written.
+  bool Dump(const char* path)
+  {
+    std::FILE* f = std::fopen(path, "w");
+    if (!f)
+    {
+      return false;
+    }
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+    bool first = true;
+    const std::lock_guard<std::mutex> lock(Mutex);
+    for (const auto& ring : Rings)
+    {
+      const uint64_t head = ring->head.load(std::memory_order_acquire);
+      const uint64_t begin = head > Ring::kCapacity ? head - Ring::kCapacity : 0;
+      for (uint64_t i = begin; i < head; ++i)
+      {
+        WriteEvent(f, ring->events[i % Ring::kCapacity], first);
+        first = false;
+      }
+    }
+    std::fputs("]}\n", f);
+    return std::fclose(f) == 0;
+  }
+
+  Registry(const Registry&) = delete;
+  Registry& operator=(const Registry&) = delete;
+
+private:
+  Registry()
+    : Epoch(std::chrono::steady_clock::now())
+  {
+    std::atexit([] {
+      const char* path = std::getenv("CGNS_WRITER_TRACE_FILE");
+      if (path && path[0] != '\0')
+      {
+        Get().Dump(path);
+      }
+    });
+  }
+
+  static void WriteString(std::FILE* f, const char* s)
+  {
+    std::fputc('"', f);
+    for (; *s; ++s)
+    {
+      const unsigned char ch = static_cast<unsigned char>(*s);
+      if (ch == '"' || ch == '\\')
+      {
+        std::fputc('\\', f);
+        std::fputc(ch, f);
+      }
+      else if (ch < 0x20)
+      {
+        std::fprintf(f, "\\u%04x", ch);
+      }
+      else
+      {
+        std::fputc(ch, f);
+      }
+    }
+    std::fputc('"', f);
+  }
+
+  static void WriteEvent(std::FILE* f, const Event& e, const bool first)
+  {
+    std::fputs(first ? "\n{\"name\":" : ",\n{\"name\":", f);
+    WriteString(f, e.name);
+    std::fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", e.tid, e.beginNs / 1000.0,
+                 (e.endNs - e.beginNs) / 1000.0);
+    if (e.args[0].key)
+    {
+      std::fputs(",\"args\":{", f);
+      for (int a = 0; a < 2 && e.args[a].key; ++a)
+      {
+        if (a > 0)
+        {
+          std::fputc(',', f);
+        }
+        WriteString(f, e.args[a].key);
+        std::fputc(':', f);
+        if (e.args[a].str)
+        {
+          WriteString(f, e.args[a].str);
+        }
+        else
+        {
+          std::fprintf(f, "%lld", static_cast<long long>(e.args[a].num));
+        }
+      }
+      std::fputc('}', f);
+    }
+    std::fputc('}', f);
+  }
+
+  std::chrono::steady_clock::time_point Epoch;
+  std::mutex Mutex;
+  std::vector<std::unique_ptr<Ring>> Rings;
+  std::atomic<uint32_t> LastThreadId{ 0 };
+};
+
+// The calling thread's ring, registered on first use and released when the thread exits.
+class ThreadRing
+{
+public:
+  static ThreadRing& Get()
+  {
+    thread_local ThreadRing ring;
+    return ring;
+  }
+
+  void Push(const Event& e)
+  {
+    const uint64_t head = R->head.load(std::memory_order_relaxed);
+    Event& slot = R->events[head % Ring::kCapacity];
+    slot = e;
+    slot.tid = Tid;
+    R->head.store(head + 1, std::memory_order_release);
+  }
+
+  ~ThreadRing() { Registry::Get().Release(R); }
+
+  ThreadRing(const ThreadRing&) = delete;
+  ThreadRing& operator=(const ThreadRing&) = delete;
+
+private:
+  ThreadRing()
+    : R(Registry::Get().Acquire())
+    , Tid(Registry::Get().NextThreadId())
+  {
+  }
+
+  Ring* R;
+  uint32_t Tid;
+};
+
+// Records [construction, destruction) as a span named name; a null name records nothing.
+class Span
+{
+public:
+  explicit Span(const char* name)
+  {
+    if (name)
+    {
+      E.name = name;
+      E.beginNs = Registry::Get().Now();
+    }
+  }
+
+  ~Span()
+  {
+    if (E.name)
+    {
+      E.endNs = Registry::Get().Now();
+      ThreadRing::Get().Push(E);
+    }
+  }
+
+  // Attaches up to two arguments; further ones are dropped.
+  void Arg(const char* key, const int64_t value)
+  {
+    if (trace::Arg* a = Free())
+    {
+      a->key = key;
+      a->num = value;
+    }
+  }
+
+  void Arg(const char* key, const char* value)
+  {
+    if (trace::Arg* a = Free())
+    {
+      a->key = key;
+      a->str = value ? value : "null";
+    }
+  }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+private:
+  trace::Arg* Free()
+  {
+    for (trace::Arg& a : E.args)
+    {
+      if (!a.key)
+      {
+        return &a;
+      }
+    }
+    return nullptr;
+  }
+
+  Event E;
+};
+
+// Writes the spans recorded so far; see the note at the top of this file.
+inline bool Dump(const char* path)
+{
+  return Registry::Get().Dump(path);
+}
+} // namespace trace
+} // namespace cgns_writer
+
+#  define CGNS_TRACE_CONCAT_IMPL(a, b) a##b
+#  define CGNS_TRACE_CONCAT(a, b) CGNS_TRACE_CONCAT_IMPL(a, b)
+// Traces the rest of the enclosing block as a span named name (a string literal).
+#  define CGNS_TRACE_SCOPE(name) const ::cgns_writer::trace::Span CGNS_TRACE_CONCAT(cgnsTraceSpan, __LINE__)(name)
+// Same, with a variable so arguments can be attached: CGNS_TRACE_ARG(var, "key", value).
+#  define CGNS_TRACE_SPAN(var, name) ::cgns_writer::trace::Span var(name)
+#  define CGNS_TRACE_ARG(var, key, value) var.Arg(key, value)
+
+#else
+
+#  define CGNS_TRACE_SCOPE(name) ((void)0)
+#  define CGNS_TRACE_SPAN(var, name) ((void)0)
+#  define CGNS_TRACE_ARG(var, key, value) ((void)0)
+
+#endif
@@ -0,0 +1,145 @@
+// Checks connectivity::Narrow: a section whose node ids and offsets all fit in an int32_t is
+// moved into its 32-bit arrays unchanged, and one with any value out of range, in any block,
+// is left as it was. With a 32-bit cgsize_t or a libcgns older than 4.1 nothing is narrowed.
+
+#include "CgnsWriterConnectivity.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using cgns_writer::connectivity::kCanNarrow;
+
+// The members Narrow works on.
+struct Section
+{
+  std::vector<cgsize_t> conn;
+  std::vector<cgsize_t> offsets;
+  std::vector<int32_t> conn32;
+  std::vector<int32_t> offsets32;
+};
+
+// One thread per block, so that blocks really run concurrently.
+void ThreadedFor(const size_t numBlocks, const std::function<void(size_t)>& fn)
+{
+  std::vector<std::thread> threads;
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    threads.emplace_back(fn, b);
+  }
+  for (std::thread& t : threads)
+  {
+    t.join();
+  }
+}
+
+// Narrows a copy of s in numBlocks blocks and checks the outcome: narrowed to the same values
+// when fits (and narrowing is possible at all), otherwise left untouched.
+int Check(const char* name, const Section& s, const bool fits, const size_t numBlocks)
+{
+  Section t = s;
+  const bool narrowed = cgns_writer::connectivity::Narrow(t, numBlocks, ThreadedFor);
+  const bool expected = fits && kCanNarrow;
+  bool ok = narrowed == expected;
+  if (ok && narrowed)
+  {
+    ok = t.conn.empty() && t.offsets.empty() && t.conn32.size() == s.conn.size() &&
+         t.offsets32.size() == s.offsets.size() &&
+         cgns_writer::connectivity::BytesSaved(t) ==
+           static_cast<int64_t>((s.conn.size() + s.offsets.size()) * (sizeof(cgsize_t) - sizeof(int32_t)));
+    for (size_t i = 0; ok && i < s.conn.size(); ++i)
+    {
+      ok = static_cast<cgsize_t>(t.conn32[i]) == s.conn[i];
+    }
+    for (size_t i = 0; ok && i < s.offsets.size(); ++i)
+    {
+      ok = static_cast<cgsize_t>(t.offsets32[i]) == s.offsets[i];
+    }
+  }
+  else if (ok)
+  {
+    ok = t.conn == s.conn && t.offsets == s.offsets && t.conn32.empty() && t.offsets32.empty() &&
+         cgns_writer::connectivity::BytesSaved(t) == 0;
+  }
+  if (!ok)
+  {
+    std::fprintf(stderr, "FAIL: %s, %zu blocks: narrowed %d, expected %d\n", name, numBlocks, narrowed ? 1 : 0,
+                 expected ? 1 : 0);
+    return 1;
+  }
+  return 0;
+}
+
+// n node ids counting up from 1, as element sections hold them.
+Section Elements(const size_t n)
+{
+  Section s;
+  for (size_t i = 0; i < n; ++i)
+  {
+    s.conn.push_back(static_cast<cgsize_t>(i + 1));
+  }
+  return s;
+}
+
+// Polygons of three nodes each over the ids of Elements(n).
+Section Polygons(const size_t n)
+{
+  Section s = Elements(n);
+  for (size_t i = 0; i <= n; i += 3)
+  {
+    s.offsets.push_back(static_cast<cgsize_t>(i));
+  }
+  return s;
+}
+} // namespace
+
+int main()
+{
+  const int64_t int32Max = std::numeric_limits<int32_t>::max();
+  const int64_t int32Min = std::numeric_limits<int32_t>::min();
+  int fails = 0;
+  for (const size_t numBlocks : { size_t(1), size_t(4) })
+  {
+    fails += Check("elements", Elements(3000), true, numBlocks);
+    fails += Check("polygons", Polygons(3000), true, numBlocks);
+    fails += Check("empty section", Section(), false, numBlocks);
+
+    Section signedFaces = Polygons(3000);
+    signedFaces.conn[10] = -signedFaces.conn[10]; // NFACE_n refers to reversed faces with negative numbers
+    fails += Check("negative ids", signedFaces, true, numBlocks);
+
+    if (sizeof(cgsize_t) > sizeof(int32_t))
+    {
+      Section edge = Elements(3000);
+      edge.conn[1] = static_cast<cgsize_t>(int32Max);
+      edge.conn[2] = static_cast<cgsize_t>(int32Min);
+      fails += Check("int32 limits", edge, true, numBlocks);
+
+      // One value out of range in the first, a middle and the last block.
+      for (const size_t at : { size_t(0), size_t(1700), size_t(2999) })
+      {
+        Section big = Elements(3000);
+        big.conn[at] = static_cast<cgsize_t>(int32Max + 1);
+        fails += Check("id above int32", big, false, numBlocks);
+        big.conn[at] = static_cast<cgsize_t>(int32Min - 1);
+        fails += Check("id below int32", big, false, numBlocks);
+      }
+
+      Section longOffsets = Polygons(3000);
+      longOffsets.offsets.back() = static_cast<cgsize_t>(int32Max + 1);
+      fails += Check("offset above int32", longOffsets, false, numBlocks);
+    }
+  }
+
+  if (fails == 0)
+  {
+    std::printf("connectivity: narrowing %s and stops at any id or offset outside int32\n",
+                kCanNarrow ? "keeps every value" : "is disabled for this libcgns");
+  }
+  return fails == 0 ? 0 : 1;
+}
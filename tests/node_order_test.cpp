@@ -0,0 +1,146 @@
+// Checks the node order CopyElements writes for every quadratic VTK cell type against the
+// CGNS SIDS numbering. Each node is identified by the corners it lies between (a corner by
+// itself, a mid-edge node by the two ends of its edge, a face or volume centre by all the
+// corners of the face or cell), transcribed separately from the VTK cell documentation and
+// from the SIDS, so a wrong permutation entry shows up as a node in the wrong place.
+
+#include "CgnsWriterNodeOrder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+using Nodes = std::vector<std::vector<int>>;
+
+struct CellOrder
+{
+  const char* name;
+  unsigned char vtkType;
+  Nodes vtk;  // VTK node i lies between corners vtk[i] (0-based, as in the VTK documentation)
+  Nodes cgns; // CGNS node k + 1 lies between corners cgns[k] (1-based, as in the SIDS)
+};
+
+std::vector<CellOrder> Cells()
+{
+  // VTK hexahedron faces (-x, +x, -y, +y, -z, +z) and SIDS hexahedron faces.
+  const Nodes vtkHexaFaces = { { 0, 3, 7, 4 }, { 1, 2, 6, 5 }, { 0, 1, 5, 4 },
+                               { 3, 2, 6, 7 }, { 0, 1, 2, 3 }, { 4, 5, 6, 7 } };
+  const Nodes cgnsHexaFaces = { { 1, 2, 3, 4 }, { 1, 2, 6, 5 }, { 2, 3, 7, 6 },
+                                { 3, 4, 8, 7 }, { 1, 5, 8, 4 }, { 5, 6, 7, 8 } };
+  const Nodes vtkHexa20 = { { 0 }, { 1 }, { 2 }, { 3 }, { 4 }, { 5 }, { 6 }, { 7 },
+                            { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, { 4, 5 }, { 5, 6 }, { 6, 7 }, { 7, 4 },
+                            { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+  const Nodes cgnsHexa20 = { { 1 }, { 2 }, { 3 }, { 4 }, { 5 }, { 6 }, { 7 }, { 8 },
+                             { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 1 }, { 1, 5 }, { 2, 6 }, { 3, 7 }, { 4, 8 },
+                             { 5, 6 }, { 6, 7 }, { 7, 8 }, { 8, 5 } };
+  Nodes vtkHexa27 = vtkHexa20;
+  vtkHexa27.insert(vtkHexa27.end(), vtkHexaFaces.begin(), vtkHexaFaces.end());
+  vtkHexa27.push_back({ 0, 1, 2, 3, 4, 5, 6, 7 });
+  Nodes cgnsHexa27 = cgnsHexa20;
+  cgnsHexa27.insert(cgnsHexa27.end(), cgnsHexaFaces.begin(), cgnsHexaFaces.end());
+  cgnsHexa27.push_back({ 1, 2, 3, 4, 5, 6, 7, 8 });
+
+  const Nodes vtkPenta15 = { { 0 }, { 1 }, { 2 }, { 3 }, { 4 }, { 5 }, { 0, 1 }, { 1, 2 },
+                             { 2, 0 }, { 3, 4 }, { 4, 5 }, { 5, 3 }, { 0, 3 }, { 1, 4 }, { 2, 5 } };
+  const Nodes cgnsPenta15 = { { 1 }, { 2 }, { 3 }, { 4 }, { 5 }, { 6 }, { 1, 2 }, { 2, 3 },
+                              { 3, 1 }, { 1, 4 }, { 2, 5 }, { 3, 6 }, { 4, 5 }, { 5, 6 }, { 6, 4 } };
+  Nodes vtkPenta18 = vtkPenta15;
+  vtkPenta18.insert(vtkPenta18.end(), { { 0, 1, 4, 3 }, { 1, 2, 5, 4 }, { 2, 0, 3, 5 } });
+  Nodes cgnsPenta18 = cgnsPenta15;
+  cgnsPenta18.insert(cgnsPenta18.end(), { { 1, 2, 5, 4 }, { 2, 3, 6, 5 }, { 3, 1, 4, 6 } });
+
+  const Nodes vtkQuad8 = { { 0 }, { 1 }, { 2 }, { 3 }, { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 } };
+  const Nodes cgnsQuad8 = { { 1 }, { 2 }, { 3 }, { 4 }, { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 1 } };
+  Nodes vtkQuad9 = vtkQuad8;
+  vtkQuad9.push_back({ 0, 1, 2, 3 });
+  Nodes cgnsQuad9 = cgnsQuad8;
+  cgnsQuad9.push_back({ 1, 2, 3, 4 });
+
+  return {
+    { "BAR_3", 21, { { 0 }, { 1 }, { 0, 1 } }, { { 1 }, { 2 }, { 1, 2 } } },
+    { "TRI_6", 22, { { 0 }, { 1 }, { 2 }, { 0, 1 }, { 1, 2 }, { 2, 0 } },
+      { { 1 }, { 2 }, { 3 }, { 1, 2 }, { 2, 3 }, { 3, 1 } } },
+    { "QUAD_8", 23, vtkQuad8, cgnsQuad8 },
+    { "QUAD_9", 28, vtkQuad9, cgnsQuad9 },
+    { "TETRA_10", 24, { { 0 }, { 1 }, { 2 }, { 3 }, { 0, 1 }, { 1, 2 }, { 2, 0 }, { 0, 3 }, { 1, 3 }, { 2, 3 } },
+      { { 1 }, { 2 }, { 3 }, { 4 }, { 1, 2 }, { 2, 3 }, { 3, 1 }, { 1, 4 }, { 2, 4 }, { 3, 4 } } },
+    { "PYRA_13", 27,
+      { { 0 }, { 1 }, { 2 }, { 3 }, { 4 }, { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }, { 0, 4 }, { 1, 4 }, { 2, 4 },
+        { 3, 4 } },
+      { { 1 }, { 2 }, { 3 }, { 4 }, { 5 }, { 1, 2 }, { 2, 3 }, { 3, 4 }, { 4, 1 }, { 1, 5 }, { 2, 5 }, { 3, 5 },
+        { 4, 5 } } },
+    { "PENTA_15", 26, vtkPenta15, cgnsPenta15 },
+    { "PENTA_18", 32, vtkPenta18, cgnsPenta18 },
+    { "HEXA_20", 25, vtkHexa20, cgnsHexa20 },
+    { "HEXA_27", 29, vtkHexa27, cgnsHexa27 },
+  };
+}
+
+std::vector<int> Sorted(std::vector<int> corners, const int base)
+{
+  for (int& c : corners)
+  {
+    c -= base;
+  }
+  std::sort(corners.begin(), corners.end());
+  return corners;
+}
+
+// Copies three cells of the type with CopyElements and checks every node it wrote.
+template <typename IdT>
+int Check(const CellOrder& cell)
+{
+  const int64_t n = static_cast<int64_t>(cell.vtk.size());
+  const int64_t count = 3;
+  const cgsize_t shift = 1;
+  std::vector<IdT> ids(static_cast<size_t>(count * n));
+  for (size_t i = 0; i < ids.size(); ++i)
+  {
+    ids[i] = static_cast<IdT>(i); // cell e, VTK node i -> point e * n + i
+  }
+  std::vector<cgsize_t> dst(ids.size(), -1);
+  cgns_writer::node_order::CopyElements(cell.vtkType, ids.data(), count, n, shift, dst.data());
+
+  int fails = 0;
+  if (cell.cgns.size() != cell.vtk.size())
+  {
+    std::fprintf(stderr, "FAIL: %s: tables have %zu and %zu nodes\n", cell.name, cell.cgns.size(), cell.vtk.size());
+    return 1;
+  }
+  for (int64_t e = 0; e < count; ++e)
+  {
+    for (int64_t k = 0; k < n; ++k)
+    {
+      const int64_t point = static_cast<int64_t>(dst[static_cast<size_t>(e * n + k)]) - shift;
+      const int64_t vtkNode = point - e * n;
+      if (vtkNode < 0 || vtkNode >= n ||
+          Sorted(cell.vtk[static_cast<size_t>(vtkNode)], 0) != Sorted(cell.cgns[static_cast<size_t>(k)], 1))
+      {
+        std::fprintf(stderr, "FAIL: %s (%zu-byte ids): cell %lld, CGNS node %lld is VTK node %lld\n", cell.name,
+                     sizeof(IdT), static_cast<long long>(e), static_cast<long long>(k + 1),
+                     static_cast<long long>(vtkNode));
+        ++fails;
+      }
+    }
+  }
+  return fails;
+}
+} // namespace
+
+int main()
+{
+  int fails = 0;
+  for (const CellOrder& cell : Cells())
+  {
+    fails += Check<int32_t>(cell);
+    fails += Check<int64_t>(cell);
+  }
+  if (fails == 0)
+  {
+    std::printf("node order: all quadratic cell types match the SIDS\n");
+  }
+  return fails == 0 ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// Checks the NGON_n/NFACE_n sections polyhedra::Build makes: shared faces are stored once, in
+// order of first appearance and as their first cell lists them; a cell that sees a stored
+// face reversed references it with a negative sign; and the result is the same whether the
+// cells run as one block or as several concurrent ones.
+
+#include "CgnsWriterPolyhedra.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using cgns_writer::polyhedra::Sections;
+
+constexpr unsigned char kHexahedron = 12;
+constexpr unsigned char kPolyhedron = 42;
+
+// Cells stored like vtkCellArray, as Build reads them.
+struct Cells
+{
+  std::vector<int64_t> offsets = { 0 };
+  std::vector<int64_t> conn;
+  std::vector<unsigned char> types;
+
+  void AddHexahedron(const std::vector<int64_t>& nodes)
+  {
+    conn.insert(conn.end(), nodes.begin(), nodes.end());
+    offsets.push_back(static_cast<int64_t>(conn.size()));
+    types.push_back(kHexahedron);
+  }
+
+  void AddPolyhedron(const std::vector<std::vector<int64_t>>& faces)
+  {
+    conn.push_back(static_cast<int64_t>(faces.size()));
+    for (const auto& face : faces)
+    {
+      conn.push_back(static_cast<int64_t>(face.size()));
+      conn.insert(conn.end(), face.begin(), face.end());
+    }
+    offsets.push_back(static_cast<int64_t>(conn.size()));
+    types.push_back(kPolyhedron);
+  }
+
+  int64_t NumCells() const { return static_cast<int64_t>(types.size()); }
+};
+
+// One thread per block, so that blocks really run concurrently.
+void ThreadedFor(const size_t numBlocks, const std::function<void(size_t)>& fn)
+{
+  std::vector<std::thread> threads;
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    threads.emplace_back(fn, b);
+  }
+  for (std::thread& t : threads)
+  {
+    t.join();
+  }
+}
+
+Sections Build(const Cells& cells, const size_t numBlocks)
+{
+  Sections out;
+  cgns_writer::polyhedra::Build<int64_t>(cells.offsets.data(), cells.conn.data(), cells.types.data(),
+                                         cells.NumCells(), numBlocks, ThreadedFor, out);
+  return out;
+}
+
+bool Same(const Sections& a, const Sections& b)
+{
+  return a.faceConn == b.faceConn && a.faceOffsets == b.faceOffsets && a.cellConn == b.cellConn &&
+         a.cellOffsets == b.cellOffsets;
+}
+
+// Two hexahedra side by side and a polyhedral cube after them, on the 4 x 2 x 2 nodes
+// i + 4 * (j + 2 * k). The polyhedron starts its shared face at another node.
+int CheckSmallMesh()
+{
+  Cells cells;
+  cells.AddHexahedron({ 0, 1, 5, 4, 8, 9, 13, 12 });
+  cells.AddHexahedron({ 1, 2, 6, 5, 9, 10, 14, 13 });
+  cells.AddPolyhedron({ { 14, 6, 2, 10 },
+                        { 3, 7, 15, 11 },
+                        { 2, 3, 11, 10 },
+                        { 6, 14, 15, 7 },
+                        { 2, 6, 7, 3 },
+                        { 10, 11, 15, 14 } });
+
+  // The faces of the first hexahedron in VTK's order, the five new ones of the second
+  // (its -x face is the first one's +x face, reversed), then the five new ones of the
+  // polyhedron (its -x face is the second hexahedron's +x face, reversed and rotated).
+  const std::vector<std::vector<int64_t>> faces = {
+    { 0, 8, 12, 4 },  { 1, 5, 13, 9 },  { 0, 1, 9, 8 },   { 4, 12, 13, 5 }, { 0, 4, 5, 1 },   { 8, 9, 13, 12 },
+    { 2, 6, 14, 10 }, { 1, 2, 10, 9 },  { 5, 13, 14, 6 }, { 1, 5, 6, 2 },   { 9, 10, 14, 13 },
+    { 3, 7, 15, 11 }, { 2, 3, 11, 10 }, { 6, 14, 15, 7 }, { 2, 6, 7, 3 },   { 10, 11, 15, 14 },
+  };
+  Sections expected;
+  expected.faceOffsets.push_back(0);
+  for (const auto& face : faces)
+  {
+    for (const int64_t node : face)
+    {
+      expected.faceConn.push_back(static_cast<cgsize_t>(node + 1));
+    }
+    expected.faceOffsets.push_back(static_cast<cgsize_t>(expected.faceConn.size()));
+  }
+  expected.cellConn = { 1, 2, 3, 4, 5, 6, -2, 7, 8, 9, 10, 11, -7, 12, 13, 14, 15, 16 };
+  expected.cellOffsets = { 0, 6, 12, 18 };
+
+  int fails = 0;
+  for (const size_t numBlocks : { size_t(1), size_t(2), size_t(3) })
+  {
+    if (!Same(Build(cells, numBlocks), expected))
+    {
+      std::fprintf(stderr, "FAIL: small mesh, %zu blocks: sections differ from the expected ones\n", numBlocks);
+      ++fails;
+    }
+  }
+  return fails;
+}
+
+// True when b is the cycle a, read forwards (or backwards when reversed) from any start.
+bool SameCycle(const std::vector<int64_t>& a, const std::vector<int64_t>& b, const bool reversed)
+{
+  const size_t n = a.size();
+  if (b.size() != n)
+  {
+    return false;
+  }
+  for (size_t start = 0; start < n; ++start)
+  {
+    bool equal = true;
+    for (size_t i = 0; i < n && equal; ++i)
+    {
+      const size_t j = reversed ? (start + n - i) % n : (start + i) % n;
+      equal = a[j] == b[i];
+    }
+    if (equal)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// An nx x ny x nz grid of unit cubes where every third cell is a polyhedron, with each of
+// its faces starting at a different node than the hexahedron would.
+int CheckGrid()
+{
+  const int64_t nx = 7;
+  const int64_t ny = 5;
+  const int64_t nz = 4;
+  auto node = [&](const int64_t i, const int64_t j, const int64_t k) { return i + (nx + 1) * (j + (ny + 1) * k); };
+  const auto* hexFaces = cgns_writer::polyhedra::FacesOfLinearCell(kHexahedron);
+
+  Cells cells;
+  std::vector<std::vector<std::vector<int64_t>>> cellFaces; // faces of each cell as the cell lists them
+  for (int64_t k = 0; k < nz; ++k)
+  {
+    for (int64_t j = 0; j < ny; ++j)
+    {
+      for (int64_t i = 0; i < nx; ++i)
+      {
+        const std::vector<int64_t> hex = { node(i, j, k),         node(i + 1, j, k),         node(i + 1, j + 1, k),
+                                           node(i, j + 1, k),     node(i, j, k + 1),         node(i + 1, j, k + 1),
+                                           node(i + 1, j + 1, k + 1), node(i, j + 1, k + 1) };
+        std::vector<std::vector<int64_t>> faces;
+        for (int f = 0; f < hexFaces->numFaces; ++f)
+        {
+          std::vector<int64_t> face;
+          for (int v = 0; v < hexFaces->sizes[f]; ++v)
+          {
+            face.push_back(hex[static_cast<size_t>(hexFaces->nodes[f][(v + f + i) % hexFaces->sizes[f]])]);
+          }
+          faces.push_back(face);
+        }
+        if (cells.NumCells() % 3 == 2)
+        {
+          cells.AddPolyhedron(faces);
+        }
+        else
+        {
+          cells.AddHexahedron(hex);
+        }
+        cellFaces.push_back(faces);
+      }
+    }
+  }
+
+  int fails = 0;
+  const Sections one = Build(cells, 1);
+  const int64_t expectedFaces = (nx + 1) * ny * nz + nx * (ny + 1) * nz + nx * ny * (nz + 1);
+  if (one.NumFaces() != expectedFaces || one.NumCells() != cells.NumCells())
+  {
+    std::fprintf(stderr, "FAIL: grid: %lld faces and %lld cells, expected %lld and %lld\n",
+                 static_cast<long long>(one.NumFaces()), static_cast<long long>(one.NumCells()),
+                 static_cast<long long>(expectedFaces), static_cast<long long>(cells.NumCells()));
+    return 1;
+  }
+
+  // Every reference is the cell's own face, reversed exactly when the sign is negative;
+  // faces are numbered in order of first reference, which is positive; an interior face
+  // is referenced twice with opposite signs.
+  std::vector<int> uses(static_cast<size_t>(one.NumFaces()) + 1, 0);
+  std::vector<int> signs(static_cast<size_t>(one.NumFaces()) + 1, 0);
+  cgsize_t highest = 0;
+  for (int64_t c = 0; c < one.NumCells(); ++c)
+  {
+    for (cgsize_t at = one.cellOffsets[static_cast<size_t>(c)]; at < one.cellOffsets[static_cast<size_t>(c) + 1]; ++at)
+    {
+      const cgsize_t ref = one.cellConn[static_cast<size_t>(at)];
+      const cgsize_t face = ref < 0 ? -ref : ref;
+      std::vector<int64_t> stored;
+      for (cgsize_t f = one.faceOffsets[static_cast<size_t>(face) - 1]; f < one.faceOffsets[static_cast<size_t>(face)];
+           ++f)
+      {
+        stored.push_back(static_cast<int64_t>(one.faceConn[static_cast<size_t>(f)]) - 1);
+      }
+      const size_t k = static_cast<size_t>(at - one.cellOffsets[static_cast<size_t>(c)]);
+      const std::vector<int64_t>& own = cellFaces[static_cast<size_t>(c)][k];
+      if (!SameCycle(own, stored, ref < 0))
+      {
+        std::fprintf(stderr, "FAIL: grid: cell %lld references face %lld, which is not its face\n",
+                     static_cast<long long>(c), static_cast<long long>(ref));
+        ++fails;
+      }
+      if (face > highest + 1 || (face == highest + 1 && ref < 0))
+      {
+        std::fprintf(stderr, "FAIL: grid: cell %lld references face %lld before face %lld\n",
+                     static_cast<long long>(c), static_cast<long long>(ref), static_cast<long long>(highest + 1));
+        ++fails;
+      }
+      highest = std::max(highest, face);
+      ++uses[static_cast<size_t>(face)];
+      signs[static_cast<size_t>(face)] += ref < 0 ? -1 : 1;
+    }
+  }
+  for (size_t face = 1; face < uses.size(); ++face)
+  {
+    if (uses[face] < 1 || uses[face] > 2 || (uses[face] == 2 && signs[face] != 0))
+    {
+      std::fprintf(stderr, "FAIL: grid: face %zu referenced %d times, sign sum %d\n", face, uses[face], signs[face]);
+      ++fails;
+    }
+  }
+
+  for (const size_t numBlocks : { size_t(2), size_t(5), size_t(16) })
+  {
+    if (!Same(Build(cells, numBlocks), one))
+    {
+      std::fprintf(stderr, "FAIL: grid: %zu blocks give other sections than 1 block\n", numBlocks);
+      ++fails;
+    }
+  }
+  return fails;
+}
+} // namespace
+
+int main()
+{
+  const int fails = CheckSmallMesh() + CheckGrid();
+  if (fails == 0)
+  {
+    std::printf("polyhedra: shared faces, orientation signs and block independence ok\n");
+  }
+  return fails == 0 ? 0 : 1;
+}
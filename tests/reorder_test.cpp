@@ -0,0 +1,260 @@
+// Checks the point and cell orders of reorder::Hilbert and reorder::ReverseCuthillMcKee:
+// both are permutations, they do not change from one run to the next or with the number of
+// parallel blocks, and they do what they are for (the Hilbert keys walk a continuous curve,
+// RCM narrows the bandwidth of a scrambled mesh and puts points of no cell last).
+
+#include "CgnsWriterReorder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using cgns_writer::reorder::Orders;
+
+// One thread per block, so that blocks really run concurrently.
+void ThreadedFor(const size_t numBlocks, const std::function<void(size_t)>& fn)
+{
+  std::vector<std::thread> threads;
+  for (size_t b = 0; b < numBlocks; ++b)
+  {
+    threads.emplace_back(fn, b);
+  }
+  for (std::thread& t : threads)
+  {
+    t.join();
+  }
+}
+
+// Two separate grids of hexahedra with scrambled point numbers, one cell of the first
+// replaced by a polyhedron face stream, and a few points that belong to no cell.
+struct Mesh
+{
+  std::vector<double> xyz; // interleaved
+  std::vector<int64_t> offsets = { 0 };
+  std::vector<int64_t> conn;
+  std::vector<unsigned char> types;
+  std::vector<int64_t> unused; // points of no cell, in input order
+
+  int64_t NumPoints() const { return static_cast<int64_t>(xyz.size() / 3); }
+  int64_t NumCells() const { return static_cast<int64_t>(types.size()); }
+
+  cgns_writer::reorder::Cells<int64_t> Cells() const
+  {
+    return { offsets.data(), conn.data(), types.data(), NumCells() };
+  }
+};
+
+Mesh MakeMesh()
+{
+  const int64_t n = 9; // cells per axis of the first grid; the second is n x n x 1
+  const int64_t gridPoints = (n + 1) * (n + 1) * (n + 1);
+  const int64_t slabPoints = (n + 1) * (n + 1) * 2;
+  const int64_t extra = 5;
+  const int64_t numPoints = gridPoints + slabPoints + extra;
+
+  std::vector<int64_t> perm(static_cast<size_t>(numPoints));
+  for (size_t i = 0; i < perm.size(); ++i)
+  {
+    perm[i] = static_cast<int64_t>(i);
+  }
+  std::mt19937_64 rng(12345);
+  std::shuffle(perm.begin(), perm.end(), rng);
+
+  Mesh mesh;
+  mesh.xyz.resize(static_cast<size_t>(numPoints) * 3);
+  // Point number of grid node (i, j, k) of the part starting at point base, offset by dx in x.
+  const auto place = [&](const int64_t base, const int64_t i, const int64_t j, const int64_t k, const double dx) {
+    const int64_t p = perm[static_cast<size_t>(base + i + (n + 1) * (j + (n + 1) * k))];
+    mesh.xyz[static_cast<size_t>(p) * 3 + 0] = static_cast<double>(i) + dx;
+    mesh.xyz[static_cast<size_t>(p) * 3 + 1] = static_cast<double>(j);
+    mesh.xyz[static_cast<size_t>(p) * 3 + 2] = static_cast<double>(k);
+    return p;
+  };
+  const auto addGrid = [&](const int64_t base, const int64_t nz, const double dx) {
+    for (int64_t k = 0; k < nz; ++k)
+    {
+      for (int64_t j = 0; j < n; ++j)
+      {
+        for (int64_t i = 0; i < n; ++i)
+        {
+          const int64_t hex[8] = { place(base, i, j, k, dx),         place(base, i + 1, j, k, dx),
+                                   place(base, i + 1, j + 1, k, dx), place(base, i, j + 1, k, dx),
+                                   place(base, i, j, k + 1, dx),     place(base, i + 1, j, k + 1, dx),
+                                   place(base, i + 1, j + 1, k + 1, dx), place(base, i, j + 1, k + 1, dx) };
+          if (mesh.NumCells() == 7)
+          {
+            // The same cube as a face stream: each point appears in three faces.
+            const int faces[6][4] = { { 0, 4, 7, 3 }, { 1, 2, 6, 5 }, { 0, 1, 5, 4 },
+                                      { 3, 7, 6, 2 }, { 0, 3, 2, 1 }, { 4, 5, 6, 7 } };
+            mesh.conn.push_back(6);
+            for (const auto& face : faces)
+            {
+              mesh.conn.push_back(4);
+              for (const int v : face)
+              {
+                mesh.conn.push_back(hex[v]);
+              }
+            }
+            mesh.types.push_back(cgns_writer::reorder::kVtkPolyhedron);
+          }
+          else
+          {
+            mesh.conn.insert(mesh.conn.end(), hex, hex + 8);
+            mesh.types.push_back(12);
+          }
+          mesh.offsets.push_back(static_cast<int64_t>(mesh.conn.size()));
+        }
+      }
+    }
+  };
+  addGrid(0, n, 0.0);
+  addGrid(gridPoints, 1, 2.0 * static_cast<double>(n));
+  for (int64_t e = 0; e < extra; ++e)
+  {
+    const int64_t p = perm[static_cast<size_t>(gridPoints + slabPoints + e)];
+    mesh.xyz[static_cast<size_t>(p) * 3 + 0] = -1.0 - static_cast<double>(e);
+    mesh.unused.push_back(p);
+  }
+  std::sort(mesh.unused.begin(), mesh.unused.end());
+  return mesh;
+}
+
+bool IsPermutation(const std::vector<int64_t>& order, const int64_t n)
+{
+  if (static_cast<int64_t>(order.size()) != n)
+  {
+    return false;
+  }
+  std::vector<char> seen(static_cast<size_t>(n), 0);
+  for (const int64_t i : order)
+  {
+    if (i < 0 || i >= n || seen[static_cast<size_t>(i)])
+    {
+      return false;
+    }
+    seen[static_cast<size_t>(i)] = 1;
+  }
+  return true;
+}
+
+// Largest difference between the point numbers of a cell, with the points renumbered by rank.
+int64_t Bandwidth(const Mesh& mesh, const std::vector<int64_t>& rank)
+{
+  int64_t width = 0;
+  for (int64_t c = 0; c < mesh.NumCells(); ++c)
+  {
+    int64_t lo = INT64_MAX;
+    int64_t hi = INT64_MIN;
+    mesh.Cells().ForEachPoint(c, [&](const int64_t id) {
+      const int64_t r = rank.empty() ? id : rank[static_cast<size_t>(id)];
+      lo = std::min(lo, r);
+      hi = std::max(hi, r);
+    });
+    width = std::max(width, hi - lo);
+  }
+  return width;
+}
+
+int CheckOrders(const char* name, const Mesh& mesh, const std::function<Orders(size_t)>& run)
+{
+  int fails = 0;
+  const Orders one = run(1);
+  if (!IsPermutation(one.points, mesh.NumPoints()) || !IsPermutation(one.cells, mesh.NumCells()))
+  {
+    std::fprintf(stderr, "FAIL: %s: the point or cell order is not a permutation\n", name);
+    return 1;
+  }
+  for (const size_t numBlocks : { size_t(1), size_t(3), size_t(8) })
+  {
+    const Orders other = run(numBlocks);
+    if (other.points != one.points || other.cells != one.cells)
+    {
+      std::fprintf(stderr, "FAIL: %s: %zu blocks give other orders than the first run with 1 block\n", name,
+                   numBlocks);
+      ++fails;
+    }
+  }
+  return fails;
+}
+
+// The first 64 positions of the curve fill the 4 x 4 x 4 cube at the origin, one unit step apart.
+int CheckHilbertCurve()
+{
+  std::vector<int> at(64, -1);
+  for (uint32_t z = 0; z < 4; ++z)
+  {
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+      for (uint32_t x = 0; x < 4; ++x)
+      {
+        const uint64_t key = cgns_writer::reorder::detail::HilbertKey(x, y, z);
+        if (key >= 64 || at[static_cast<size_t>(key)] != -1)
+        {
+          std::fprintf(stderr, "FAIL: Hilbert key of (%u, %u, %u) is %llu\n", x, y, z,
+                       static_cast<unsigned long long>(key));
+          return 1;
+        }
+        at[static_cast<size_t>(key)] = static_cast<int>(x + 4 * (y + 4 * z));
+      }
+    }
+  }
+  for (size_t k = 1; k < at.size(); ++k)
+  {
+    const int a = at[k - 1];
+    const int b = at[k];
+    const int steps = std::abs(a % 4 - b % 4) + std::abs(a / 4 % 4 - b / 4 % 4) + std::abs(a / 16 - b / 16);
+    if (steps != 1)
+    {
+      std::fprintf(stderr, "FAIL: Hilbert keys %zu and %zu are %d steps apart\n", k - 1, k, steps);
+      return 1;
+    }
+  }
+  return 0;
+}
+} // namespace
+
+int main()
+{
+  const Mesh mesh = MakeMesh();
+  const auto cells = mesh.Cells();
+  const double* const xyz[3] = { mesh.xyz.data(), mesh.xyz.data() + 1, mesh.xyz.data() + 2 };
+
+  int fails = CheckHilbertCurve();
+  fails += CheckOrders("Hilbert", mesh, [&](const size_t numBlocks) {
+    return cgns_writer::reorder::Hilbert<int64_t>(xyz, 3, mesh.NumPoints(), cells, numBlocks, ThreadedFor);
+  });
+  fails += CheckOrders("RCM", mesh, [&](const size_t numBlocks) {
+    return cgns_writer::reorder::ReverseCuthillMcKee<int64_t>(mesh.NumPoints(), cells, numBlocks, ThreadedFor);
+  });
+
+  const Orders rcm = cgns_writer::reorder::ReverseCuthillMcKee<int64_t>(mesh.NumPoints(), cells, 4, ThreadedFor);
+  const std::vector<int64_t> tail(rcm.points.end() - static_cast<std::ptrdiff_t>(mesh.unused.size()),
+                                  rcm.points.end());
+  if (tail != mesh.unused)
+  {
+    std::fprintf(stderr, "FAIL: RCM: the points of no cell are not last in input order\n");
+    ++fails;
+  }
+  const int64_t before = Bandwidth(mesh, {});
+  const int64_t after = Bandwidth(mesh, cgns_writer::reorder::Inverse(rcm.points, 1, ThreadedFor));
+  if (after * 2 > before)
+  {
+    std::fprintf(stderr, "FAIL: RCM: bandwidth %lld, %lld before\n", static_cast<long long>(after),
+                 static_cast<long long>(before));
+    ++fails;
+  }
+
+  if (fails == 0)
+  {
+    std::printf("reorder: Hilbert and RCM orders are deterministic permutations (bandwidth %lld -> %lld)\n",
+                static_cast<long long>(before), static_cast<long long>(after));
+  }
+  return fails == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// A time step whose field write fails after its FlowSolution node was created must not
+// keep later steps from being appended.
+
+#include "CgnsWriterExport.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+int Fail(const char* what)
+{
+  std::fprintf(stderr, "FAIL: %s: %s\n", what, cgns_get_last_error());
+  return 1;
+}
+} // namespace
+
+int main()
+{
+  // One hexahedron.
+  std::vector<double> points = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 0, 1, 1 };
+  std::vector<int32_t> connectivity = { 0, 1, 2, 3, 4, 5, 6, 7 };
+  std::vector<int32_t> offsets = { 0, 8 };
+  std::vector<unsigned char> types = { 12 };
+
+  UnstructuredMeshInfo mesh;
+  cgns_mesh_info_init(&mesh);
+  mesh.points = points.data();
+  mesh.num_points = 8;
+  mesh.connectivity = connectivity.data();
+  mesh.connectivity_size = static_cast<int64_t>(connectivity.size());
+  mesh.offsets = offsets.data();
+  mesh.num_cells = 1;
+  mesh.types = types.data();
+
+  CgnsTimeSeries* series = nullptr;
+  if (cgns_timeseries_open("timeseries_test.cgns", &mesh, nullptr, &series) != 0)
+  {
+    return Fail("open");
+  }
+
+  std::vector<double> pointValues(8, 1.0);
+  std::vector<double> cellValues(1, 2.0);
+  const CgnsFieldInfo pointField = { "p", CGNS_FIELD_FLOAT64, 1, pointValues.data(), 0 };
+  const CgnsFieldInfo cellField = { "c", CGNS_FIELD_FLOAT64, 1, cellValues.data(), 0 };
+  // CGNS node names are limited to 32 characters, so libcgns rejects this field after
+  // PointData_1 has been written and CellData_1 created.
+  const CgnsFieldInfo badCellField = { "a_cell_field_name_longer_than_32_characters", CGNS_FIELD_FLOAT64, 1,
+                                       cellValues.data(), 0 };
+
+  if (cgns_timeseries_append_step(series, 0.0, &pointField, 1, &badCellField, 1) == 0)
+  {
+    cgns_timeseries_close(series);
+    std::fprintf(stderr, "FAIL: a field name longer than 32 characters was accepted\n");
+    return 1;
+  }
+  if (cgns_timeseries_append_step(series, 0.5, &pointField, 1, &cellField, 1) != 0)
+  {
+    Fail("append after a failed step");
+    cgns_timeseries_close(series);
+    return 1;
+  }
+  if (cgns_timeseries_append_step(series, 1.0, &pointField, 1, &cellField, 1) != 0)
+  {
+    Fail("second append after a failed step");
+    cgns_timeseries_close(series);
+    return 1;
+  }
+  if (cgns_timeseries_close(series) != 0)
+  {
+    return Fail("close");
+  }
+  return 0;
+}
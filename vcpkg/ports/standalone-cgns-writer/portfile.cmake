@@ -14,7 +14,7 @@
 vcpkg_from_git(
     OUT_SOURCE_PATH SOURCE_PATH
     URL https://github.com/your-org/StandaloneCgnsWriter.git
-    REF v0.1.0
+    REF v0.2.0
     # For private repos, you may need to use authentication
     # See vcpkg documentation for Git authentication options
 )